@@ -0,0 +1,307 @@
+/*
+ * Decode load-shedding policy implementation
+ */
+
+#include "decode-policy.h"
+#include "cpu-affinity.h"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <libswscale/swscale.h>
+#include <string.h>
+
+#define blog(level, format, ...) \
+	blog(level, "[Decode Policy] " format, ##__VA_ARGS__)
+
+/* Balanced mode tuning */
+#define EVAL_INTERVAL_FRAMES 30            /* Evaluate roughly once per second at 30fps */
+#define ESCALATE_AFTER_EVALS 3             /* Consecutive bound evaluations before shedding more */
+#define RELAX_AFTER_EVALS 10               /* Consecutive clear evaluations before restoring quality */
+#define LEVEL_CHANGE_COOLDOWN_NS 2000000000ULL /* Let averages settle after a change */
+
+/* Frames the decoder may hold ahead of display - matches FRAME_BUFFER_SLOTS */
+#define POLICY_MAX_QUEUE_DEPTH 3
+
+static const char *level_names[DECODE_LEVEL_COUNT] = {
+	"full", "light", "heavy", "max"
+};
+
+/* Fill knobs for a mode/level pair, then overlay the governor's budget */
+static void compute_knobs(enum decode_policy_mode mode, int level,
+			  const struct decode_policy_budget *budget,
+			  struct decode_policy_knobs *k)
+{
+	memset(k, 0, sizeof(*k));
+
+	/* Quality keeps full decode, only the governor's resolution and frame
+	 * budgets reach it */
+	if (mode != DECODE_POLICY_QUALITY && level < budget->floor_level)
+		level = budget->floor_level;
+	if (level >= DECODE_LEVEL_COUNT)
+		level = DECODE_LEVEL_COUNT - 1;
+
+	/* Threading is fixed at codec open. Frame threading adds a frame of
+	 * latency per thread, so Performance mode keeps the count modest to
+	 * leave cores for other sources. */
+	k->codec_thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+	if (mode == DECODE_POLICY_PERFORMANCE) {
+		int threads = get_cpu_count() / 4;
+		if (threads < 1) threads = 1;
+		if (threads > 4) threads = 4;
+		k->codec_threads = threads;
+		k->codec_fast = true;
+	} else {
+		k->codec_threads = 0;
+		k->codec_fast = false;
+	}
+
+	switch (level) {
+	case DECODE_LEVEL_FULL:
+		k->skip_loop_filter = AVDISCARD_DEFAULT;
+		k->skip_idct = AVDISCARD_DEFAULT;
+		k->sws_flags = SWS_BICUBIC | SWS_ACCURATE_RND;
+		k->convert_threads = 0;
+		k->queue_depth = POLICY_MAX_QUEUE_DEPTH;
+		k->cache_admission = true;
+		break;
+	case DECODE_LEVEL_LIGHT:
+		k->skip_loop_filter = AVDISCARD_NONREF;
+		k->skip_idct = AVDISCARD_DEFAULT;
+		k->sws_flags = SWS_BILINEAR;
+		k->convert_threads = 2;
+		k->queue_depth = POLICY_MAX_QUEUE_DEPTH;
+		k->cache_admission = true;
+		break;
+	case DECODE_LEVEL_HEAVY:
+		k->skip_loop_filter = AVDISCARD_BIDIR;
+		k->skip_idct = AVDISCARD_NONREF;
+		k->sws_flags = SWS_FAST_BILINEAR;
+		k->convert_threads = 1;
+		k->queue_depth = 2;
+		k->cache_admission = false;
+		break;
+	case DECODE_LEVEL_MAX:
+	default:
+		k->skip_loop_filter = AVDISCARD_ALL;
+		k->skip_idct = AVDISCARD_BIDIR;
+		k->sws_flags = SWS_FAST_BILINEAR;
+		k->convert_threads = 1;
+		k->queue_depth = 2;
+		k->cache_admission = false;
+		break;
+	}
+
+	k->frame_decimation = budget->frame_decimation > 1 ? budget->frame_decimation : 1;
+	k->scale_divisor = budget->scale_divisor > 1 ? budget->scale_divisor : 1;
+}
+
+/* Must be called with lock held */
+static void set_level_locked(struct decode_policy *policy, int level)
+{
+	if (level < policy->min_level) level = policy->min_level;
+	if (level > policy->max_level) level = policy->max_level;
+
+	policy->level = level;
+	compute_knobs(policy->mode, level, &policy->budget, &policy->knobs);
+	policy->generation++;
+	policy->last_change_time = os_gettime_ns();
+	policy->bound_streak = 0;
+	policy->clear_streak = 0;
+}
+
+static void set_mode_locked(struct decode_policy *policy, enum decode_policy_mode mode)
+{
+	policy->mode = mode;
+
+	switch (mode) {
+	case DECODE_POLICY_QUALITY:
+		policy->min_level = DECODE_LEVEL_FULL;
+		policy->max_level = DECODE_LEVEL_FULL;
+		set_level_locked(policy, DECODE_LEVEL_FULL);
+		break;
+	case DECODE_POLICY_PERFORMANCE:
+		policy->min_level = DECODE_LEVEL_HEAVY;
+		policy->max_level = DECODE_LEVEL_MAX;
+		set_level_locked(policy, DECODE_LEVEL_HEAVY);
+		break;
+	case DECODE_POLICY_BALANCED:
+	default:
+		policy->mode = DECODE_POLICY_BALANCED;
+		policy->min_level = DECODE_LEVEL_FULL;
+		policy->max_level = DECODE_LEVEL_MAX;
+		/* Full quality until the decoder or CPU falls behind */
+		set_level_locked(policy, DECODE_LEVEL_FULL);
+		break;
+	}
+}
+
+void decode_policy_init(struct decode_policy *policy, enum decode_policy_mode mode)
+{
+	if (!policy)
+		return;
+
+	memset(policy, 0, sizeof(*policy));
+	policy->budget.frame_decimation = 1;
+	policy->budget.scale_divisor = 1;
+	pthread_mutex_init(&policy->lock, NULL);
+	set_mode_locked(policy, mode);
+}
+
+void decode_policy_destroy(struct decode_policy *policy)
+{
+	if (!policy)
+		return;
+
+	if (policy->escalations || policy->relaxations) {
+		blog(LOG_INFO, "Policy stats: %u escalations, %u relaxations, final level %s",
+			policy->escalations, policy->relaxations,
+			decode_policy_level_name(policy->level));
+	}
+
+	pthread_mutex_destroy(&policy->lock);
+}
+
+bool decode_policy_set_mode(struct decode_policy *policy, enum decode_policy_mode mode)
+{
+	if (!policy)
+		return false;
+
+	pthread_mutex_lock(&policy->lock);
+	bool changed = policy->mode != mode;
+	if (changed) {
+		set_mode_locked(policy, mode);
+		blog(LOG_INFO, "Mode set to %s (level %s)",
+			decode_policy_mode_name(policy->mode),
+			decode_policy_level_name(policy->level));
+	}
+	pthread_mutex_unlock(&policy->lock);
+
+	return changed;
+}
+
+bool decode_policy_set_budget(struct decode_policy *policy, const struct decode_policy_budget *budget)
+{
+	if (!policy || !budget)
+		return false;
+
+	pthread_mutex_lock(&policy->lock);
+	bool changed = memcmp(&policy->budget, budget, sizeof(*budget)) != 0;
+	if (changed) {
+		policy->budget = *budget;
+		compute_knobs(policy->mode, policy->level, &policy->budget, &policy->knobs);
+		policy->generation++;
+	}
+	pthread_mutex_unlock(&policy->lock);
+
+	return changed;
+}
+
+bool decode_policy_evaluate(struct decode_policy *policy, const perf_monitor_t *monitor)
+{
+	if (!policy || !monitor)
+		return false;
+
+	pthread_mutex_lock(&policy->lock);
+
+	/* Nothing to adapt if the mode pins a single level */
+	if (policy->min_level == policy->max_level ||
+	    ++policy->frames_since_eval < EVAL_INTERVAL_FRAMES) {
+		pthread_mutex_unlock(&policy->lock);
+		return false;
+	}
+	policy->frames_since_eval = 0;
+
+	if (os_gettime_ns() - policy->last_change_time < LEVEL_CHANGE_COOLDOWN_NS) {
+		pthread_mutex_unlock(&policy->lock);
+		return false;
+	}
+
+	bool changed = false;
+	bool bound = monitor->is_decoder_bound || monitor->is_cpu_bound;
+
+	if (bound) {
+		policy->clear_streak = 0;
+		if (++policy->bound_streak >= ESCALATE_AFTER_EVALS &&
+		    policy->level < policy->max_level) {
+			int old_level = policy->level;
+			set_level_locked(policy, policy->level + 1);
+			policy->escalations++;
+			changed = true;
+			blog(LOG_INFO, "Escalating %s -> %s (%s bound, decode %.1fms, total %.1fms)",
+				decode_policy_level_name(old_level),
+				decode_policy_level_name(policy->level),
+				monitor->is_decoder_bound ? "decoder" : "CPU",
+				monitor->avg_decode_time / 1000000.0,
+				monitor->avg_render_time / 1000000.0);
+		}
+	} else {
+		policy->bound_streak = 0;
+		if (++policy->clear_streak >= RELAX_AFTER_EVALS &&
+		    policy->level > policy->min_level) {
+			int old_level = policy->level;
+			set_level_locked(policy, policy->level - 1);
+			policy->relaxations++;
+			changed = true;
+			blog(LOG_INFO, "Relaxing %s -> %s",
+				decode_policy_level_name(old_level),
+				decode_policy_level_name(policy->level));
+		}
+	}
+
+	pthread_mutex_unlock(&policy->lock);
+	return changed;
+}
+
+uint32_t decode_policy_get_knobs(struct decode_policy *policy, struct decode_policy_knobs *out)
+{
+	if (!policy || !out)
+		return 0;
+
+	pthread_mutex_lock(&policy->lock);
+	*out = policy->knobs;
+	uint32_t generation = policy->generation;
+	pthread_mutex_unlock(&policy->lock);
+
+	return generation;
+}
+
+void decode_policy_apply_codec_open(struct decode_policy *policy, AVCodecContext *ctx)
+{
+	if (!policy || !ctx)
+		return;
+
+	struct decode_policy_knobs knobs;
+	decode_policy_get_knobs(policy, &knobs);
+
+	ctx->thread_count = knobs.codec_threads;
+	ctx->thread_type = knobs.codec_thread_type;
+	if (knobs.codec_fast)
+		ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+
+	decode_policy_apply_codec(&knobs, ctx);
+}
+
+void decode_policy_apply_codec(const struct decode_policy_knobs *knobs, AVCodecContext *ctx)
+{
+	if (!knobs || !ctx)
+		return;
+
+	ctx->skip_loop_filter = knobs->skip_loop_filter;
+	ctx->skip_idct = knobs->skip_idct;
+}
+
+const char *decode_policy_mode_name(enum decode_policy_mode mode)
+{
+	switch (mode) {
+	case DECODE_POLICY_QUALITY:     return "Quality";
+	case DECODE_POLICY_BALANCED:    return "Balanced";
+	case DECODE_POLICY_PERFORMANCE: return "Performance";
+	}
+	return "Unknown";
+}
+
+const char *decode_policy_level_name(int level)
+{
+	if (level < 0 || level >= DECODE_LEVEL_COUNT)
+		return "unknown";
+	return level_names[level];
+}
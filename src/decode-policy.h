@@ -0,0 +1,99 @@
+/*
+ * Decode load-shedding policy
+ * Turns the Performance Mode setting into concrete decoder, scaler and
+ * buffering knobs, and escalates/relaxes them under load in Balanced mode
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <util/threading.h>
+#include <libavcodec/avcodec.h>
+#include "performance-monitor.h"
+
+/* Matches the "performance_mode" source setting */
+enum decode_policy_mode {
+	DECODE_POLICY_QUALITY = 0,
+	DECODE_POLICY_BALANCED = 1,
+	DECODE_POLICY_PERFORMANCE = 2
+};
+
+/* Load-shedding levels, from full quality to maximum shedding */
+enum decode_policy_level {
+	DECODE_LEVEL_FULL = 0,   /* No shortcuts */
+	DECODE_LEVEL_LIGHT = 1,  /* Skip loop filter on non-reference frames */
+	DECODE_LEVEL_HEAVY = 2,  /* Skip loop filter on B-frames, skip IDCT on non-ref */
+	DECODE_LEVEL_MAX = 3,    /* Skip loop filter everywhere, skip IDCT on B-frames */
+	DECODE_LEVEL_COUNT
+};
+
+/* Concrete settings derived from mode + level */
+struct decode_policy_knobs {
+	int codec_threads;               /* 0 = let FFmpeg decide (open time only) */
+	int codec_thread_type;           /* FF_THREAD_* (open time only) */
+	bool codec_fast;                 /* AV_CODEC_FLAG2_FAST (open time only) */
+	enum AVDiscard skip_loop_filter;
+	enum AVDiscard skip_idct;
+	int sws_flags;                   /* Scaler algorithm */
+	int convert_threads;             /* swscale slice threads, 0 = auto */
+	int queue_depth;                 /* Decoded frames buffered ahead of display */
+	bool cache_admission;            /* Whether converted frames may enter the frame cache */
+	int frame_decimation;            /* Keep 1 of every N decoded frames (1 = keep all) */
+	int scale_divisor;               /* Output resolution divisor (1 = native) */
+};
+
+/* Machine-wide budget imposed by the load governor */
+struct decode_policy_budget {
+	int floor_level;                 /* Minimum shedding level, regardless of mode */
+	int frame_decimation;            /* Keep 1 of every N frames */
+	int scale_divisor;               /* Output resolution divisor */
+};
+
+struct decode_policy {
+	enum decode_policy_mode mode;
+	int level;
+	int min_level;                   /* Lowest level the current mode allows */
+	int max_level;                   /* Highest level the current mode allows */
+	struct decode_policy_knobs knobs;
+	struct decode_policy_budget budget;
+	uint32_t generation;             /* Bumped whenever the knobs change */
+
+	/* Balanced mode hysteresis */
+	uint32_t frames_since_eval;
+	uint32_t bound_streak;
+	uint32_t clear_streak;
+	uint64_t last_change_time;
+
+	/* Statistics */
+	uint32_t escalations;
+	uint32_t relaxations;
+
+	pthread_mutex_t lock;
+};
+
+/* Initialize/destroy policy */
+void decode_policy_init(struct decode_policy *policy, enum decode_policy_mode mode);
+void decode_policy_destroy(struct decode_policy *policy);
+
+/* Change the mode (from the source settings). Returns true if knobs changed */
+bool decode_policy_set_mode(struct decode_policy *policy, enum decode_policy_mode mode);
+
+/* Apply a budget from the load governor. Returns true if knobs changed */
+bool decode_policy_set_budget(struct decode_policy *policy, const struct decode_policy_budget *budget);
+
+/* Feed the per-frame performance signals. Returns true if knobs changed */
+bool decode_policy_evaluate(struct decode_policy *policy, const perf_monitor_t *monitor);
+
+/* Snapshot the current knobs and their generation */
+uint32_t decode_policy_get_knobs(struct decode_policy *policy, struct decode_policy_knobs *out);
+
+/* Apply open-time settings (threading) - call before avcodec_open2 */
+void decode_policy_apply_codec_open(struct decode_policy *policy, AVCodecContext *ctx);
+
+/* Apply runtime settings (skip flags) to an opened codec */
+void decode_policy_apply_codec(const struct decode_policy_knobs *knobs, AVCodecContext *ctx);
+
+/* Human readable names for logging */
+const char *decode_policy_mode_name(enum decode_policy_mode mode);
+const char *decode_policy_level_name(int level);
@@ -0,0 +1,511 @@
+/*
+ * Deinterlacing implementation
+ * Every output line is either copied from the kept field or built from the
+ * lines above and below it, so all modes run as line kernels over each
+ * plane. The vector kernels match the scalar ones bit for bit
+ */
+
+#include "deinterlace.h"
+#include "simd-convert.h"
+#include <obs-module.h>
+#include <string.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+
+#define blog(level, format, ...) \
+	blog(level, "[Deinterlace] " format, ##__VA_ARGS__)
+
+/* Line kernels. interp builds a missing line from the lines above and below,
+ * blend filters a line with its neighbours, edge interpolates along the
+ * direction (\, | or /) where above and below differ least. step is the
+ * distance in samples to the horizontal neighbour of the same component,
+ * 2 for the interleaved chroma of NV12 and P010 */
+typedef void (*interp_line_func)(void *dst, const void *above, const void *below, int count);
+typedef void (*blend_line_func)(void *dst, const void *above, const void *cur, const void *below, int count);
+typedef void (*edge_line_func)(void *dst, const void *above, const void *below, int count, int step);
+
+struct line_kernels {
+	interp_line_func interp;
+	blend_line_func blend;
+	edge_line_func edge;
+};
+
+/* Rounded average, as _mm_avg_epu8/_mm_avg_epu16 compute it */
+static inline int avg_sample(int a, int b)
+{
+	return (a + b + 1) >> 1;
+}
+
+static inline int abs_diff(int a, int b)
+{
+	return a > b ? a - b : b - a;
+}
+
+/* Edge-directed sample at i. The vertical direction wins ties, then \ */
+static inline int edge_sample(int a, int b, int a_left, int b_right, int a_right, int b_left)
+{
+	int best = avg_sample(a, b);
+	int diff = abs_diff(a, b);
+
+	if (abs_diff(a_left, b_right) < diff) {
+		diff = abs_diff(a_left, b_right);
+		best = avg_sample(a_left, b_right);
+	}
+	if (abs_diff(a_right, b_left) < diff)
+		best = avg_sample(a_right, b_left);
+	return best;
+}
+
+/* Scalar kernels, also the tails of the vector ones */
+static void interp_line8_c(uint8_t *dst, const uint8_t *a, const uint8_t *b, int start, int count)
+{
+	for (int i = start; i < count; i++)
+		dst[i] = (uint8_t)avg_sample(a[i], b[i]);
+}
+
+static void blend_line8_c(uint8_t *dst, const uint8_t *a, const uint8_t *c, const uint8_t *b, int start, int count)
+{
+	for (int i = start; i < count; i++)
+		dst[i] = (uint8_t)avg_sample(avg_sample(a[i], b[i]), c[i]);
+}
+
+static void edge_line8_c(uint8_t *dst, const uint8_t *a, const uint8_t *b, int start, int count, int step)
+{
+	for (int i = start; i < count; i++) {
+		if (i < step || i + step >= count)
+			dst[i] = (uint8_t)avg_sample(a[i], b[i]);
+		else
+			dst[i] = (uint8_t)edge_sample(a[i], b[i], a[i - step], b[i + step], a[i + step], b[i - step]);
+	}
+}
+
+static void interp_line16_c(uint16_t *dst, const uint16_t *a, const uint16_t *b, int start, int count)
+{
+	for (int i = start; i < count; i++)
+		dst[i] = (uint16_t)avg_sample(a[i], b[i]);
+}
+
+static void blend_line16_c(uint16_t *dst, const uint16_t *a, const uint16_t *c, const uint16_t *b, int start, int count)
+{
+	for (int i = start; i < count; i++)
+		dst[i] = (uint16_t)avg_sample(avg_sample(a[i], b[i]), c[i]);
+}
+
+static void edge_line16_c(uint16_t *dst, const uint16_t *a, const uint16_t *b, int start, int count, int step)
+{
+	for (int i = start; i < count; i++) {
+		if (i < step || i + step >= count)
+			dst[i] = (uint16_t)avg_sample(a[i], b[i]);
+		else
+			dst[i] = (uint16_t)edge_sample(a[i], b[i], a[i - step], b[i + step], a[i + step], b[i - step]);
+	}
+}
+
+static void interp8_c(void *dst, const void *a, const void *b, int count)
+{
+	interp_line8_c(dst, a, b, 0, count);
+}
+
+static void blend8_c(void *dst, const void *a, const void *c, const void *b, int count)
+{
+	blend_line8_c(dst, a, c, b, 0, count);
+}
+
+static void edge8_c(void *dst, const void *a, const void *b, int count, int step)
+{
+	edge_line8_c(dst, a, b, 0, count, step);
+}
+
+static void interp16_c(void *dst, const void *a, const void *b, int count)
+{
+	interp_line16_c(dst, a, b, 0, count);
+}
+
+static void blend16_c(void *dst, const void *a, const void *c, const void *b, int count)
+{
+	blend_line16_c(dst, a, c, b, 0, count);
+}
+
+static void edge16_c(void *dst, const void *a, const void *b, int count, int step)
+{
+	edge_line16_c(dst, a, b, 0, count, step);
+}
+
+/* SSE4.2 kernels, 16 bytes at a time */
+static inline __m128i absdiff_epu8_sse42(__m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+static inline __m128i absdiff_epu16_sse42(__m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_subs_epu16(a, b), _mm_subs_epu16(b, a));
+}
+
+static void interp8_sse42(void *dst, const void *above, const void *below, int count)
+{
+	uint8_t *d = dst;
+	const uint8_t *a = above, *b = below;
+	int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		_mm_storeu_si128((__m128i*)(d + i), _mm_avg_epu8(va, vb));
+	}
+	interp_line8_c(d, a, b, i, count);
+}
+
+static void blend8_sse42(void *dst, const void *above, const void *cur, const void *below, int count)
+{
+	uint8_t *d = dst;
+	const uint8_t *a = above, *c = cur, *b = below;
+	int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vc = _mm_loadu_si128((const __m128i*)(c + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		_mm_storeu_si128((__m128i*)(d + i), _mm_avg_epu8(_mm_avg_epu8(va, vb), vc));
+	}
+	blend_line8_c(d, a, c, b, i, count);
+}
+
+static void edge8_sse42(void *dst, const void *above, const void *below, int count, int step)
+{
+	uint8_t *d = dst;
+	const uint8_t *a = above, *b = below;
+	int i = step < count ? step : count;
+
+	/* Borders without both neighbours are interpolated vertically */
+	interp_line8_c(d, a, b, 0, i);
+	for (; i + 16 + step <= count; i += 16) {
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		__m128i va_l = _mm_loadu_si128((const __m128i*)(a + i - step));
+		__m128i vb_r = _mm_loadu_si128((const __m128i*)(b + i + step));
+		__m128i va_r = _mm_loadu_si128((const __m128i*)(a + i + step));
+		__m128i vb_l = _mm_loadu_si128((const __m128i*)(b + i - step));
+
+		__m128i best = _mm_avg_epu8(va, vb);
+		__m128i diff = absdiff_epu8_sse42(va, vb);
+
+		/* Keep the current choice where it is no worse (min == diff) */
+		__m128i d1 = absdiff_epu8_sse42(va_l, vb_r);
+		__m128i keep = _mm_cmpeq_epi8(_mm_min_epu8(diff, d1), diff);
+		best = _mm_blendv_epi8(_mm_avg_epu8(va_l, vb_r), best, keep);
+		diff = _mm_min_epu8(diff, d1);
+
+		__m128i d2 = absdiff_epu8_sse42(va_r, vb_l);
+		keep = _mm_cmpeq_epi8(_mm_min_epu8(diff, d2), diff);
+		best = _mm_blendv_epi8(_mm_avg_epu8(va_r, vb_l), best, keep);
+
+		_mm_storeu_si128((__m128i*)(d + i), best);
+	}
+	edge_line8_c(d, a, b, i, count, step);
+}
+
+static void interp16_sse42(void *dst, const void *above, const void *below, int count)
+{
+	uint16_t *d = dst;
+	const uint16_t *a = above, *b = below;
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		_mm_storeu_si128((__m128i*)(d + i), _mm_avg_epu16(va, vb));
+	}
+	interp_line16_c(d, a, b, i, count);
+}
+
+static void blend16_sse42(void *dst, const void *above, const void *cur, const void *below, int count)
+{
+	uint16_t *d = dst;
+	const uint16_t *a = above, *c = cur, *b = below;
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vc = _mm_loadu_si128((const __m128i*)(c + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		_mm_storeu_si128((__m128i*)(d + i), _mm_avg_epu16(_mm_avg_epu16(va, vb), vc));
+	}
+	blend_line16_c(d, a, c, b, i, count);
+}
+
+static void edge16_sse42(void *dst, const void *above, const void *below, int count, int step)
+{
+	uint16_t *d = dst;
+	const uint16_t *a = above, *b = below;
+	int i = step < count ? step : count;
+
+	interp_line16_c(d, a, b, 0, i);
+	for (; i + 8 + step <= count; i += 8) {
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		__m128i va_l = _mm_loadu_si128((const __m128i*)(a + i - step));
+		__m128i vb_r = _mm_loadu_si128((const __m128i*)(b + i + step));
+		__m128i va_r = _mm_loadu_si128((const __m128i*)(a + i + step));
+		__m128i vb_l = _mm_loadu_si128((const __m128i*)(b + i - step));
+
+		__m128i best = _mm_avg_epu16(va, vb);
+		__m128i diff = absdiff_epu16_sse42(va, vb);
+
+		__m128i d1 = absdiff_epu16_sse42(va_l, vb_r);
+		__m128i keep = _mm_cmpeq_epi16(_mm_min_epu16(diff, d1), diff);
+		best = _mm_blendv_epi8(_mm_avg_epu16(va_l, vb_r), best, keep);
+		diff = _mm_min_epu16(diff, d1);
+
+		__m128i d2 = absdiff_epu16_sse42(va_r, vb_l);
+		keep = _mm_cmpeq_epi16(_mm_min_epu16(diff, d2), diff);
+		best = _mm_blendv_epi8(_mm_avg_epu16(va_r, vb_l), best, keep);
+
+		_mm_storeu_si128((__m128i*)(d + i), best);
+	}
+	edge_line16_c(d, a, b, i, count, step);
+}
+
+/* AVX2 kernels, 32 bytes at a time */
+static inline __m256i absdiff_epu8_avx2(__m256i a, __m256i b)
+{
+	return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+}
+
+static inline __m256i absdiff_epu16_avx2(__m256i a, __m256i b)
+{
+	return _mm256_or_si256(_mm256_subs_epu16(a, b), _mm256_subs_epu16(b, a));
+}
+
+static void interp8_avx2(void *dst, const void *above, const void *below, int count)
+{
+	uint8_t *d = dst;
+	const uint8_t *a = above, *b = below;
+	int i = 0;
+
+	for (; i + 32 <= count; i += 32) {
+		__m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+		_mm256_storeu_si256((__m256i*)(d + i), _mm256_avg_epu8(va, vb));
+	}
+	interp_line8_c(d, a, b, i, count);
+}
+
+static void blend8_avx2(void *dst, const void *above, const void *cur, const void *below, int count)
+{
+	uint8_t *d = dst;
+	const uint8_t *a = above, *c = cur, *b = below;
+	int i = 0;
+
+	for (; i + 32 <= count; i += 32) {
+		__m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i vc = _mm256_loadu_si256((const __m256i*)(c + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+		_mm256_storeu_si256((__m256i*)(d + i), _mm256_avg_epu8(_mm256_avg_epu8(va, vb), vc));
+	}
+	blend_line8_c(d, a, c, b, i, count);
+}
+
+static void edge8_avx2(void *dst, const void *above, const void *below, int count, int step)
+{
+	uint8_t *d = dst;
+	const uint8_t *a = above, *b = below;
+	int i = step < count ? step : count;
+
+	interp_line8_c(d, a, b, 0, i);
+	for (; i + 32 + step <= count; i += 32) {
+		__m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+		__m256i va_l = _mm256_loadu_si256((const __m256i*)(a + i - step));
+		__m256i vb_r = _mm256_loadu_si256((const __m256i*)(b + i + step));
+		__m256i va_r = _mm256_loadu_si256((const __m256i*)(a + i + step));
+		__m256i vb_l = _mm256_loadu_si256((const __m256i*)(b + i - step));
+
+		__m256i best = _mm256_avg_epu8(va, vb);
+		__m256i diff = absdiff_epu8_avx2(va, vb);
+
+		__m256i d1 = absdiff_epu8_avx2(va_l, vb_r);
+		__m256i keep = _mm256_cmpeq_epi8(_mm256_min_epu8(diff, d1), diff);
+		best = _mm256_blendv_epi8(_mm256_avg_epu8(va_l, vb_r), best, keep);
+		diff = _mm256_min_epu8(diff, d1);
+
+		__m256i d2 = absdiff_epu8_avx2(va_r, vb_l);
+		keep = _mm256_cmpeq_epi8(_mm256_min_epu8(diff, d2), diff);
+		best = _mm256_blendv_epi8(_mm256_avg_epu8(va_r, vb_l), best, keep);
+
+		_mm256_storeu_si256((__m256i*)(d + i), best);
+	}
+	edge_line8_c(d, a, b, i, count, step);
+}
+
+static void interp16_avx2(void *dst, const void *above, const void *below, int count)
+{
+	uint16_t *d = dst;
+	const uint16_t *a = above, *b = below;
+	int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+		_mm256_storeu_si256((__m256i*)(d + i), _mm256_avg_epu16(va, vb));
+	}
+	interp_line16_c(d, a, b, i, count);
+}
+
+static void blend16_avx2(void *dst, const void *above, const void *cur, const void *below, int count)
+{
+	uint16_t *d = dst;
+	const uint16_t *a = above, *c = cur, *b = below;
+	int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i vc = _mm256_loadu_si256((const __m256i*)(c + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+		_mm256_storeu_si256((__m256i*)(d + i), _mm256_avg_epu16(_mm256_avg_epu16(va, vb), vc));
+	}
+	blend_line16_c(d, a, c, b, i, count);
+}
+
+static void edge16_avx2(void *dst, const void *above, const void *below, int count, int step)
+{
+	uint16_t *d = dst;
+	const uint16_t *a = above, *b = below;
+	int i = step < count ? step : count;
+
+	interp_line16_c(d, a, b, 0, i);
+	for (; i + 16 + step <= count; i += 16) {
+		__m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+		__m256i va_l = _mm256_loadu_si256((const __m256i*)(a + i - step));
+		__m256i vb_r = _mm256_loadu_si256((const __m256i*)(b + i + step));
+		__m256i va_r = _mm256_loadu_si256((const __m256i*)(a + i + step));
+		__m256i vb_l = _mm256_loadu_si256((const __m256i*)(b + i - step));
+
+		__m256i best = _mm256_avg_epu16(va, vb);
+		__m256i diff = absdiff_epu16_avx2(va, vb);
+
+		__m256i d1 = absdiff_epu16_avx2(va_l, vb_r);
+		__m256i keep = _mm256_cmpeq_epi16(_mm256_min_epu16(diff, d1), diff);
+		best = _mm256_blendv_epi8(_mm256_avg_epu16(va_l, vb_r), best, keep);
+		diff = _mm256_min_epu16(diff, d1);
+
+		__m256i d2 = absdiff_epu16_avx2(va_r, vb_l);
+		keep = _mm256_cmpeq_epi16(_mm256_min_epu16(diff, d2), diff);
+		best = _mm256_blendv_epi8(_mm256_avg_epu16(va_r, vb_l), best, keep);
+
+		_mm256_storeu_si256((__m256i*)(d + i), best);
+	}
+	edge_line16_c(d, a, b, i, count, step);
+}
+
+/* Best kernels for this CPU, by sample size */
+static const struct line_kernels *get_line_kernels(bool wide)
+{
+	static const struct line_kernels c8 = {interp8_c, blend8_c, edge8_c};
+	static const struct line_kernels c16 = {interp16_c, blend16_c, edge16_c};
+	static const struct line_kernels sse42_8 = {interp8_sse42, blend8_sse42, edge8_sse42};
+	static const struct line_kernels sse42_16 = {interp16_sse42, blend16_sse42, edge16_sse42};
+	static const struct line_kernels avx2_8 = {interp8_avx2, blend8_avx2, edge8_avx2};
+	static const struct line_kernels avx2_16 = {interp16_avx2, blend16_avx2, edge16_avx2};
+	static int level = -1;
+
+	if (level < 0) {
+		level = simd_check_avx2() ? 2 : simd_check_sse42() ? 1 : 0;
+		blog(LOG_INFO, "Using %s line kernels", level == 2 ? "AVX2" : level == 1 ? "SSE4.2" : "scalar");
+	}
+
+	if (level == 2)
+		return wide ? &avx2_16 : &avx2_8;
+	if (level == 1)
+		return wide ? &sse42_16 : &sse42_8;
+	return wide ? &c16 : &c8;
+}
+
+bool deinterlace_supported(enum AVPixelFormat format)
+{
+	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+	if (!desc || !(desc->flags & AV_PIX_FMT_FLAG_PLANAR))
+		return false;
+	if (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM |
+	                   AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BE))
+		return false;
+
+	/* Every component a whole 8- or 16-bit sample */
+	int bytes = desc->comp[0].depth > 8 ? 2 : 1;
+	for (int c = 0; c < desc->nb_components; c++) {
+		if (desc->comp[c].depth > 16 || (desc->comp[c].depth > 8 ? 2 : 1) != bytes ||
+		    desc->comp[c].step % bytes != 0)
+			return false;
+	}
+	return true;
+}
+
+bool deinterlace_field_rate(enum deinterlace_mode mode)
+{
+	return mode == DEINTERLACE_BOB || mode == DEINTERLACE_EDGE;
+}
+
+/* Samples between horizontal neighbours of the same component in a plane */
+static int plane_step(const AVPixFmtDescriptor *desc, int plane, int bytes)
+{
+	for (int c = 0; c < desc->nb_components; c++) {
+		if (desc->comp[c].plane == plane)
+			return desc->comp[c].step / bytes;
+	}
+	return 1;
+}
+
+AVFrame *deinterlace_frame(const AVFrame *src, enum deinterlace_mode mode, int field)
+{
+	if (mode == DEINTERLACE_OFF || !deinterlace_supported(src->format))
+		return NULL;
+
+	AVFrame *dst = av_frame_alloc();
+	if (!dst)
+		return NULL;
+
+	dst->format = src->format;
+	dst->width = src->width;
+	dst->height = src->height;
+	if (av_frame_get_buffer(dst, 0) < 0 || av_frame_copy_props(dst, src) < 0) {
+		av_frame_free(&dst);
+		return NULL;
+	}
+	dst->flags &= ~(AV_FRAME_FLAG_INTERLACED | AV_FRAME_FLAG_TOP_FIELD_FIRST);
+
+	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(src->format);
+	int bytes = desc->comp[0].depth > 8 ? 2 : 1;
+	const struct line_kernels *kernels = get_line_kernels(bytes == 2);
+
+	/* Lines of this parity belong to the field being kept */
+	bool top_first = (src->flags & AV_FRAME_FLAG_TOP_FIELD_FIRST) != 0;
+	int parity = (field == 0) == top_first ? 0 : 1;
+
+	int planes = av_pix_fmt_count_planes(src->format);
+	for (int p = 0; p < planes; p++) {
+		int line_bytes = av_image_get_linesize(src->format, src->width, p);
+		int count = line_bytes / bytes;
+		int height = p == 1 || p == 2 ? AV_CEIL_RSHIFT(src->height, desc->log2_chroma_h) : src->height;
+		int step = plane_step(desc, p, bytes);
+		int stride = src->linesize[p];
+
+		for (int y = 0; y < height; y++) {
+			const uint8_t *cur = src->data[p] + (ptrdiff_t)y * stride;
+			uint8_t *out = dst->data[p] + (ptrdiff_t)y * dst->linesize[p];
+			/* Neighbours mirror at the top and bottom */
+			const uint8_t *above = y > 0 ? cur - stride : (height > 1 ? cur + stride : cur);
+			const uint8_t *below = y + 1 < height ? cur + stride : (y > 0 ? cur - stride : cur);
+
+			if (mode == DEINTERLACE_BLEND)
+				kernels->blend(out, above, cur, below, count);
+			else if ((y & 1) == parity || height == 1)
+				memcpy(out, cur, line_bytes);
+			else if (mode == DEINTERLACE_EDGE)
+				kernels->edge(out, above, below, count, step);
+			else
+				kernels->interp(out, above, below, count);
+		}
+	}
+	return dst;
+}
@@ -0,0 +1,41 @@
+/*
+ * Deinterlacing of interlaced software frames
+ * An interlaced frame holds two fields captured half a frame apart, one in
+ * its even lines and one in its odd lines. Blend filters them into one
+ * progressive frame at the frame rate. Bob and edge-directed rebuild each
+ * field into a full frame of its own, doubling the frame rate (50i to 50p)
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+
+#ifdef __cplusplus
+}
+#endif
+
+enum deinterlace_mode {
+	DEINTERLACE_OFF,
+	DEINTERLACE_BLEND,          /* Frame rate, lines filtered [1 2 1] vertically */
+	DEINTERLACE_BOB,            /* Field rate, missing lines averaged from their neighbours */
+	DEINTERLACE_EDGE,           /* Field rate, missing lines interpolated along edges (ELA) */
+};
+
+/* Planar and semi-planar little-endian formats up to 16 bits */
+bool deinterlace_supported(enum AVPixelFormat format);
+
+/* Whether the mode outputs both fields of every frame */
+bool deinterlace_field_rate(enum deinterlace_mode mode);
+
+/* New progressive frame from src, with its properties but no longer marked
+ * interlaced. Field 0 is the first in time, 1 the second, blend ignores it.
+ * NULL for unsupported formats or on allocation failure */
+AVFrame *deinterlace_frame(const AVFrame *src, enum deinterlace_mode mode, int field);
@@ -0,0 +1,187 @@
+/*
+ * UDP beacon backend for multi-host timeline epoch sync
+ * The leader sends the epoch to host:port once a second (unicast, or a
+ * broadcast address to reach every host on the subnet). Followers listen
+ * on the port without blocking and keep the latest beacon
+ */
+
+#include "epoch-sync.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#endif
+
+#define blog(level, format, ...) \
+	blog(level, "[Epoch Sync] " format, ##__VA_ARGS__)
+
+#define BEACON_INTERVAL_NS 1000000000ULL
+
+struct udp_provider {
+	socket_t sock;
+	struct sockaddr_in dest;   /* Leader only */
+};
+
+/* Split "host:port" (host optional for followers) and resolve it */
+static bool resolve_address(const char *address, struct sockaddr_in *out)
+{
+	const char *colon = strrchr(address, ':');
+	const char *port_str = colon ? colon + 1 : address;
+	int port = atoi(port_str);
+	if (port <= 0 || port > 65535)
+		return false;
+
+	memset(out, 0, sizeof(*out));
+	out->sin_family = AF_INET;
+	out->sin_port = htons((unsigned short)port);
+	out->sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if (!colon || colon == address)
+		return true;
+
+	char host[256];
+	size_t len = (size_t)(colon - address);
+	if (len >= sizeof(host))
+		return false;
+	memcpy(host, address, len);
+	host[len] = 0;
+
+	struct addrinfo hints = {0};
+	struct addrinfo *result = NULL;
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	if (getaddrinfo(host, NULL, &hints, &result) != 0 || !result)
+		return false;
+
+	out->sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
+	freeaddrinfo(result);
+	return true;
+}
+
+static bool set_nonblocking(socket_t sock)
+{
+#ifdef _WIN32
+	u_long mode = 1;
+	return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+	int flags = fcntl(sock, F_GETFL, 0);
+	return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+static void udp_destroy(void *data);
+
+static void *udp_create(const char *address, enum epoch_sync_role role)
+{
+#ifdef _WIN32
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+		return NULL;
+#endif
+
+	struct udp_provider *up = bzalloc(sizeof(struct udp_provider));
+	up->sock = INVALID_SOCKET;
+
+	struct sockaddr_in addr;
+	if (!address || !resolve_address(address, &addr)) {
+		blog(LOG_WARNING, "Invalid beacon address '%s' (expected host:port)", address ? address : "");
+		udp_destroy(up);
+		return NULL;
+	}
+
+	up->sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (up->sock == INVALID_SOCKET) {
+		udp_destroy(up);
+		return NULL;
+	}
+
+	int one = 1;
+	if (role == EPOCH_SYNC_LEADER) {
+		/* Allow broadcast destinations */
+		setsockopt(up->sock, SOL_SOCKET, SO_BROADCAST, (const char *)&one, sizeof(one));
+		up->dest = addr;
+	} else {
+		setsockopt(up->sock, SOL_SOCKET, SO_REUSEADDR, (const char *)&one, sizeof(one));
+		/* Listen on every interface; the host part only matters to the leader */
+		addr.sin_addr.s_addr = htonl(INADDR_ANY);
+		if (bind(up->sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+			blog(LOG_WARNING, "Failed to bind beacon port %d", ntohs(addr.sin_port));
+			udp_destroy(up);
+			return NULL;
+		}
+	}
+
+	if (!set_nonblocking(up->sock)) {
+		udp_destroy(up);
+		return NULL;
+	}
+
+	return up;
+}
+
+static void udp_destroy(void *data)
+{
+	struct udp_provider *up = data;
+	if (up->sock != INVALID_SOCKET)
+		close_socket(up->sock);
+	bfree(up);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+static bool udp_publish(void *data, const struct sync_epoch *epoch)
+{
+	struct udp_provider *up = data;
+	char buf[256];
+	int len = epoch_sync_format(epoch, buf, sizeof(buf));
+
+	return sendto(up->sock, buf, len, 0, (struct sockaddr *)&up->dest, sizeof(up->dest)) == len;
+}
+
+static bool udp_poll(void *data, struct sync_epoch *out)
+{
+	struct udp_provider *up = data;
+	char buf[256];
+	bool found = false;
+
+	/* Drain queued beacons, only the newest matters */
+	for (;;) {
+		int len = (int)recvfrom(up->sock, buf, sizeof(buf) - 1, 0, NULL, NULL);
+		if (len <= 0)
+			break;
+		buf[len] = 0;
+
+		struct sync_epoch epoch;
+		if (epoch_sync_parse(buf, &epoch)) {
+			*out = epoch;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+const struct epoch_provider epoch_provider_udp = {
+	.name = "udp",
+	.create = udp_create,
+	.destroy = udp_destroy,
+	.publish = udp_publish,
+	.poll = udp_poll,
+	.republish_interval_ns = BEACON_INTERVAL_NS,
+};
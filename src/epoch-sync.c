@@ -0,0 +1,523 @@
+/*
+ * Multi-host timeline epoch sync implementation and file backend
+ */
+
+#include "epoch-sync.h"
+#include "shared-timeline.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define blog(level, format, ...) \
+	blog(level, "[Epoch Sync] " format, ##__VA_ARGS__)
+
+#define EPOCH_SYNC_INTERVAL_NS 500000000ULL
+#define EPOCH_SYNC_INTERVAL_MS 500
+/* Followers ignore differences below this, mapping jitter between clocks */
+#define EPOCH_ADOPT_MIN_MS 2
+#define EPOCH_WIRE_TAG "fmgnice-epoch"
+#define EPOCH_WIRE_VERSION 1
+
+/* A source asking for a backend */
+struct sync_user {
+	const void *user;
+	enum epoch_sync_backend backend;
+	enum epoch_sync_role role;
+	char *address;
+};
+
+/* Runs the provider's publish and poll, so a slow or stalled share never
+ * holds up the video tick. The tick only swaps epochs with it */
+struct sync_worker {
+	const struct epoch_provider *provider;
+	void *data;
+	enum epoch_sync_role role;
+	pthread_t thread;
+	os_event_t *wake;             /* An epoch to publish, or stopping */
+	volatile bool stopping;
+
+	/* Guarded by g_sync_mutex */
+	struct sync_epoch outbox;     /* Leader: next epoch to publish */
+	bool outbox_full;
+	struct sync_epoch inbox;      /* Follower: newest epoch received */
+	bool inbox_full;
+};
+
+static pthread_mutex_t g_sync_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct sync_user) g_users;   /* In claim order, the first owns the provider */
+static struct sync_worker *g_worker = NULL;
+static enum epoch_sync_backend g_backend = EPOCH_SYNC_OFF;
+static enum epoch_sync_role g_role = EPOCH_SYNC_LEADER;
+static char *g_address = NULL;
+static uint64_t g_last_tick = 0;
+static uint64_t g_last_publish = 0;
+static struct shared_timeline_state g_published = {0};
+static uint32_t g_generation = 0;
+static uint32_t g_adopted_generation = 0;
+
+/* ------------------------------------------------------------------------- */
+/* Clock mapping */
+
+static int64_t realtime_ns(void)
+{
+#ifdef _WIN32
+	FILETIME ft;
+	GetSystemTimePreciseAsFileTime(&ft);
+	uint64_t t = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+	/* 100ns intervals since 1601 */
+	return (int64_t)(t - 116444736000000000ULL) * 100;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+/* Realtime minus monotonic, from the tightest of a few bracketed samples */
+static int64_t realtime_offset_ns(void)
+{
+	int64_t best_offset = 0;
+	uint64_t best_width = UINT64_MAX;
+
+	for (int i = 0; i < 3; i++) {
+		uint64_t before = os_gettime_ns();
+		int64_t real = realtime_ns();
+		uint64_t after = os_gettime_ns();
+
+		if (after - before < best_width) {
+			best_width = after - before;
+			best_offset = real - (int64_t)(before + best_width / 2);
+		}
+	}
+
+	return best_offset;
+}
+
+int64_t epoch_sync_mono_ms_to_realtime_ns(uint64_t mono_ms)
+{
+	return (int64_t)(mono_ms * 1000000ULL) + realtime_offset_ns();
+}
+
+uint64_t epoch_sync_realtime_ns_to_mono_ms(int64_t realtime_ns)
+{
+	int64_t mono_ns = realtime_ns - realtime_offset_ns();
+	return mono_ns > 0 ? (uint64_t)mono_ns / 1000000ULL : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Wire format */
+
+int epoch_sync_format(const struct sync_epoch *epoch, char *buf, size_t size)
+{
+	return snprintf(buf, size, "%s %d %u %lld %llu %d %lld\n",
+		EPOCH_WIRE_TAG, EPOCH_WIRE_VERSION,
+		epoch->generation,
+		(long long)epoch->epoch_realtime_ns,
+		(unsigned long long)epoch->playlist_hash,
+		epoch->paused ? 1 : 0,
+		(long long)epoch->pause_realtime_ns);
+}
+
+bool epoch_sync_parse(const char *str, struct sync_epoch *out)
+{
+	char tag[32];
+	int version, paused;
+	unsigned int generation;
+	long long epoch_ns, pause_ns;
+	unsigned long long hash;
+
+	if (!str || sscanf(str, "%31s %d %u %lld %llu %d %lld", tag, &version,
+			&generation, &epoch_ns, &hash, &paused, &pause_ns) != 7)
+		return false;
+	if (strcmp(tag, EPOCH_WIRE_TAG) != 0 || version != EPOCH_WIRE_VERSION || epoch_ns <= 0)
+		return false;
+
+	out->generation = generation;
+	out->epoch_realtime_ns = epoch_ns;
+	out->playlist_hash = hash;
+	out->paused = paused != 0;
+	out->pause_realtime_ns = pause_ns;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* File backend - the leader rewrites the file atomically, followers re-read
+ * it every interval. Works over any shared or synced folder */
+
+struct file_provider {
+	char *path;
+};
+
+static void *file_create(const char *address, enum epoch_sync_role role)
+{
+	UNUSED_PARAMETER(role);
+
+	if (!address || !*address)
+		return NULL;
+
+	struct file_provider *fp = bzalloc(sizeof(struct file_provider));
+	fp->path = bstrdup(address);
+	return fp;
+}
+
+static void file_destroy(void *data)
+{
+	struct file_provider *fp = data;
+	bfree(fp->path);
+	bfree(fp);
+}
+
+static bool file_publish(void *data, const struct sync_epoch *epoch)
+{
+	struct file_provider *fp = data;
+	char buf[256];
+	int len = epoch_sync_format(epoch, buf, sizeof(buf));
+
+	/* Written to a temp file and renamed, readers never see a partial epoch */
+	if (!os_quick_write_utf8_file_safe(fp->path, buf, (size_t)len, false, "tmp", NULL)) {
+		blog(LOG_WARNING, "Failed to write epoch file %s", fp->path);
+		return false;
+	}
+	return true;
+}
+
+static bool file_poll(void *data, struct sync_epoch *out)
+{
+	struct file_provider *fp = data;
+	char *text = os_quick_read_utf8_file(fp->path);
+	bool ok = epoch_sync_parse(text, out);
+	bfree(text);
+	return ok;
+}
+
+const struct epoch_provider epoch_provider_file = {
+	.name = "file",
+	.create = file_create,
+	.destroy = file_destroy,
+	.publish = file_publish,
+	.poll = file_poll,
+	.republish_interval_ns = 0,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static void *sync_worker_thread(void *opaque)
+{
+	struct sync_worker *w = opaque;
+
+	os_set_thread_name("fmgnice-epoch-sync");
+
+	while (!w->stopping) {
+		os_event_timedwait(w->wake, EPOCH_SYNC_INTERVAL_MS);
+		if (w->stopping)
+			break;
+
+		if (w->role == EPOCH_SYNC_LEADER) {
+			pthread_mutex_lock(&g_sync_mutex);
+			struct sync_epoch epoch = w->outbox;
+			bool have = w->outbox_full;
+			w->outbox_full = false;
+			pthread_mutex_unlock(&g_sync_mutex);
+
+			if (have && !w->provider->publish(w->data, &epoch)) {
+				/* Retried next interval, unless a newer epoch replaced it */
+				pthread_mutex_lock(&g_sync_mutex);
+				if (!w->outbox_full) {
+					w->outbox = epoch;
+					w->outbox_full = true;
+				}
+				pthread_mutex_unlock(&g_sync_mutex);
+			}
+		} else {
+			struct sync_epoch remote;
+			if (w->provider->poll(w->data, &remote)) {
+				pthread_mutex_lock(&g_sync_mutex);
+				w->inbox = remote;
+				w->inbox_full = true;
+				pthread_mutex_unlock(&g_sync_mutex);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static struct sync_worker *start_worker(const struct epoch_provider *provider, void *data,
+	enum epoch_sync_role role)
+{
+	struct sync_worker *w = bzalloc(sizeof(struct sync_worker));
+	w->provider = provider;
+	w->data = data;
+	w->role = role;
+
+	if (os_event_init(&w->wake, OS_EVENT_TYPE_AUTO) != 0) {
+		bfree(w);
+		return NULL;
+	}
+	if (pthread_create(&w->thread, NULL, sync_worker_thread, w) != 0) {
+		os_event_destroy(w->wake);
+		bfree(w);
+		return NULL;
+	}
+	return w;
+}
+
+/* Not with g_sync_mutex held, the worker takes it */
+static void stop_worker(struct sync_worker *w)
+{
+	if (!w)
+		return;
+
+	w->stopping = true;
+	os_event_signal(w->wake);
+	pthread_join(w->thread, NULL);
+
+	w->provider->destroy(w->data);
+	os_event_destroy(w->wake);
+	bfree(w);
+}
+
+/* Switch the provider to the owner's settings. No-op if nothing changed.
+ * Called with g_sync_mutex held, returns the worker being replaced for the
+ * caller to stop after unlocking */
+static struct sync_worker *apply_owner(void)
+{
+	enum epoch_sync_backend backend = EPOCH_SYNC_OFF;
+	enum epoch_sync_role role = EPOCH_SYNC_LEADER;
+	const char *address = "";
+
+	if (g_users.num) {
+		backend = g_users.array[0].backend;
+		role = g_users.array[0].role;
+		address = g_users.array[0].address;
+	}
+
+	if (backend == g_backend && role == g_role && g_address && strcmp(address, g_address) == 0)
+		return NULL;
+
+	struct sync_worker *old = g_worker;
+	g_worker = NULL;
+	bfree(g_address);
+	g_address = bstrdup(address);
+	g_backend = backend;
+	g_role = role;
+	memset(&g_published, 0, sizeof(g_published));
+	g_adopted_generation = 0;
+
+	const struct epoch_provider *provider = backend == EPOCH_SYNC_FILE ? &epoch_provider_file :
+		backend == EPOCH_SYNC_UDP ? &epoch_provider_udp : NULL;
+
+	if (provider) {
+		void *data = provider->create(address, role);
+		g_worker = data ? start_worker(provider, data, role) : NULL;
+		if (g_worker) {
+			blog(LOG_INFO, "Using %s provider at '%s' as %s", provider->name, address,
+				role == EPOCH_SYNC_LEADER ? "leader" : "follower");
+		} else {
+			if (data)
+				provider->destroy(data);
+			blog(LOG_WARNING, "Failed to start %s provider at '%s'", provider->name, address);
+		}
+	} else if (old) {
+		blog(LOG_INFO, "Multi-host sync off");
+	}
+
+	return old;
+}
+
+static size_t find_user(const void *user)
+{
+	for (size_t i = 0; i < g_users.num; i++) {
+		if (g_users.array[i].user == user)
+			return i;
+	}
+	return DARRAY_INVALID;
+}
+
+static void remove_user(size_t idx)
+{
+	bfree(g_users.array[idx].address);
+	da_erase(g_users, idx);
+}
+
+void epoch_sync_configure(const void *user, enum epoch_sync_backend backend,
+	enum epoch_sync_role role, const char *address)
+{
+	if (!address)
+		address = "";
+
+	pthread_mutex_lock(&g_sync_mutex);
+
+	size_t idx = find_user(user);
+	if (backend == EPOCH_SYNC_OFF) {
+		if (idx != DARRAY_INVALID)
+			remove_user(idx);
+	} else {
+		if (idx == DARRAY_INVALID) {
+			struct sync_user *u = da_push_back_new(g_users);
+			u->user = user;
+			idx = g_users.num - 1;
+		}
+		struct sync_user *u = &g_users.array[idx];
+		bool changed = u->backend != backend || u->role != role || !u->address ||
+			strcmp(u->address, address) != 0;
+		u->backend = backend;
+		u->role = role;
+		if (changed) {
+			bfree(u->address);
+			u->address = bstrdup(address);
+		}
+
+		const struct sync_user *owner = &g_users.array[0];
+		if (changed && idx != 0 && (owner->backend != backend || owner->role != role ||
+		                            strcmp(owner->address, address) != 0))
+			blog(LOG_WARNING, "Multi-host sync is already set up by another source, "
+				"its settings apply until it turns sync off");
+	}
+
+	struct sync_worker *old = apply_owner();
+	pthread_mutex_unlock(&g_sync_mutex);
+
+	stop_worker(old);
+}
+
+void epoch_sync_release(const void *user)
+{
+	struct sync_worker *old = NULL;
+
+	pthread_mutex_lock(&g_sync_mutex);
+	size_t idx = find_user(user);
+	if (idx != DARRAY_INVALID) {
+		remove_user(idx);
+		old = apply_owner();
+	}
+	pthread_mutex_unlock(&g_sync_mutex);
+
+	stop_worker(old);
+}
+
+/* Hand a changed (or due) epoch to the worker. Called with g_sync_mutex held */
+static void publish_epoch(struct sync_worker *w, struct shared_timeline *tl, uint64_t now)
+{
+	struct shared_timeline_state state;
+	if (!shared_timeline_read(tl, &state) || state.epoch_ms == 0)
+		return;
+
+	bool changed = state.epoch_ms != g_published.epoch_ms ||
+		state.paused != g_published.paused ||
+		state.pause_time_ms != g_published.pause_time_ms;
+	bool due = w->provider->republish_interval_ns &&
+		now - g_last_publish >= w->provider->republish_interval_ns;
+
+	if (!changed && !due)
+		return;
+
+	if (changed)
+		g_generation++;
+
+	struct sync_epoch epoch = {
+		.generation = g_generation,
+		.epoch_realtime_ns = epoch_sync_mono_ms_to_realtime_ns(state.epoch_ms),
+		.playlist_hash = state.playlist_hash,
+		.paused = state.paused,
+		.pause_realtime_ns = state.paused ?
+			epoch_sync_mono_ms_to_realtime_ns(state.pause_time_ms) : 0,
+	};
+
+	w->outbox = epoch;
+	w->outbox_full = true;
+	g_published = state;
+	g_last_publish = now;
+	os_event_signal(w->wake);
+}
+
+static inline bool close_ms(uint64_t a, uint64_t b)
+{
+	return (a > b ? a - b : b - a) < EPOCH_ADOPT_MIN_MS;
+}
+
+/* Adopt the newest epoch the worker received. Called with g_sync_mutex held */
+static void adopt_epoch(struct sync_worker *w, struct shared_timeline *tl)
+{
+	if (!w->inbox_full)
+		return;
+
+	struct sync_epoch remote = w->inbox;
+	w->inbox_full = false;
+
+	struct shared_timeline_state target = {
+		.epoch_ms = epoch_sync_realtime_ns_to_mono_ms(remote.epoch_realtime_ns),
+		.playlist_hash = remote.playlist_hash,
+		.paused = remote.paused,
+		.pause_time_ms = remote.paused ?
+			epoch_sync_realtime_ns_to_mono_ms(remote.pause_realtime_ns) : 0,
+	};
+
+	struct shared_timeline_state current = {0};
+	bool have_current = shared_timeline_read(tl, &current);
+	if (have_current &&
+	    current.paused == target.paused &&
+	    close_ms(current.epoch_ms, target.epoch_ms) &&
+	    close_ms(current.pause_time_ms, target.pause_time_ms))
+		return;
+
+	/* Clock mapping drift shows up as small moves of the same generation */
+	int level = remote.generation != g_adopted_generation ? LOG_INFO : LOG_DEBUG;
+	if (have_current) {
+		blog(level, "Adopting epoch generation %u (%lld ms from local)%s", remote.generation,
+			(long long)((int64_t)target.epoch_ms - (int64_t)current.epoch_ms),
+			target.paused ? ", paused" : "");
+	} else {
+		blog(level, "Adopting epoch generation %u%s", remote.generation,
+			target.paused ? ", paused" : "");
+	}
+	g_adopted_generation = remote.generation;
+
+	shared_timeline_adopt(tl, &target);
+}
+
+void epoch_sync_tick(struct shared_timeline *tl)
+{
+	if (!tl)
+		return;
+
+	/* Sources tick on the same thread, but don't rely on it */
+	if (pthread_mutex_trylock(&g_sync_mutex) != 0)
+		return;
+
+	uint64_t now = os_gettime_ns();
+	if (g_worker && now - g_last_tick >= EPOCH_SYNC_INTERVAL_NS) {
+		g_last_tick = now;
+		if (g_role == EPOCH_SYNC_LEADER)
+			publish_epoch(g_worker, tl, now);
+		else
+			adopt_epoch(g_worker, tl);
+	}
+
+	pthread_mutex_unlock(&g_sync_mutex);
+}
+
+void epoch_sync_shutdown(void)
+{
+	pthread_mutex_lock(&g_sync_mutex);
+	while (g_users.num)
+		remove_user(g_users.num - 1);
+	da_free(g_users);
+	struct sync_worker *old = g_worker;
+	g_worker = NULL;
+	bfree(g_address);
+	g_address = NULL;
+	g_backend = EPOCH_SYNC_OFF;
+	pthread_mutex_unlock(&g_sync_mutex);
+
+	stop_worker(old);
+}
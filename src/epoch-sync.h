@@ -0,0 +1,75 @@
+/*
+ * Multi-host timeline epoch sync
+ * A leader publishes the global timeline epoch through a provider backend
+ * (shared file or UDP beacon) and followers on other hosts adopt it. Epochs
+ * travel as realtime (UTC) so they mean the same thing on every host; each
+ * side maps them to and from its own monotonic clock
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct shared_timeline;
+
+enum epoch_sync_backend {
+	EPOCH_SYNC_OFF = 0,
+	EPOCH_SYNC_FILE = 1,   /* Epoch file on a shared path */
+	EPOCH_SYNC_UDP = 2     /* UDP beacon, unicast or broadcast */
+};
+
+enum epoch_sync_role {
+	EPOCH_SYNC_LEADER = 0,    /* Publishes this host's epoch */
+	EPOCH_SYNC_FOLLOWER = 1   /* Adopts the published epoch */
+};
+
+/* Epoch as exchanged between hosts */
+struct sync_epoch {
+	uint32_t generation;         /* Bumped by the leader on every change */
+	int64_t epoch_realtime_ns;   /* Timeline start, ns since the Unix epoch */
+	uint64_t playlist_hash;
+	bool paused;
+	int64_t pause_realtime_ns;
+};
+
+/* Provider backend. create() gets the user's address: a file path, or
+ * host:port for UDP (followers listen on the port). publish and poll run
+ * on the sync worker thread and may block */
+struct epoch_provider {
+	const char *name;
+	void *(*create)(const char *address, enum epoch_sync_role role);
+	void (*destroy)(void *data);
+	bool (*publish)(void *data, const struct sync_epoch *epoch);
+	/* Latest epoch received since the last poll, false if none */
+	bool (*poll)(void *data, struct sync_epoch *out);
+	uint64_t republish_interval_ns;   /* Resend unchanged epochs, 0 = on change only */
+};
+
+extern const struct epoch_provider epoch_provider_file;
+extern const struct epoch_provider epoch_provider_udp;
+
+/* Set a user's (source's) backend. The backend is process-wide: the
+ * earliest user still asking for one owns it and its settings apply,
+ * others share it. EPOCH_SYNC_OFF drops the user's claim, and the provider
+ * closes once no user wants one */
+void epoch_sync_configure(const void *user, enum epoch_sync_backend backend,
+	enum epoch_sync_role role, const char *address);
+
+/* Drop a user's claim, e.g. when its source is destroyed */
+void epoch_sync_release(const void *user);
+
+/* Hand the timeline's epoch to the worker or adopt the one it received,
+ * as due. Never waits on the provider, cheap to call every tick */
+void epoch_sync_tick(struct shared_timeline *tl);
+
+void epoch_sync_shutdown(void);
+
+/* Wire format shared by the backends, returns the length written */
+int epoch_sync_format(const struct sync_epoch *epoch, char *buf, size_t size);
+bool epoch_sync_parse(const char *str, struct sync_epoch *out);
+
+/* Monotonic (os_gettime_ns() / 1000000) <-> realtime mapping */
+int64_t epoch_sync_mono_ms_to_realtime_ns(uint64_t mono_ms);
+uint64_t epoch_sync_realtime_ns_to_mono_ms(int64_t realtime_ns);
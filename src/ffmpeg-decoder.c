@@ -9,11 +9,21 @@
 #include "aligned-memory.h"
 #include "cpu-affinity.h"
 #include "performance-monitor.h"
+#include "decode-policy.h"
+#include "load-governor.h"
+#include "mmap-io.h"
+#include "readahead-io.h"
+#include "stream-cache.h"
+#include "packet-queue.h"
+#include "gop-decoder.h"
+#include "frame-cache.h"
+#include "deinterlace.h"
 #include <obs-module.h>
 #include <util/platform.h>
 #include <util/threading.h>
 #include <util/dstr.h>
 #include <media-io/video-io.h>
+#include <libavutil/mastering_display_metadata.h>
 /* Include Windows atomics through ffmpeg-decoder.h */
 
 #ifdef _WIN32
@@ -25,6 +35,32 @@
 #define blog(level, format, ...) \
 	blog(level, "[FFmpeg Decoder] " format, ##__VA_ARGS__)
 
+/* Packets demuxed ahead of the decoder. Bytes bound intra-only and other
+ * high-bitrate video (ProRes, DNxHR), duration bounds everything else */
+#define PACKET_QUEUE_VIDEO_BYTES       (64LL * 1024 * 1024)
+#define PACKET_QUEUE_VIDEO_DURATION_US 2000000
+#define PACKET_QUEUE_AUDIO_BYTES       (4LL * 1024 * 1024)
+#define PACKET_QUEUE_AUDIO_DURATION_US 2000000
+
+/* Seek planning. Targets further ahead than this always seek. The overhead
+ * (demuxer seek, codec flush, queue refill) is measured, starting from the
+ * default and capped so one stalled read doesn't skew it */
+#define SEEK_PLAN_MAX_FORWARD_US        3000000
+#define SEEK_PLAN_DEFAULT_OVERHEAD_NS   40000000ULL
+#define SEEK_PLAN_MAX_OVERHEAD_NS       500000000ULL
+
+/* Catch-up decodes from the target's keyframe to this far past the target
+ * as parallel GOPs. Intra-only video is split into chunks instead. Frames
+ * waiting for their turn are capped, the GOP being shown is exempt */
+#define CATCHUP_SPAN_US                 2000000
+#define CATCHUP_MAX_GOPS                16
+#define CATCHUP_MAX_WORKERS             4
+#define CATCHUP_INTRA_CHUNK_US          250000
+#define CATCHUP_MAX_BYTES               (256LL * 1024 * 1024)
+
+/* Alpha sources whose converted frames all fit in this are cached whole */
+#define ALPHA_CACHE_MAX_BYTES           (512LL * 1024 * 1024)
+
 /* Memory pool for frame buffers - eliminates per-frame allocations */
 #define FRAME_POOL_SIZE 10
 #define MAX_FRAME_SIZE (3840 * 2160 * 4)  /* 4K BGRA max */
@@ -147,7 +183,10 @@ static void cleanup_frame_pool(void)
 
 /* Forward declarations */
 static void *decoder_thread(void *opaque);
+static void *demux_thread(void *opaque);
 static void *display_thread(void *opaque);
+static void stop_threads(struct ffmpeg_decoder *decoder);
+static void stop_opener(struct ffmpeg_decoder *decoder);
 static enum AVPixelFormat get_hw_format(AVCodecContext *ctx, const enum AVPixelFormat *pix_fmts);
 static bool init_hw_decoder(struct ffmpeg_decoder *decoder, const AVCodec *codec);
 
@@ -159,7 +198,7 @@ static INLINE int64_t get_frame_pts(AVFrame* frame) {
 }
 
 static INLINE bool is_buffer_full(struct ffmpeg_decoder* decoder) {
-	return decoder->buffer.count >= 3;
+	return decoder->buffer.count >= decoder->buffer.depth;
 }
 
 static INLINE uint64_t get_system_time_ns(void) {
@@ -279,52 +318,1355 @@ static int interrupt_callback(void *opaque)
 {
 	struct ffmpeg_decoder *decoder = opaque;
 	/* Return 1 to interrupt FFmpeg operations when we want to stop */
-	return decoder->interrupt_request ? 1 : 0;
+	if (decoder->interrupt_request)
+		return 1;
+	/* An asynchronous open that a newer request has superseded */
+	uint64_t active = decoder->opener.active_id;
+	return active && active != decoder->opener.latest_id ? 1 : 0;
+}
+
+/* Pick how the demuxer reads the file: reader threads for slow storage, a
+ * mapping for other local files. NULL leaves it to FFmpeg's file protocol */
+static void open_custom_io(struct ffmpeg_decoder *decoder, const char *path)
+{
+	pthread_mutex_lock(&decoder->mutex);
+	int mode = decoder->read_ahead_mode;
+	size_t window = (size_t)decoder->read_ahead_mb * 1024 * 1024;
+	pthread_mutex_unlock(&decoder->mutex);
+	
+	bool remote = readahead_io_is_remote(path);
+	decoder->read_ahead_active = false;
+	
+	if (mode == READ_AHEAD_ALWAYS || (mode == READ_AHEAD_REMOTE && remote)) {
+		decoder->custom_io = readahead_io_open(path, window);
+		if (decoder->custom_io) {
+			decoder->custom_io_close = readahead_io_close;
+			decoder->read_ahead_active = true;
+			return;
+		}
+	}
+	
+	/* A mapped file on a share faults if the connection drops */
+	if (!remote) {
+		decoder->custom_io = mmap_io_open(path);
+		decoder->custom_io_close = mmap_io_close;
+	}
+}
+
+/* Close the demuxer and the custom IO behind it, if any */
+static void close_input(struct ffmpeg_decoder *decoder)
+{
+	if (decoder->format_ctx)
+		avformat_close_input(&decoder->format_ctx);
+	if (decoder->custom_io)
+		decoder->custom_io_close(&decoder->custom_io);
+	decoder->read_ahead_active = false;
+}
+
+/* Remember a keyframe time, keeping the list sorted. Called with the mutex held */
+static void add_keyframe(struct ffmpeg_decoder *decoder, int64_t pts_us)
+{
+	size_t lo = 0, hi = decoder->keyframes.num;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (decoder->keyframes.array[mid] < pts_us)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < decoder->keyframes.num && decoder->keyframes.array[lo] == pts_us)
+		return;
+	da_insert(decoder->keyframes, lo, &pts_us);
+}
+
+/* Start the keyframe list from the container index. MP4/MOV list every
+ * sample in the header, other formats fill in as packets are read.
+ * Called before the threads start */
+static void load_keyframe_index(struct ffmpeg_decoder *decoder, AVStream *stream)
+{
+	const AVCodecDescriptor *desc = avcodec_descriptor_get(stream->codecpar->codec_id);
+	
+	da_resize(decoder->keyframes, 0);
+	decoder->intra_only = desc && (desc->props & AV_CODEC_PROP_INTRA_ONLY);
+	decoder->keyframes_complete = false;
+	decoder->demux_position_us = INT64_MIN;
+	decoder->catchup.disabled = false;
+	if (decoder->intra_only)
+		return;
+	
+	int entries = avformat_index_get_nb_entries(stream);
+	int64_t last_us = AV_NOPTS_VALUE;
+	for (int i = 0; i < entries; i++) {
+		const AVIndexEntry *entry = avformat_index_get_entry(stream, i);
+		if (!entry || !(entry->flags & AVINDEX_KEYFRAME) || entry->timestamp == AV_NOPTS_VALUE)
+			continue;
+		last_us = av_rescale_q(entry->timestamp, stream->time_base, AV_TIME_BASE_Q);
+		add_keyframe(decoder, last_us);
+	}
+	
+	/* An index running to the last GOP covers the file */
+	decoder->keyframes_complete = last_us != AV_NOPTS_VALUE && decoder->format_ctx->duration > 0 &&
+		last_us + SEEK_PLAN_MAX_FORWARD_US >= decoder->start_pts_us + decoder->format_ctx->duration;
+	
+	blog(LOG_DEBUG, "Keyframe index: %zu entries%s", decoder->keyframes.num,
+		decoder->keyframes_complete ? " (complete)" : "");
+}
+
+/* Decode forward from the decode position (current_abs) to target_abs,
+ * converting nothing, when that costs less than a seek: the fixed seek
+ * overhead, plus for accurate seeks decoding from the keyframe before the
+ * target. Costs come from the measured decode time. Decoder thread only */
+static bool plan_forward_decode(struct ffmpeg_decoder *decoder, int64_t current_abs, int64_t target_abs,
+	bool accurate)
+{
+	/* Still settling from an earlier seek, or catching up with the demuxer
+	 * behind the decode position - the decode position is no guide */
+	if (decoder->waiting_for_first_frame || decoder->discard_until_pts != AV_NOPTS_VALUE ||
+	    decoder->catchup.active)
+		return false;
+	/* Packets served from the alpha cache left the codec behind */
+	if (decoder->alpha_cache.decoder_behind)
+		return false;
+	if (current_abs == AV_NOPTS_VALUE || target_abs <= current_abs ||
+	    target_abs - current_abs > SEEK_PLAN_MAX_FORWARD_US || !decoder->perf_monitor)
+		return false;
+	/* Keyframe-only rates would run past the target to the next keyframe */
+	if (decoder->rate_skip_frame == AVDISCARD_NONKEY)
+		return false;
+	
+	AVStream *stream = decoder->format_ctx->streams[decoder->video_stream_idx];
+	int64_t frame_us = stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0 ?
+		av_rescale_q(1, av_inv_q(stream->avg_frame_rate), AV_TIME_BASE_Q) : 0;
+	uint64_t decode_ns = ((perf_monitor_t*)decoder->perf_monitor)->avg_decode_time;
+	if (frame_us <= 0 || !decode_ns)
+		return false;
+	
+	uint64_t overhead_ns = decoder->seek_overhead_ns ? decoder->seek_overhead_ns : SEEK_PLAN_DEFAULT_OVERHEAD_NS;
+	uint64_t forward_ns = (uint64_t)((target_abs - current_abs) / frame_us) * decode_ns;
+	
+	/* A keyframe seek shows whatever keyframe it lands on */
+	if (!accurate)
+		return forward_ns < overhead_ns;
+	
+	/* Keyframe the seek would decode from, if the planner knows enough */
+	int64_t keyframe = decoder->intra_only ? target_abs : AV_NOPTS_VALUE;
+	pthread_mutex_lock(&decoder->mutex);
+	bool known = decoder->intra_only || decoder->keyframes_complete ||
+		decoder->demux_position_us >= target_abs;
+	for (size_t i = decoder->keyframes.num; !decoder->intra_only && i > 0; i--) {
+		if (decoder->keyframes.array[i - 1] <= target_abs) {
+			keyframe = decoder->keyframes.array[i - 1];
+			break;
+		}
+	}
+	pthread_mutex_unlock(&decoder->mutex);
+	
+	if (!known)
+		return false;
+	/* The seek would land behind the decode position anyway */
+	if (keyframe == AV_NOPTS_VALUE || keyframe <= current_abs)
+		return true;
+	
+	uint64_t seek_ns = overhead_ns + (uint64_t)((target_abs - keyframe) / frame_us) * decode_ns;
+	return forward_ns < seek_ns;
+}
+
+/* Learn the seek overhead from a seek's time to its first shown frame, less
+ * the frames it decoded on the way. Decoder thread only */
+static void measure_seek(struct ffmpeg_decoder *decoder, uint32_t frames_decoded)
+{
+	if (!decoder->seek_start_time)
+		return;
+	
+	uint64_t elapsed = os_gettime_ns() - decoder->seek_start_time;
+	uint64_t decode_ns = decoder->perf_monitor ?
+		((perf_monitor_t*)decoder->perf_monitor)->avg_decode_time * frames_decoded : 0;
+	uint64_t overhead = elapsed > decode_ns ? elapsed - decode_ns : 0;
+	decoder->seek_start_time = 0;
+	
+	/* A stalled read says little about the next seek */
+	if (overhead > SEEK_PLAN_MAX_OVERHEAD_NS)
+		overhead = SEEK_PLAN_MAX_OVERHEAD_NS;
+	decoder->seek_overhead_ns = decoder->seek_overhead_ns ?
+		(decoder->seek_overhead_ns * 3 + overhead) / 4 : overhead;
+}
+
+/* Reposition the demuxer at the keyframe at or before seek_pts (video stream
+ * time base). Packets read before it are dropped from the queue, and so are
+ * any the demux thread queues before it sees the request. Decoder thread only */
+static void request_demux_seek(struct ffmpeg_decoder *decoder, int64_t seek_pts)
+{
+	pthread_mutex_lock(&decoder->mutex);
+	uint32_t generation = ++decoder->seek_generation;
+	decoder->demux_seek.pending = true;
+	decoder->demux_seek.pts = seek_pts;
+	decoder->demux_seek.generation = generation;
+	pthread_mutex_unlock(&decoder->mutex);
+	
+	packet_queue_flush(decoder->packets, generation);
+}
+
+/* Stop catching up, dropping frames the workers haven't delivered. Decoder
+ * thread, or with the threads stopped */
+static void end_catchup(struct ffmpeg_decoder *decoder)
+{
+	gop_decoder_destroy(decoder->catchup.gops);
+	decoder->catchup.gops = NULL;
+	decoder->catchup.active = false;
+}
+
+/* After an accurate seek, decode from the target's keyframe to
+ * CATCHUP_SPAN_US past the target as GOPs in parallel, so playback reaches
+ * the timeline and refills its buffer sooner. Closed-GOP software decoding
+ * with a known keyframe index only. Decoder thread only */
+static void start_catchup(struct ffmpeg_decoder *decoder, int64_t target_abs)
+{
+	int workers = get_cpu_count() / 2;
+	if (workers > CATCHUP_MAX_WORKERS)
+		workers = CATCHUP_MAX_WORKERS;
+	if (workers < 2 || decoder->catchup.disabled || decoder->hw_decoding_active || !decoder->current_path)
+		return;
+	
+	/* GOP boundaries up to the first one at or past the end of the stretch */
+	int64_t bounds[CATCHUP_MAX_GOPS + 1];
+	int count = 0;
+	int64_t end_abs = target_abs + CATCHUP_SPAN_US;
+	int64_t file_end = decoder->start_pts_us + decoder->duration;
+	
+	if (decoder->intra_only) {
+		for (int64_t t = target_abs; count <= CATCHUP_MAX_GOPS && t < file_end; t += CATCHUP_INTRA_CHUNK_US) {
+			bounds[count++] = t;
+			if (t >= end_abs)
+				break;
+		}
+	} else {
+		pthread_mutex_lock(&decoder->mutex);
+		size_t i = decoder->keyframes.num;
+		while (i > 0 && decoder->keyframes.array[i - 1] > target_abs)
+			i--;
+		for (i = i ? i - 1 : decoder->keyframes.num; decoder->keyframes_complete &&
+		     i < decoder->keyframes.num && count <= CATCHUP_MAX_GOPS; i++) {
+			bounds[count++] = decoder->keyframes.array[i];
+			if (decoder->keyframes.array[i] >= end_abs)
+				break;
+		}
+		pthread_mutex_unlock(&decoder->mutex);
+	}
+	
+	/* A single GOP decodes no faster on its own worker */
+	int gops = count - 1;
+	if (gops < 2)
+		return;
+	
+	decoder->catchup.gops = gop_decoder_start(decoder->current_path, decoder->video_stream_idx,
+		decoder->lowres, bounds, gops, workers, CATCHUP_MAX_BYTES);
+	if (!decoder->catchup.gops)
+		return;
+	
+	decoder->catchup.active = true;
+	decoder->catchup.end_us = bounds[gops];
+	decoder->catchup.target_us = target_abs - decoder->start_pts_us;
+}
+
+/* Whether the alpha cache can hold every frame of the file: no reordering,
+ * so packet and frame pts agree, and a known frame count within the limits.
+ * Called before the threads start */
+static void setup_alpha_cache(struct ffmpeg_decoder *decoder, AVStream *stream)
+{
+	av_frame_free(&decoder->alpha_cache.hit);
+	decoder->alpha_cache.fits = false;
+	decoder->alpha_cache.from_cache = false;
+	decoder->alpha_cache.decoder_behind = false;
+	decoder->alpha_cache.resyncing = false;
+	if (decoder->alpha_cache.cache)
+		frame_cache_invalidate(decoder->alpha_cache.cache);
+	
+	if (decoder->video_codec_ctx->has_b_frames)
+		return;
+	
+	int64_t frames = stream->nb_frames;
+	if (frames <= 0 && decoder->duration > 0 && stream->avg_frame_rate.num > 0)
+		frames = av_rescale_q(decoder->duration, AV_TIME_BASE_Q, av_inv_q(stream->avg_frame_rate));
+	int64_t bytes = frames * stream->codecpar->width * stream->codecpar->height * 4;
+	
+	decoder->alpha_cache.fits = frames > 0 && bytes <= ALPHA_CACHE_MAX_BYTES;
+	if (!decoder->alpha_cache.fits)
+		return;
+	
+	/* Sized for the file, a cache left from a longer one is kept */
+	decoder->alpha_cache.frames = (uint32_t)frames;
+	if (decoder->alpha_cache.cache && decoder->alpha_cache.cache->max_entries < (uint32_t)frames) {
+		frame_cache_destroy(decoder->alpha_cache.cache);
+		bfree(decoder->alpha_cache.cache);
+		decoder->alpha_cache.cache = NULL;
+	}
+}
+
+/* Alpha frame converted to straight-alpha BGRA in one SIMD pass, the way
+ * OBS blends async frames. NULL without a kernel for the format */
+static AVFrame *convert_alpha_to_bgra(const AVFrame *src)
+{
+	yuva_convert_func convert8 = NULL;
+	yuva16_convert_func convert16 = NULL;
+	packed_convert_func convert_packed = NULL;
+	
+	switch (src->format) {
+	case AV_PIX_FMT_YUVA420P:
+		convert8 = simd_get_best_yuva420_converter();
+		break;
+	case AV_PIX_FMT_YUVA444P:
+		convert8 = simd_get_best_yuva444_converter();
+		break;
+	case AV_PIX_FMT_YUVA444P10LE:
+		convert16 = simd_get_best_yuva444p10_converter();
+		break;
+	case AV_PIX_FMT_YUVA444P12LE:
+		convert16 = simd_get_best_yuva444p12_converter();
+		break;
+	case AV_PIX_FMT_ARGB:
+		convert_packed = simd_get_best_argb_converter();
+		break;
+	default:
+		break;
+	}
+	if (!convert8 && !convert16 && !convert_packed)
+		return NULL;
+	
+	AVFrame *dst = av_frame_alloc();
+	if (!dst)
+		return NULL;
+	
+	dst->format = AV_PIX_FMT_BGRA;
+	dst->width = src->width;
+	dst->height = src->height;
+	if (av_frame_get_buffer(dst, 0) < 0 || av_frame_copy_props(dst, src) < 0) {
+		av_frame_free(&dst);
+		return NULL;
+	}
+	
+	if (convert8) {
+		convert8(src->data[0], src->linesize[0], src->data[1], src->linesize[1],
+		         src->data[2], src->linesize[2], src->data[3], src->linesize[3],
+		         dst->data[0], dst->linesize[0], src->width, src->height, false);
+	} else if (convert16) {
+		convert16((const uint16_t*)src->data[0], src->linesize[0],
+		          (const uint16_t*)src->data[1], src->linesize[1],
+		          (const uint16_t*)src->data[2], src->linesize[2],
+		          (const uint16_t*)src->data[3], src->linesize[3],
+		          dst->data[0], dst->linesize[0], src->width, src->height, false);
+	} else {
+		convert_packed(src->data[0], src->linesize[0], dst->data[0], dst->linesize[0],
+		               src->width, src->height);
+	}
+	return dst;
+}
+
+/* Keep a converted alpha frame for later passes of the loop */
+static void cache_alpha_frame(struct ffmpeg_decoder *decoder, AVFrame *frame)
+{
+	if (!decoder->alpha_cache.fits || !decoder->cache_admission || frame->pts == AV_NOPTS_VALUE)
+		return;
+	
+	if (!decoder->alpha_cache.cache) {
+		decoder->alpha_cache.cache = bzalloc(sizeof(struct frame_cache));
+		frame_cache_init(decoder->alpha_cache.cache, false, decoder->alpha_cache.frames);
+	}
+	frame_cache_put(decoder->alpha_cache.cache, frame, frame->pts, NULL, NULL,
+		frame->width, frame->height);
+}
+
+/* Look the packet's frame up in the alpha cache before decoding. Returns 1
+ * if it is served from the cache, 0 to decode it, -1 to drop it: after
+ * served packets an inter-coded stream lacks the references for a miss, so
+ * it is sought back to that frame instead. Decoder thread only */
+static int use_alpha_cache(struct ffmpeg_decoder *decoder, AVPacket *packet)
+{
+	decoder->alpha_cache.from_cache = false;
+	if (!decoder->alpha_cache.cache || !decoder->alpha_cache.fits || decoder->alpha_cache.resyncing ||
+	    decoder->catchup.active || packet->pts == AV_NOPTS_VALUE)
+		return 0;
+	
+	decoder->alpha_cache.hit = frame_cache_ref(decoder->alpha_cache.cache, packet->pts);
+	if (decoder->alpha_cache.hit) {
+		decoder->alpha_cache.from_cache = true;
+		decoder->alpha_cache.decoder_behind = true;
+		return 1;
+	}
+	
+	if (!decoder->alpha_cache.decoder_behind || decoder->intra_only)
+		return 0;
+	
+	AVStream *stream = decoder->format_ctx->streams[decoder->video_stream_idx];
+	int64_t target = av_rescale_q(packet->pts, stream->time_base, AV_TIME_BASE_Q) - decoder->start_pts_us;
+	decoder->alpha_cache.resyncing = true;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	if (!atomic_load(&decoder->seek_request)) {
+		decoder->seek_target = target;
+		decoder->seek_target_accurate = true;
+		atomic_store(&decoder->seek_request, true);
+	}
+	pthread_mutex_unlock(&decoder->mutex);
+	return -1;
+}
+
+/* Interlaced frames are replaced by their deinterlaced version in
+ * decoder->frame. Field-rate modes return the first field and keep the
+ * second for the next receive_video_frame, half a frame later */
+static AVFrame *deinterlace_decoded(struct ffmpeg_decoder *decoder, AVFrame *frame)
+{
+	enum deinterlace_mode mode = (enum deinterlace_mode)atomic_load(&decoder->deinterlace.mode);
+	if (mode == DEINTERLACE_OFF || !(frame->flags & AV_FRAME_FLAG_INTERLACED) ||
+	    !deinterlace_supported(frame->format))
+		return frame;
+	
+	AVFrame *first = deinterlace_frame(frame, mode, 0);
+	if (!first)
+		return frame;
+	
+	if (deinterlace_field_rate(mode)) {
+		AVStream *stream = decoder->format_ctx->streams[decoder->video_stream_idx];
+		int64_t frame_us = frame->duration > 0 ?
+			av_rescale_q(frame->duration, stream->time_base, AV_TIME_BASE_Q) :
+			stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0 ?
+			av_rescale_q(1, av_inv_q(stream->avg_frame_rate), AV_TIME_BASE_Q) : 0;
+		
+		/* Without a frame duration there is nowhere to put the second field */
+		av_frame_free(&decoder->deinterlace.pending);
+		if (frame_us > 0) {
+			decoder->deinterlace.pending = deinterlace_frame(frame, mode, 1);
+			decoder->deinterlace.pending_offset_us = frame_us / 2;
+		}
+	}
+	
+	if (!decoder->deinterlace.active) {
+		decoder->deinterlace.active = true;
+		blog(LOG_INFO, "[FFmpeg Decoder] Deinterlacing %s %s, %s",
+			av_get_pix_fmt_name(frame->format),
+			frame->flags & AV_FRAME_FLAG_TOP_FIELD_FIRST ? "top field first" : "bottom field first",
+			mode == DEINTERLACE_BLEND ? "blend" : mode == DEINTERLACE_BOB ? "bob at field rate" :
+			"edge-directed at field rate");
+	}
+	
+	av_frame_unref(decoder->frame);
+	av_frame_move_ref(decoder->frame, first);
+	av_frame_free(&first);
+	return decoder->frame;
+}
+
+/* Next decoded video frame into decoder->frame - from the codec, or while
+ * catching up from the GOP workers. Until the stretch's closing keyframe
+ * is demuxed only frames already decoded are taken, so audio keeps flowing;
+ * at that packet the rest are waited for and the codec takes over from it.
+ * Returns 0 or a negative AVERROR like avcodec_receive_frame */
+static int receive_video_frame(struct ffmpeg_decoder *decoder, AVPacket *packet)
+{
+	/* Second field of a frame deinterlaced at field rate */
+	decoder->deinterlace.field_offset_us = 0;
+	if (decoder->deinterlace.pending) {
+		av_frame_unref(decoder->frame);
+		av_frame_move_ref(decoder->frame, decoder->deinterlace.pending);
+		av_frame_free(&decoder->deinterlace.pending);
+		decoder->deinterlace.field_offset_us = decoder->deinterlace.pending_offset_us;
+		return 0;
+	}
+	
+	/* A packet served from the alpha cache yields just its cached frame */
+	if (decoder->alpha_cache.from_cache) {
+		if (!decoder->alpha_cache.hit)
+			return AVERROR(EAGAIN);
+		av_frame_unref(decoder->frame);
+		av_frame_move_ref(decoder->frame, decoder->alpha_cache.hit);
+		av_frame_free(&decoder->alpha_cache.hit);
+		return 0;
+	}
+	
+	if (!decoder->catchup.active)
+		return avcodec_receive_frame(decoder->video_codec_ctx, decoder->frame);
+	
+	AVStream *stream = decoder->format_ctx->streams[decoder->video_stream_idx];
+	int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+	bool past = (packet->flags & AV_PKT_FLAG_KEY) && pts != AV_NOPTS_VALUE &&
+		av_rescale_q(pts, stream->time_base, AV_TIME_BASE_Q) >= decoder->catchup.end_us;
+	
+	if (decoder->catchup.gops) {
+		int ret = gop_decoder_receive(decoder->catchup.gops, decoder->frame, past);
+		if (ret > 0)
+			return 0;
+		if (ret == 0)
+			return AVERROR(EAGAIN);
+		
+		/* The packets for the stretch are gone, so seek to it again */
+		if (gop_decoder_failed(decoder->catchup.gops) || gop_decoder_open_gop(decoder->catchup.gops)) {
+			blog(LOG_INFO, "Catch-up abandoned (%s), seeking normally",
+				gop_decoder_open_gop(decoder->catchup.gops) ? "open GOPs" : "worker failed");
+			int64_t target = decoder->catchup.target_us;
+			decoder->catchup.disabled = true;
+			end_catchup(decoder);
+			
+			pthread_mutex_lock(&decoder->mutex);
+			if (!atomic_load(&decoder->seek_request)) {
+				decoder->seek_target = target;
+				decoder->seek_target_accurate = true;
+				atomic_store(&decoder->seek_request, true);
+			}
+			pthread_mutex_unlock(&decoder->mutex);
+			return AVERROR(EAGAIN);
+		}
+		
+		/* Every GOP delivered */
+		gop_decoder_destroy(decoder->catchup.gops);
+		decoder->catchup.gops = NULL;
+	}
+	if (!past)
+		return AVERROR(EAGAIN);
+	
+	/* The stretch is shown, decode on from its closing keyframe */
+	decoder->catchup.active = false;
+	avcodec_flush_buffers(decoder->video_codec_ctx);
+	int ret = avcodec_send_packet(decoder->video_codec_ctx, packet);
+	if (ret < 0)
+		return ret;
+	return avcodec_receive_frame(decoder->video_codec_ctx, decoder->frame);
+}
+
+/* Clock system implementation (VLC-style frame pacing)
+ * Master clock for both streams: maps media PTS (us) to os_gettime_ns() time */
+static inline uint64_t clock_get_system_time_for_pts(struct ffmpeg_decoder *decoder, int64_t pts)
+{
+	pthread_mutex_lock(&decoder->clock.lock);
+	
+	/* Convert PTS to system time */
+	int64_t pts_delta = pts - decoder->clock.media_start_pts;
+	
+	/* Apply playback rate */
+	double system_delta_ns = (double)pts_delta * 1000.0 / decoder->clock.playback_rate;
+	
+	/* Calculate target system time */
+	uint64_t target_time = (uint64_t)((int64_t)decoder->clock.system_start + (int64_t)system_delta_ns);
+	
+	pthread_mutex_unlock(&decoder->clock.lock);
+	
+	return target_time;
+}
+
+static inline void clock_reset(struct ffmpeg_decoder *decoder, int64_t start_pts)
+{
+	pthread_mutex_lock(&decoder->clock.lock);
+	
+	decoder->clock.system_start = os_gettime_ns();
+	decoder->clock.media_start_pts = start_pts;
+	decoder->clock.last_pts = start_pts;
+	decoder->clock.last_system = decoder->clock.system_start;
+	
+	blog(LOG_INFO, "Clock reset: system_start=%llu ms, media_start=%lld us", 
+		(unsigned long long)(decoder->clock.system_start / 1000000),
+		(long long)start_pts);
+	
+	pthread_mutex_unlock(&decoder->clock.lock);
+}
+
+/* Change rate without moving the media position the clock maps "now" to */
+static inline void clock_set_rate(struct ffmpeg_decoder *decoder, double rate)
+{
+	pthread_mutex_lock(&decoder->clock.lock);
+	
+	if (decoder->clock.system_start) {
+		uint64_t now = os_gettime_ns();
+		if (now > decoder->clock.system_start) {
+			double elapsed_ns = (double)(now - decoder->clock.system_start);
+			decoder->clock.media_start_pts += (int64_t)(elapsed_ns / 1000.0 * decoder->clock.playback_rate);
+			decoder->clock.system_start = now;
+		}
+	}
+	decoder->clock.playback_rate = rate;
+	
+	pthread_mutex_unlock(&decoder->clock.lock);
+}
+
+/* Move the clock's system-time origin (audio-master drift correction) */
+static inline void clock_slew(struct ffmpeg_decoder *decoder, int64_t delta_ns)
+{
+	pthread_mutex_lock(&decoder->clock.lock);
+	decoder->clock.system_start = (uint64_t)((int64_t)decoder->clock.system_start + delta_ns);
+	pthread_mutex_unlock(&decoder->clock.lock);
+}
+
+static inline void clock_update(struct ffmpeg_decoder *decoder, int64_t pts)
+{
+	pthread_mutex_lock(&decoder->clock.lock);
+	
+	decoder->clock.last_pts = pts;
+	decoder->clock.last_system = os_gettime_ns();
+	
+	pthread_mutex_unlock(&decoder->clock.lock);
+}
+
+/* Aspect-corrected native size fitted into the target box (never upscaled) */
+static void get_target_output_size(struct ffmpeg_decoder *decoder, int *width, int *height)
+{
+	/* Stream parameters keep the native size even when the codec runs lowres */
+	AVCodecParameters *par = decoder->format_ctx->streams[decoder->video_stream_idx]->codecpar;
+	int w = decoder->needs_aspect_correction ? decoder->adjusted_width : par->width;
+	int h = decoder->needs_aspect_correction ? decoder->adjusted_height : par->height;
+	
+	if (decoder->target_width > 0 && decoder->target_height > 0 &&
+	    (w > decoder->target_width || h > decoder->target_height)) {
+		double scale_w = (double)decoder->target_width / w;
+		double scale_h = (double)decoder->target_height / h;
+		double scale = scale_w < scale_h ? scale_w : scale_h;
+		w = ((int)(w * scale + 0.5)) & ~1;
+		h = ((int)(h * scale + 0.5)) & ~1;
+		if (w < 16) w = 16;
+		if (h < 16) h = 16;
+	}
+	
+	*width = w;
+	*height = h;
+}
+
+/* BGRA output size: target size reduced by the governor's divisor */
+static void get_output_size(struct ffmpeg_decoder *decoder, int *width, int *height)
+{
+	int w, h;
+	get_target_output_size(decoder, &w, &h);
+	
+	if (decoder->scale_divisor > 1) {
+		w = (w / decoder->scale_divisor) & ~1;
+		h = (h / decoder->scale_divisor) & ~1;
+		if (w < 16) w = 16;
+		if (h < 16) h = 16;
+	}
+	
+	*width = w;
+	*height = h;
+}
+
+/* Largest decoded audio frame we size the resample buffer for up front.
+ * Covers AAC/MP3/AC-3/Opus/FLAC frames; PCM packets larger than this are
+ * still handled by growing the buffer. */
+#define AUDIO_MAX_INPUT_SAMPLES 8192
+
+/* Channel layout in the order OBS expects for each speaker setup */
+static bool speaker_layout_to_ch_layout(enum speaker_layout speakers, AVChannelLayout *layout)
+{
+	static const AVChannelLayout mono = AV_CHANNEL_LAYOUT_MONO;
+	static const AVChannelLayout stereo = AV_CHANNEL_LAYOUT_STEREO;
+	static const AVChannelLayout l2point1 = AV_CHANNEL_LAYOUT_2POINT1;
+	static const AVChannelLayout l4point0 = AV_CHANNEL_LAYOUT_4POINT0;
+	static const AVChannelLayout l4point1 = AV_CHANNEL_LAYOUT_4POINT1;
+	static const AVChannelLayout l5point1 = AV_CHANNEL_LAYOUT_5POINT1_BACK;
+	static const AVChannelLayout l7point1 = AV_CHANNEL_LAYOUT_7POINT1;
+	
+	switch (speakers) {
+	case SPEAKERS_MONO:    *layout = mono;     return true;
+	case SPEAKERS_STEREO:  *layout = stereo;   return true;
+	case SPEAKERS_2POINT1: *layout = l2point1; return true;
+	case SPEAKERS_4POINT0: *layout = l4point0; return true;
+	case SPEAKERS_4POINT1: *layout = l4point1; return true;
+	case SPEAKERS_5POINT1: *layout = l5point1; return true;
+	case SPEAKERS_7POINT1: *layout = l7point1; return true;
+	default:               return false;
+	}
+}
+
+/* Make room for at least out_samples per channel in the resample buffer */
+static bool ensure_resample_capacity(struct ffmpeg_decoder *decoder, int out_samples)
+{
+	if (decoder->resampled_audio_data[0] && out_samples <= decoder->max_resampled_samples)
+		return true;
+	
+	if (decoder->resampled_audio_data[0])
+		av_freep(&decoder->resampled_audio_data[0]);
+	memset(decoder->resampled_audio_data, 0, sizeof(decoder->resampled_audio_data));
+	decoder->max_resampled_samples = 0;
+	
+	int ret = av_samples_alloc(decoder->resampled_audio_data,
+		&decoder->resampled_audio_linesize,
+		decoder->audio_out_channels, out_samples,
+		AV_SAMPLE_FMT_FLTP, 0);
+	if (ret < 0) {
+		blog(LOG_ERROR, "Failed to allocate resampled audio buffer: %s", av_err2str(ret));
+		return false;
+	}
+	
+	decoder->max_resampled_samples = out_samples;
+	return true;
+}
+
+/* Resample once, straight to OBS's output rate and speaker layout.
+ * compensate keeps a resampler even when formats match, for drift correction */
+static void setup_audio_resampler(struct ffmpeg_decoder *decoder, bool compensate)
+{
+	AVCodecContext *ctx = decoder->audio_codec_ctx;
+	
+	if (decoder->swr_ctx)
+		swr_free(&decoder->swr_ctx);
+	
+	struct obs_audio_info oai;
+	AVChannelLayout out_layout;
+	if (!obs_get_audio_info(&oai) || !speaker_layout_to_ch_layout(oai.speakers, &out_layout)) {
+		oai.samples_per_sec = ctx->sample_rate;
+		oai.speakers = SPEAKERS_STEREO;
+		speaker_layout_to_ch_layout(SPEAKERS_STEREO, &out_layout);
+	}
+	
+	decoder->audio_out_sample_rate = oai.samples_per_sec;
+	decoder->audio_out_speakers = oai.speakers;
+	decoder->audio_out_channels = out_layout.nb_channels;
+	
+	decoder->sync.compensating = false;
+	
+	/* Already in OBS's format - pass decoded frames straight through */
+	if (!compensate && ctx->sample_fmt == AV_SAMPLE_FMT_FLTP &&
+	    ctx->sample_rate == (int)decoder->audio_out_sample_rate &&
+	    av_channel_layout_compare(&ctx->ch_layout, &out_layout) == 0) {
+		blog(LOG_INFO, "Audio already matches output (FLTP %dHz %dch), no resampling",
+			ctx->sample_rate, decoder->audio_out_channels);
+		return;
+	}
+	
+	/* swresample's rematrix and rate conversion have SIMD paths, so the
+	 * 5.1 -> stereo downmix costs no extra pass */
+	int ret = swr_alloc_set_opts2(&decoder->swr_ctx,
+		&out_layout, AV_SAMPLE_FMT_FLTP, decoder->audio_out_sample_rate,
+		&ctx->ch_layout, ctx->sample_fmt, ctx->sample_rate,
+		0, NULL);
+	if (ret >= 0 && compensate)
+		av_opt_set_int(decoder->swr_ctx, "flags", SWR_FLAG_RESAMPLE, 0);
+	if (ret < 0 || swr_init(decoder->swr_ctx) < 0) {
+		blog(LOG_WARNING, "Failed to initialize audio resampler");
+		swr_free(&decoder->swr_ctx);
+		return;
+	}
+	
+	/* Size for the largest frame up front so steady state never reallocates */
+	int in_samples = ctx->frame_size > AUDIO_MAX_INPUT_SAMPLES ? ctx->frame_size : AUDIO_MAX_INPUT_SAMPLES;
+	if (!ensure_resample_capacity(decoder, swr_get_out_samples(decoder->swr_ctx, in_samples))) {
+		swr_free(&decoder->swr_ctx);
+		return;
+	}
+	
+	blog(LOG_INFO, "Audio resampler initialized: %s %dHz %dch -> FLTP %uHz %dch",
+		av_get_sample_fmt_name(ctx->sample_fmt), ctx->sample_rate, ctx->ch_layout.nb_channels,
+		decoder->audio_out_sample_rate, decoder->audio_out_channels);
+}
+
+/* Create (or recreate) the BGRA output scaler with the policy's algorithm
+ * and slice thread count. Source parameters are remembered so the scaler
+ * can be rebuilt when the policy changes. */
+static bool create_bgra_scaler(struct ffmpeg_decoder *decoder,
+	int src_width, int src_height, enum AVPixelFormat src_format)
+{
+	int dst_width, dst_height;
+	get_output_size(decoder, &dst_width, &dst_height);
+	
+	if (decoder->sws_ctx) {
+		sws_freeContext(decoder->sws_ctx);
+		decoder->sws_ctx = NULL;
+	}
+	
+	struct SwsContext *ctx = sws_alloc_context();
+	if (!ctx)
+		return false;
+	
+	av_opt_set_int(ctx, "srcw", src_width, 0);
+	av_opt_set_int(ctx, "srch", src_height, 0);
+	av_opt_set_int(ctx, "src_format", src_format, 0);
+	av_opt_set_int(ctx, "dstw", dst_width, 0);
+	av_opt_set_int(ctx, "dsth", dst_height, 0);
+	av_opt_set_int(ctx, "dst_format", AV_PIX_FMT_BGRA, 0);
+	av_opt_set_int(ctx, "sws_flags", decoder->sws_flags, 0);
+	/* Slice threading is only available in newer swscale, ignore failure */
+	av_opt_set_int(ctx, "threads", decoder->sws_threads, 0);
+	
+	if (sws_init_context(ctx, NULL, NULL) < 0) {
+		sws_freeContext(ctx);
+		return false;
+	}
+	
+	decoder->sws_ctx = ctx;
+	decoder->sws_src_width = src_width;
+	decoder->sws_src_height = src_height;
+	decoder->sws_src_format = src_format;
+	return true;
+}
+
+#if LIBSWSCALE_VERSION_MAJOR >= 6
+static void scale_buffer_free(void *opaque, uint8_t *data)
+{
+	(void)opaque;
+	(void)data;
+}
+#endif
+
+/* Scale into a buffered frame's BGRA planes. Returns output height on success.
+ * sws_scale() never uses slice threads, so go through sws_scale_frame()
+ * when the policy asks for threaded conversion. */
+static int scale_to_bgra(struct ffmpeg_decoder *decoder, const AVFrame *src,
+	struct buffered_frame *buf_frame)
+{
+#if LIBSWSCALE_VERSION_MAJOR >= 6
+	if (decoder->sws_threads != 1 && src->buf[0]) {
+		if (!decoder->scale_frame)
+			decoder->scale_frame = av_frame_alloc();
+		
+		AVFrame *dst = decoder->scale_frame;
+		if (dst) {
+			int dst_height = buf_frame->height;
+			
+			/* Wrap our own buffer without transferring ownership */
+			dst->buf[0] = av_buffer_create(buf_frame->bgra_data[0],
+				(size_t)buf_frame->bgra_linesize[0] * dst_height,
+				scale_buffer_free, NULL, 0);
+			if (dst->buf[0]) {
+				dst->format = AV_PIX_FMT_BGRA;
+				dst->width = buf_frame->width;
+				dst->height = dst_height;
+				dst->data[0] = buf_frame->bgra_data[0];
+				dst->linesize[0] = (int)buf_frame->bgra_linesize[0];
+				
+				int ret = sws_scale_frame(decoder->sws_ctx, dst, src);
+				av_frame_unref(dst);
+				return ret < 0 ? ret : dst_height;
+			}
+		}
+	}
+#endif
+	return sws_scale(decoder->sws_ctx,
+		(const uint8_t * const *)src->data, src->linesize,
+		0, src->height,
+		buf_frame->bgra_data, (int*)buf_frame->bgra_linesize);
+}
+
+/* Largest lowres factor that still decodes at or above the target size, so
+ * the scaler only ever shrinks. Hardware decoders don't support lowres. */
+static int choose_lowres(struct ffmpeg_decoder *decoder, const AVCodec *codec)
+{
+	if (!codec || !codec->max_lowres || decoder->hw_decoding_active ||
+	    decoder->target_width <= 0 || decoder->target_height <= 0)
+		return 0;
+	
+	AVCodecParameters *par = decoder->format_ctx->streams[decoder->video_stream_idx]->codecpar;
+	int out_w, out_h;
+	get_target_output_size(decoder, &out_w, &out_h);
+	
+	int lowres = 0;
+	while (lowres < codec->max_lowres &&
+	       (par->width >> (lowres + 1)) >= out_w &&
+	       (par->height >> (lowres + 1)) >= out_h) {
+		lowres++;
+	}
+	return lowres;
+}
+
+/* Output is being shrunk for a target size, so passthrough formats
+ * (NV12/P010) must go through the scaler as well */
+static inline bool is_target_downscaled(struct ffmpeg_decoder *decoder, const AVFrame *frame)
+{
+	if (decoder->target_width <= 0 || decoder->target_height <= 0)
+		return false;
+	
+	int w, h;
+	get_output_size(decoder, &w, &h);
+	return w < frame->width || h < frame->height;
+}
+
+/* OBS format that shows this pixel format without conversion. Planar and
+ * packed YUV go to OBS as they are and are converted on the GPU, only
+ * formats missing here are converted to BGRA on the CPU */
+static enum video_format negotiate_video_format(enum AVPixelFormat format)
+{
+	switch (format) {
+	case AV_PIX_FMT_YUV420P:
+	case AV_PIX_FMT_YUVJ420P:
+		return VIDEO_FORMAT_I420;
+	case AV_PIX_FMT_NV12:
+		return VIDEO_FORMAT_NV12;
+	case AV_PIX_FMT_YUV422P:
+	case AV_PIX_FMT_YUVJ422P:
+		return VIDEO_FORMAT_I422;
+	case AV_PIX_FMT_YUV444P:
+	case AV_PIX_FMT_YUVJ444P:
+		return VIDEO_FORMAT_I444;
+	case AV_PIX_FMT_YUYV422:
+		return VIDEO_FORMAT_YUY2;
+	case AV_PIX_FMT_UYVY422:
+		return VIDEO_FORMAT_UYVY;
+	case AV_PIX_FMT_P010LE:
+		return VIDEO_FORMAT_P010;
+	case AV_PIX_FMT_YUV420P10LE:
+		return VIDEO_FORMAT_I010;
+	case AV_PIX_FMT_YUV422P10LE:
+		return VIDEO_FORMAT_I210;
+	case AV_PIX_FMT_YUV444P10LE:
+		/* No 10-bit 4:4:4 in OBS, repacked to 12-bit without loss */
+		return VIDEO_FORMAT_I412;
+	case AV_PIX_FMT_BGRA:
+		return VIDEO_FORMAT_BGRA;
+	case AV_PIX_FMT_RGBA:
+		return VIDEO_FORMAT_RGBA;
+	case AV_PIX_FMT_BGR0:
+		return VIDEO_FORMAT_BGRX;
+	case AV_PIX_FMT_YUVA420P:
+	case AV_PIX_FMT_YUVA444P:
+	case AV_PIX_FMT_YUVA444P10LE:
+	case AV_PIX_FMT_YUVA444P12LE:
+	case AV_PIX_FMT_ARGB:
+		/* Alpha sources, converted by the SIMD alpha kernels */
+		return VIDEO_FORMAT_BGRA;
+	default:
+		return VIDEO_FORMAT_NONE;
+	}
+}
+
+/* YUV444P10 frame repacked as YUV444P12 (OBS I412), NULL on failure */
+static AVFrame *repack_to_i412(const AVFrame *src)
+{
+	plane_repack_func repack = simd_get_best_10_to_12_repack();
+	if (!repack)
+		return NULL;
+	
+	AVFrame *dst = av_frame_alloc();
+	if (!dst)
+		return NULL;
+	
+	dst->format = AV_PIX_FMT_YUV444P12LE;
+	dst->width = src->width;
+	dst->height = src->height;
+	if (av_frame_get_buffer(dst, 0) < 0 || av_frame_copy_props(dst, src) < 0) {
+		av_frame_free(&dst);
+		return NULL;
+	}
+	
+	for (int plane = 0; plane < 3; plane++) {
+		repack((const uint16_t*)src->data[plane], src->linesize[plane],
+		       (uint16_t*)dst->data[plane], dst->linesize[plane],
+		       src->width, src->height);
+	}
+	return dst;
+}
+
+/* Matrix and range OBS decodes a YUV frame with, from the frame's metadata.
+ * Untagged video follows the usual convention: 709 for HD, 601 below */
+static void get_frame_color_params(const AVFrame *frame, enum video_colorspace *colorspace,
+	bool *full_range)
+{
+	/* HDR transfer functions come with the BT.2020 matrix */
+	switch (frame->color_trc) {
+	case AVCOL_TRC_SMPTE2084:
+		*colorspace = VIDEO_CS_2100_PQ;
+		break;
+	case AVCOL_TRC_ARIB_STD_B67:
+		*colorspace = VIDEO_CS_2100_HLG;
+		break;
+	default:
+		switch (frame->colorspace) {
+		case AVCOL_SPC_BT709:
+			*colorspace = VIDEO_CS_709;
+			break;
+		case AVCOL_SPC_BT470BG:
+		case AVCOL_SPC_SMPTE170M:
+		case AVCOL_SPC_SMPTE240M:
+			*colorspace = VIDEO_CS_601;
+			break;
+		default:
+			*colorspace = frame->height >= 720 ? VIDEO_CS_709 : VIDEO_CS_601;
+			break;
+		}
+		break;
+	}
+	
+	*full_range = frame->color_range == AVCOL_RANGE_JPEG ||
+		frame->format == AV_PIX_FMT_YUVJ420P ||
+		frame->format == AV_PIX_FMT_YUVJ422P ||
+		frame->format == AV_PIX_FMT_YUVJ444P;
+}
+
+/* Frames with a PQ or HLG transfer function. Converting them to 8 bits
+ * would lose the HDR signal, so they are always passed through */
+static inline bool is_hdr_frame(const AVFrame *frame)
+{
+	return frame->color_trc == AVCOL_TRC_SMPTE2084 || frame->color_trc == AVCOL_TRC_ARIB_STD_B67;
+}
+
+/* OBS transfer function and peak luminance of a frame. PQ peaks come from
+ * the mastering display or content light level metadata, HLG is relative
+ * to a nominal 1000 nit display */
+static void get_frame_hdr_params(const AVFrame *frame, enum video_trc *trc, uint16_t *max_luminance)
+{
+	*trc = VIDEO_TRC_DEFAULT;
+	*max_luminance = 0;
+	
+	if (frame->color_trc == AVCOL_TRC_ARIB_STD_B67) {
+		*trc = VIDEO_TRC_HLG;
+		*max_luminance = 1000;
+	} else if (frame->color_trc == AVCOL_TRC_SMPTE2084) {
+		*trc = VIDEO_TRC_PQ;
+		AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA);
+		const AVMasteringDisplayMetadata *mastering = sd ? (const AVMasteringDisplayMetadata*)sd->data : NULL;
+		if (mastering && mastering->has_luminance && mastering->max_luminance.den > 0) {
+			*max_luminance = (uint16_t)av_q2d(mastering->max_luminance);
+		} else if ((sd = av_frame_get_side_data(frame, AV_FRAME_DATA_CONTENT_LIGHT_LEVEL)) != NULL) {
+			*max_luminance = (uint16_t)((const AVContentLightMetadata*)sd->data)->MaxCLL;
+		}
+	}
+}
+
+/* HDR frame resized into decoder->frame for aspect correction and the
+ * target and governor sizes. OBS sizes async frames from the frame itself,
+ * and converting to BGRA would lose the HDR signal, so this stays at 10
+ * bits: 4:2:2 and 4:4:4 keep their chroma, the rest become 4:2:0 planar.
+ * Returns frame as it is when it already has the output size, or on failure */
+static AVFrame *resize_hdr_frame(struct ffmpeg_decoder *decoder, AVFrame *frame)
+{
+	int width, height;
+	get_output_size(decoder, &width, &height);
+	if (frame->width == width && frame->height == height)
+		return frame;
+	
+	enum AVPixelFormat format = frame->format == AV_PIX_FMT_YUV422P10LE ||
+		frame->format == AV_PIX_FMT_YUV444P10LE ? frame->format : AV_PIX_FMT_YUV420P10LE;
+	
+	decoder->hdr_sws_ctx = sws_getCachedContext(decoder->hdr_sws_ctx, frame->width, frame->height,
+		frame->format, width, height, format, SWS_BICUBIC, NULL, NULL, NULL);
+	AVFrame *scaled = decoder->hdr_sws_ctx ? av_frame_alloc() : NULL;
+	if (!scaled)
+		return frame;
+	
+	scaled->format = format;
+	scaled->width = width;
+	scaled->height = height;
+	if (av_frame_get_buffer(scaled, 0) < 0 || av_frame_copy_props(scaled, frame) < 0 ||
+	    sws_scale(decoder->hdr_sws_ctx, (const uint8_t *const *)frame->data, frame->linesize, 0,
+	              frame->height, scaled->data, scaled->linesize) <= 0) {
+		av_frame_free(&scaled);
+		return frame;
+	}
+	
+	av_frame_unref(decoder->frame);
+	av_frame_move_ref(decoder->frame, scaled);
+	av_frame_free(&scaled);
+	return decoder->frame;
+}
+
+/* Reopen only the video codec with a different lowres factor, then seek
+ * back to where we were. The file stays open. */
+static bool reopen_video_codec(struct ffmpeg_decoder *decoder, int lowres, int64_t resume_pts_us)
+{
+	const AVCodec *codec = decoder->video_codec_ctx->codec;
+	AVStream *stream = decoder->format_ctx->streams[decoder->video_stream_idx];
+	
+	AVCodecContext *ctx = avcodec_alloc_context3(codec);
+	if (!ctx)
+		return false;
+	
+	avcodec_parameters_to_context(ctx, stream->codecpar);
+	decode_policy_apply_codec_open(decoder->policy, ctx);
+	ctx->lowres = lowres;
+	
+	if (avcodec_open2(ctx, codec, NULL) < 0) {
+		blog(LOG_WARNING, "Failed to reopen %s with lowres %d", codec->name, lowres);
+		avcodec_free_context(&ctx);
+		return false;
+	}
+	
+	avcodec_free_context(&decoder->video_codec_ctx);
+	decoder->video_codec_ctx = ctx;
+	decoder->lowres = lowres;
+	/* Skip flags live on the codec context */
+	decoder->policy_generation = 0;
+	
+	/* Decoding has to restart from a keyframe, and cached alpha frames are
+	 * the old size */
+	end_catchup(decoder);
+	decoder->alpha_cache.decoder_behind = false;
+	av_frame_free(&decoder->deinterlace.pending);
+	if (decoder->alpha_cache.cache)
+		frame_cache_invalidate(decoder->alpha_cache.cache);
+	int64_t seek_pts = resume_pts_us != AV_NOPTS_VALUE ?
+		av_rescale_q(resume_pts_us, AV_TIME_BASE_Q, stream->time_base) : 0;
+	request_demux_seek(decoder, seek_pts);
+	if (decoder->audio_codec_ctx)
+		avcodec_flush_buffers(decoder->audio_codec_ctx);
+	decoder->discard_until_pts = resume_pts_us;
+	
+	blog(LOG_INFO, "Reopened %s with lowres %d (%dx%d)", codec->name, lowres, ctx->width, ctx->height);
+	return true;
+}
+
+/* Pick up a new target size from the source (decoder thread only).
+ * Returns true if the codec was reopened and the demuxer repositioned. */
+static bool apply_target_size(struct ffmpeg_decoder *decoder, int64_t resume_pts_us)
+{
+	if (!atomic_load(&decoder->target_size_changed))
+		return false;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	atomic_store(&decoder->target_size_changed, false);
+	decoder->target_width = decoder->requested_target_width;
+	decoder->target_height = decoder->requested_target_height;
+	pthread_mutex_unlock(&decoder->mutex);
+	
+	bool reopened = false;
+	int lowres = choose_lowres(decoder, decoder->video_codec_ctx->codec);
+	if (lowres != decoder->lowres)
+		reopened = reopen_video_codec(decoder, lowres, resume_pts_us);
+	
+	/* Scaler and slot buffers follow the new output size */
+	if (decoder->sws_ctx &&
+	    !create_bgra_scaler(decoder, decoder->sws_src_width, decoder->sws_src_height,
+	                        decoder->sws_src_format)) {
+		blog(LOG_WARNING, "Failed to rebuild scaler for new target size, will retry on next frame");
+	}
+	
+	int out_w, out_h;
+	get_output_size(decoder, &out_w, &out_h);
+	blog(LOG_INFO, "Target size %dx%d -> output %dx%d (lowres %d)",
+		decoder->target_width, decoder->target_height, out_w, out_h, decoder->lowres);
+	return reopened;
+}
+
+/* Rate thresholds for frame skipping inside the codec */
+#define RATE_SKIP_NONREF 2.0      /* Non-reference frames are never shown anyway */
+#define RATE_KEYFRAME_ONLY 8.0    /* Even reference frames can't be decoded fast enough */
+#define RATE_MIN 0.1
+#define RATE_MAX 32.0
+
+/* Pick up a playback rate change (decoder thread only) */
+static void apply_rate(struct ffmpeg_decoder *decoder)
+{
+	if (atomic_load(&decoder->rate_changed)) {
+		pthread_mutex_lock(&decoder->mutex);
+		atomic_store(&decoder->rate_changed, false);
+		double rate = decoder->requested_rate;
+		pthread_mutex_unlock(&decoder->mutex);
+		
+		clock_set_rate(decoder, rate);
+		
+		decoder->rate_skip_frame = rate >= RATE_KEYFRAME_ONLY ? AVDISCARD_NONKEY :
+			rate >= RATE_SKIP_NONREF ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+		
+		/* Above 1x keep at most one frame per OBS output frame */
+		struct obs_video_info ovi;
+		if (rate > 1.0 && obs_get_video_info(&ovi) && ovi.fps_num > 0) {
+			decoder->rate_frame_interval_ns = (uint64_t)ovi.fps_den * 1000000000ULL / ovi.fps_num;
+		} else {
+			decoder->rate_frame_interval_ns = 0;
+		}
+		decoder->last_selected_display_time = 0;
+		
+		/* Back to 1x - media time no longer matches wall time since the
+		 * audio anchor, so re-anchor the sample clock on the next frame */
+		bool muted = rate != 1.0;
+		if (decoder->audio_muted && !muted)
+			decoder->sync.anchored = false;
+		decoder->audio_muted = muted;
+		
+		blog(LOG_INFO, "Playback rate %.2fx (%s, audio %s)", rate,
+			decoder->rate_skip_frame == AVDISCARD_NONKEY ? "keyframes only" :
+			decoder->rate_skip_frame == AVDISCARD_NONREF ? "reference frames only" : "all frames",
+			muted ? "muted" : "on");
+	}
+	
+	/* Survives codec reopens */
+	if (decoder->video_codec_ctx->skip_frame != decoder->rate_skip_frame)
+		decoder->video_codec_ctx->skip_frame = decoder->rate_skip_frame;
+}
+
+/* Timeline epoch corrections are spread over playback at up to this
+ * fraction of real time instead of seeking */
+#define CLOCK_SLEW_RATE 0.05
+
+/* Apply part of a pending clock adjustment (decoder thread only) */
+static void apply_clock_slew(struct ffmpeg_decoder *decoder)
+{
+	if (!atomic_load(&decoder->clock_slew_active)) {
+		decoder->last_clock_slew = 0;
+		return;
+	}
+	
+	uint64_t now = os_gettime_ns();
+	int64_t max_step = decoder->last_clock_slew ?
+		(int64_t)((now - decoder->last_clock_slew) * CLOCK_SLEW_RATE) : 0;
+	decoder->last_clock_slew = now;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	int64_t step = decoder->pending_clock_slew_ns;
+	if (step > max_step) step = max_step;
+	if (step < -max_step) step = -max_step;
+	decoder->pending_clock_slew_ns -= step;
+	if (decoder->pending_clock_slew_ns == 0)
+		atomic_store(&decoder->clock_slew_active, false);
+	pthread_mutex_unlock(&decoder->mutex);
+	
+	if (step)
+		clock_slew(decoder, step);
+}
+
+/* A/V drift correction */
+#define SYNC_RESYNC_THRESHOLD_NS 100000000LL      /* Re-anchor the sample clock beyond this */
+#define SYNC_CORRECTION_INTERVAL_NS 1000000000ULL
+#define SYNC_COMPENSATE_MIN_NS 2000000LL          /* Below this, leave the stream alone */
+#define SYNC_MAX_COMPENSATION 0.005               /* Max resample ratio change (0.5%) */
+#define SYNC_MAX_SLEW_NS 5000000LL                /* Max video clock slew per correction */
+
+/* Pick up a sync master change (decoder thread only) */
+static void apply_sync_master(struct ffmpeg_decoder *decoder)
+{
+	if (!atomic_load(&decoder->sync_master_changed))
+		return;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	atomic_store(&decoder->sync_master_changed, false);
+	enum av_sync_master master = decoder->requested_sync_master == AV_SYNC_AUDIO ?
+		AV_SYNC_AUDIO : AV_SYNC_SYSTEM;
+	pthread_mutex_unlock(&decoder->mutex);
+	
+	if (master == decoder->sync.master)
+		return;
+	
+	/* Drop any compensation in progress */
+	if (decoder->sync.compensating) {
+		swr_set_compensation(decoder->swr_ctx, 0, 0);
+		decoder->sync.compensating = false;
+	}
+	decoder->sync.master = master;
+	decoder->sync.anchored = false;
+	
+	blog(LOG_INFO, "A/V sync master: %s", master == AV_SYNC_AUDIO ? "audio" : "system clock");
 }
 
-/* Clock system implementation (VLC-style frame pacing) */
-static inline uint64_t clock_get_system_time_for_pts(struct ffmpeg_decoder *decoder, int64_t pts)
+/* Timestamp for `frames` output samples whose PTS maps to master_ns on the
+ * master clock. The sample clock (anchor plus samples sent) is measured
+ * against the master and the follower is corrected once per interval:
+ * system master resamples audio, audio master slews the video clock */
+static uint64_t sync_audio_frame(struct ffmpeg_decoder *decoder, uint64_t master_ns, int frames)
 {
-	pthread_mutex_lock(&decoder->clock.lock);
+	uint64_t now = os_gettime_ns();
+	
+	if (!decoder->sync.anchored) {
+		decoder->sync.anchored = true;
+		decoder->sync.anchor_ns = master_ns;
+		decoder->sync.samples = 0;
+		decoder->sync.drift_ns = 0;
+		decoder->sync.last_correction_ns = now;
+	}
 	
-	/* Convert PTS to system time */
-	int64_t pts_delta = pts - decoder->clock.media_start_pts;
+	uint64_t sample_ns = decoder->sync.anchor_ns +
+		decoder->sync.samples * 1000000000ULL / decoder->audio_out_sample_rate;
+	int64_t drift = (int64_t)(sample_ns - master_ns);
 	
-	/* Apply playback rate */
-	double system_delta_ms = (double)pts_delta / (1000.0 * decoder->clock.playback_rate);
+	/* Too far to correct smoothly (dropped packets, stalls) - start over */
+	if (drift > SYNC_RESYNC_THRESHOLD_NS || drift < -SYNC_RESYNC_THRESHOLD_NS) {
+		blog(LOG_WARNING, "A/V drift %.1fms, re-anchoring audio", drift / 1000000.0);
+		if (decoder->sync.compensating) {
+			swr_set_compensation(decoder->swr_ctx, 0, 0);
+			decoder->sync.compensating = false;
+		}
+		decoder->sync.anchor_ns = master_ns;
+		decoder->sync.samples = 0;
+		decoder->sync.drift_ns = 0;
+		decoder->sync.resyncs++;
+		sample_ns = master_ns;
+		drift = 0;
+	}
 	
-	/* Calculate target system time */
-	uint64_t target_time = decoder->clock.system_start + (uint64_t)system_delta_ms;
+	/* Smooth out per-packet PTS jitter */
+	decoder->sync.drift_ns += (drift - decoder->sync.drift_ns) / 16;
+	decoder->sync.samples += frames;
 	
-	pthread_mutex_unlock(&decoder->clock.lock);
+	if (now - decoder->sync.last_correction_ns >= SYNC_CORRECTION_INTERVAL_NS) {
+		decoder->sync.last_correction_ns = now;
+		int64_t smoothed = decoder->sync.drift_ns;
+		
+		if (decoder->sync.master == AV_SYNC_SYSTEM) {
+			/* Positive drift = samples play late, so emit fewer over the next second */
+			int rate = (int)decoder->audio_out_sample_rate;
+			int delta = (int)(-smoothed * rate / 1000000000LL);
+			int max_delta = (int)(rate * SYNC_MAX_COMPENSATION);
+			if (delta > max_delta) delta = max_delta;
+			if (delta < -max_delta) delta = -max_delta;
+			
+			bool wanted = smoothed > SYNC_COMPENSATE_MIN_NS || smoothed < -SYNC_COMPENSATE_MIN_NS;
+			if (wanted && !decoder->swr_ctx)
+				setup_audio_resampler(decoder, true);
+			if (decoder->swr_ctx && (wanted || decoder->sync.compensating)) {
+				if (!wanted)
+					delta = 0;
+				if (swr_set_compensation(decoder->swr_ctx, delta, rate) >= 0)
+					decoder->sync.compensating = delta != 0;
+			}
+		} else {
+			/* Video repeats or drops frames as its clock moves toward audio */
+			int64_t slew = smoothed;
+			if (slew > SYNC_MAX_SLEW_NS) slew = SYNC_MAX_SLEW_NS;
+			if (slew < -SYNC_MAX_SLEW_NS) slew = -SYNC_MAX_SLEW_NS;
+			clock_slew(decoder, slew);
+			decoder->sync.drift_ns -= slew;
+		}
+		
+		if (decoder->perf_monitor) {
+			perf_monitor_set_av_drift((perf_monitor_t*)decoder->perf_monitor,
+				smoothed, decoder->sync.resyncs);
+		}
+	}
 	
-	return target_time;
+	return decoder->sync.master == AV_SYNC_AUDIO ? sample_ns : master_ns;
 }
 
-static inline void clock_reset(struct ffmpeg_decoder *decoder, int64_t start_pts)
+/* Pick up knob changes from the load-shedding policy. Called from the
+ * decoder thread (or before it starts) so codec/scaler state is never
+ * touched concurrently. */
+static void apply_policy(struct ffmpeg_decoder *decoder)
 {
-	pthread_mutex_lock(&decoder->clock.lock);
+	if (!decoder->policy)
+		return;
 	
-	decoder->clock.system_start = os_gettime_ns() / 1000000;  /* Current time in ms */
-	decoder->clock.media_start_pts = start_pts;
-	decoder->clock.last_pts = start_pts;
-	decoder->clock.last_system = decoder->clock.system_start;
+	struct decode_policy_knobs knobs;
+	uint32_t generation = decode_policy_get_knobs(decoder->policy, &knobs);
+	if (generation == decoder->policy_generation)
+		return;
+	decoder->policy_generation = generation;
 	
-	blog(LOG_INFO, "Clock reset: system_start=%llu ms, media_start=%lld us", 
-		(unsigned long long)decoder->clock.system_start,
-		(long long)start_pts);
+	if (decoder->video_codec_ctx)
+		decode_policy_apply_codec(&knobs, decoder->video_codec_ctx);
 	
-	pthread_mutex_unlock(&decoder->clock.lock);
-}
-
-static inline void clock_update(struct ffmpeg_decoder *decoder, int64_t pts)
-{
-	pthread_mutex_lock(&decoder->clock.lock);
+	int depth = knobs.queue_depth;
+	if (depth < 1) depth = 1;
+	if (depth > FRAME_BUFFER_SLOTS) depth = FRAME_BUFFER_SLOTS;
 	
-	decoder->clock.last_pts = pts;
-	decoder->clock.last_system = os_gettime_ns() / 1000000;
+	pthread_mutex_lock(&decoder->buffer.lock);
+	decoder->buffer.depth = depth;
+	pthread_cond_broadcast(&decoder->buffer.cond);
+	pthread_mutex_unlock(&decoder->buffer.lock);
 	
-	pthread_mutex_unlock(&decoder->clock.lock);
+	if (knobs.frame_decimation != decoder->frame_decimation) {
+		decoder->frame_decimation = knobs.frame_decimation;
+		decoder->decimation_counter = 0;
+	}
+	
+	/* Under heavy load frames already cached are still served, no new ones enter */
+	decoder->cache_admission = knobs.cache_admission;
+	
+	if (knobs.sws_flags != decoder->sws_flags || knobs.convert_threads != decoder->sws_threads ||
+	    knobs.scale_divisor != decoder->scale_divisor) {
+		decoder->sws_flags = knobs.sws_flags;
+		decoder->sws_threads = knobs.convert_threads;
+		decoder->scale_divisor = knobs.scale_divisor;
+		
+		/* Rebuild an existing scaler with the new settings */
+		if (decoder->sws_ctx && decoder->video_codec_ctx &&
+		    !create_bgra_scaler(decoder, decoder->sws_src_width, decoder->sws_src_height,
+		                        decoder->sws_src_format)) {
+			blog(LOG_WARNING, "Failed to rebuild scaler for new policy, will retry on next frame");
+		}
+	}
+	
+	blog(LOG_INFO, "Policy applied: loop filter skip=%d, idct skip=%d, queue depth=%d, scaler threads=%d, "
+		"keep 1/%d frames, resolution 1/%d",
+		knobs.skip_loop_filter, knobs.skip_idct, depth, knobs.convert_threads,
+		knobs.frame_decimation, knobs.scale_divisor);
 }
 
 /* Fast P010 to NV12 conversion - converts 10-bit to 8-bit by shifting right by 2 */
@@ -385,6 +1727,99 @@ static void convert_p010_to_nv12(uint8_t *dst_y, uint8_t *dst_uv,
 	}
 }
 
+/* Frames already buffered become stale, the display thread skips them as it
+ * reaches them instead of the buffer being cleared under it. Decoder thread,
+ * or with the threads stopped */
+static inline void next_frame_generation(struct ffmpeg_decoder *decoder)
+{
+	atomic_store(&decoder->buffer.generation, atomic_load(&decoder->buffer.generation) + 1);
+}
+
+/* Serve a seek from the frames already queued when its target lies among
+ * them, with no demuxer seek or codec flush. Frames before the target are
+ * skipped. A target the clock already maps to now needs nothing more,
+ * otherwise the clock is re-anchored on it and the queued frames retimed -
+ * only without audio output, audio already handed to OBS can't be retimed.
+ * Decoder thread only */
+static bool seek_within_buffer(struct ffmpeg_decoder *decoder, int64_t target_abs)
+{
+	/* Still settling from an earlier seek, the queue says nothing yet */
+	if (decoder->waiting_for_first_frame || decoder->discard_until_pts != AV_NOPTS_VALUE)
+		return false;
+	
+	AVStream *stream = decoder->format_ctx->streams[decoder->video_stream_idx];
+	int64_t frame_ns = stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0 ?
+		av_rescale_q(1, av_inv_q(stream->avg_frame_rate), AV_TIME_BASE_Q) * 1000 : 33333333;
+	int generation = atomic_load(&decoder->buffer.generation);
+	
+	pthread_mutex_lock(&decoder->buffer.lock);
+	
+	/* Last queued frame at or before the target, and whether any comes after it */
+	int hit = -1;
+	bool later = false;
+	for (int i = 0; i < decoder->buffer.count; i++) {
+		struct buffered_frame *f = &decoder->buffer.frames[(decoder->buffer.read_idx + i) % FRAME_BUFFER_SLOTS];
+		if (!f->ready || f->generation != generation)
+			continue;
+		if (f->pts > target_abs) {
+			later = true;
+			break;
+		}
+		hit = i;
+	}
+	if (hit < 0 || !later) {
+		pthread_mutex_unlock(&decoder->buffer.lock);
+		return false;
+	}
+	
+	int64_t offset_ns = (int64_t)(clock_get_system_time_for_pts(decoder, target_abs) - os_gettime_ns());
+	bool in_sync = offset_ns > -frame_ns && offset_ns < frame_ns;
+	bool audio_out = decoder->audio_codec_ctx && decoder->audio_cb && !decoder->audio_muted;
+	if (!in_sync && audio_out) {
+		pthread_mutex_unlock(&decoder->buffer.lock);
+		return false;
+	}
+	
+	/* Skipped by the display thread like frames from before a seek */
+	for (int i = 0; i < hit; i++)
+		decoder->buffer.frames[(decoder->buffer.read_idx + i) % FRAME_BUFFER_SLOTS].generation = generation - 1;
+	
+	if (!in_sync) {
+		struct buffered_frame *f = &decoder->buffer.frames[(decoder->buffer.read_idx + hit) % FRAME_BUFFER_SLOTS];
+		clock_reset(decoder, f->pts);
+		for (int i = hit; i < decoder->buffer.count; i++) {
+			f = &decoder->buffer.frames[(decoder->buffer.read_idx + i) % FRAME_BUFFER_SLOTS];
+			if (f->ready && f->generation == generation)
+				decoder->last_selected_display_time = f->system_time =
+					clock_get_system_time_for_pts(decoder, f->pts);
+		}
+	}
+	
+	pthread_mutex_unlock(&decoder->buffer.lock);
+	return true;
+}
+
+/* Release the frame at the read index and move on. Only the display thread
+ * consumes frames. Called with the buffer lock held */
+static void consume_frame(struct ffmpeg_decoder *decoder)
+{
+	struct buffered_frame *buf_frame = &decoder->buffer.frames[decoder->buffer.read_idx];
+	
+	/* Clean up zero-copy frame reference if used */
+	if (buf_frame->zero_copy && buf_frame->frame) {
+		av_frame_unref(buf_frame->frame);
+		av_frame_free(&buf_frame->frame);
+		buf_frame->frame = NULL;
+	}
+	buf_frame->ready = false;
+	buf_frame->zero_copy = false;
+	decoder->buffer.read_idx = (decoder->buffer.read_idx + 1) % FRAME_BUFFER_SLOTS;
+	
+	/* Signal decoder thread if buffer was full */
+	if (--decoder->buffer.count == decoder->buffer.depth - 1)
+		pthread_cond_signal(&decoder->buffer.cond);
+}
+
 /* Display thread - consumes frames from buffer with VLC-style timing */
 static void *display_thread(void *opaque)
 {
@@ -443,8 +1878,7 @@ static void *display_thread(void *opaque)
 		}
 		
 		/* Get next frame to display */
-		int current_read_idx = decoder->buffer.read_idx;  /* Save the index */
-		struct buffered_frame *buf_frame = &decoder->buffer.frames[current_read_idx];
+		struct buffered_frame *buf_frame = &decoder->buffer.frames[decoder->buffer.read_idx];
 		
 		if (!buf_frame->ready || decoder->buffer.count == 0) {
 			pthread_mutex_unlock(&decoder->buffer.lock);
@@ -456,24 +1890,15 @@ static void *display_thread(void *opaque)
 		uint64_t display_time = buf_frame->system_time;
 		int64_t pts = buf_frame->pts;
 		
-		/* Check if frame is still valid (not from before a loop) */
-		if (pts < 0 || display_time == 0) {
-			/* Mark as consumed and move to next */
-			buf_frame->ready = false;
-			decoder->buffer.read_idx = (decoder->buffer.read_idx + 1) % 3;
-			decoder->buffer.count--;
+		/* Decoded before a seek, loop or file switch - skip it right away */
+		if (buf_frame->generation != atomic_load(&decoder->buffer.generation)) {
+			consume_frame(decoder);
 			pthread_mutex_unlock(&decoder->buffer.lock);
-			/* Skip invalid frame after loop */
-			os_sleep_ms(1);
 			continue;
 		}
 		
-		/* Calculate time until frame should be displayed */
-		/* Note: display_time is in milliseconds from os_gettime_ns()/1000000 */
-		uint64_t current_time_ms = os_gettime_ns() / 1000000;  /* Current time in ms */
-		int64_t time_until_display_ms = (int64_t)(display_time - current_time_ms);
-		/* Convert to nanoseconds for compatibility with rest of code */
-		int64_t time_until_display = time_until_display_ms * 1000000;
+		/* Calculate time until frame should be displayed (ns, os_gettime_ns() base) */
+		int64_t time_until_display = (int64_t)(display_time - os_gettime_ns());
 		
 		/* Remove debug logging - was causing performance issues */
 		
@@ -488,17 +1913,8 @@ static void *display_thread(void *opaque)
 			if (decoder->perf_monitor) {
 				((perf_monitor_t*)decoder->perf_monitor)->frames_dropped++;
 			}
-			/* Clean up zero-copy frame reference if used */
-			if (buf_frame->zero_copy && buf_frame->frame) {
-				av_frame_unref(buf_frame->frame);
-				av_frame_free(&buf_frame->frame);
-				buf_frame->frame = NULL;
-			}
 			/* Mark frame as consumed and skip to next */
-			buf_frame->ready = false;
-			buf_frame->zero_copy = false;
-			decoder->buffer.read_idx = (decoder->buffer.read_idx + 1) % 3;
-			decoder->buffer.count--;
+			consume_frame(decoder);
 			pthread_mutex_unlock(&decoder->buffer.lock);
 			continue;
 		}
@@ -557,7 +1973,31 @@ static void *display_thread(void *opaque)
 			obs_frame.timestamp = os_gettime_ns();
 			
 			/* Set format and data based on frame type */
-			if (current_frame->zero_copy && current_frame->frame) {
+			if (current_frame->zero_copy && current_frame->frame &&
+			    current_frame->native_format != VIDEO_FORMAT_NONE) {
+				/* Negotiated software format: all planes straight from the frame */
+				AVFrame *frame = current_frame->frame;
+				obs_frame.format = current_frame->native_format;
+				obs_frame.width = frame->width;
+				obs_frame.height = frame->height;
+				for (int i = 0; i < 4; i++) {
+					obs_frame.data[i] = frame->data[i];
+					obs_frame.linesize[i] = frame->linesize[i];
+				}
+				
+				bool rgb = obs_frame.format == VIDEO_FORMAT_BGRA ||
+				           obs_frame.format == VIDEO_FORMAT_RGBA ||
+				           obs_frame.format == VIDEO_FORMAT_BGRX;
+				obs_frame.full_range = rgb || current_frame->full_range;
+				obs_frame.trc = rgb ? VIDEO_TRC_DEFAULT : current_frame->trc;
+				obs_frame.max_luminance = current_frame->max_luminance;
+				enum video_range_type range = obs_frame.full_range ? VIDEO_RANGE_FULL : VIDEO_RANGE_PARTIAL;
+				video_format_get_parameters_for_format(rgb ? VIDEO_CS_DEFAULT : current_frame->colorspace,
+				                                       range, obs_frame.format,
+				                                       obs_frame.color_matrix,
+				                                       obs_frame.color_range_min,
+				                                       obs_frame.color_range_max);
+			} else if (current_frame->zero_copy && current_frame->frame) {
 				/* Zero-copy path: Use frame reference directly */
 				/* Check if this is a P010 frame (10-bit) */
 				if (current_frame->frame->format == AV_PIX_FMT_P010LE) {
@@ -570,11 +2010,13 @@ static void *display_thread(void *opaque)
 				obs_frame.linesize[0] = current_frame->frame->linesize[0];
 				obs_frame.linesize[1] = current_frame->frame->linesize[1];
 				
-				/* YUV formats - limited range by default */
-				obs_frame.full_range = false;
+				/* Matrix, range and transfer function as tagged in the stream */
+				obs_frame.full_range = current_frame->full_range;
+				obs_frame.trc = current_frame->trc;
+				obs_frame.max_luminance = current_frame->max_luminance;
 				/* Set proper color matrix using OBS helper function */
 				enum video_range_type range = obs_frame.full_range ? VIDEO_RANGE_FULL : VIDEO_RANGE_PARTIAL;
-				video_format_get_parameters_for_format(VIDEO_CS_DEFAULT, range, obs_frame.format,
+				video_format_get_parameters_for_format(current_frame->colorspace, range, obs_frame.format,
 				                                       obs_frame.color_matrix, 
 				                                       obs_frame.color_range_min,
 				                                       obs_frame.color_range_max);
@@ -586,11 +2028,11 @@ static void *display_thread(void *opaque)
 				obs_frame.linesize[0] = current_frame->nv12_linesize[0];
 				obs_frame.linesize[1] = current_frame->nv12_linesize[1];
 				
-				/* YUV formats - limited range by default */
-				obs_frame.full_range = false;
+				/* Matrix and range as tagged in the stream */
+				obs_frame.full_range = current_frame->full_range;
 				/* Set proper color matrix using OBS helper function */
 				enum video_range_type range = obs_frame.full_range ? VIDEO_RANGE_FULL : VIDEO_RANGE_PARTIAL;
-				video_format_get_parameters_for_format(VIDEO_CS_DEFAULT, range, obs_frame.format,
+				video_format_get_parameters_for_format(current_frame->colorspace, range, obs_frame.format,
 				                                       obs_frame.color_matrix, 
 				                                       obs_frame.color_range_min,
 				                                       obs_frame.color_range_max);
@@ -605,6 +2047,11 @@ static void *display_thread(void *opaque)
 			} else {
 				/* Software frame - use BGRA format */
 				obs_frame.format = VIDEO_FORMAT_BGRA;
+				/* BGRA may be downscaled by the governor's budget */
+				if (current_frame->width > 0 && current_frame->height > 0) {
+					obs_frame.width = current_frame->width;
+					obs_frame.height = current_frame->height;
+				}
 				for (int i = 0; i < 4; i++) {
 					obs_frame.data[i] = current_frame->bgra_data[i];
 					obs_frame.linesize[i] = current_frame->bgra_linesize[i];
@@ -670,31 +2117,10 @@ static void *display_thread(void *opaque)
 			pthread_mutex_unlock(&decoder->mutex);
 		}
 		
-		/* Mark frame as consumed */
+		/* Mark frame as consumed. Still the one at the read index, the
+		 * decoder thread never moves it or clears the buffer */
 		pthread_mutex_lock(&decoder->buffer.lock);
-		/* Use the saved index to clean up the correct frame */
-		struct buffered_frame *consumed_frame = &decoder->buffer.frames[current_read_idx];
-		
-		/* Clean up zero-copy frame reference if used */
-		if (consumed_frame->zero_copy && consumed_frame->frame) {
-			av_frame_unref(consumed_frame->frame);
-			av_frame_free(&consumed_frame->frame);
-			consumed_frame->frame = NULL;
-		}
-		consumed_frame->ready = false;
-		consumed_frame->zero_copy = false;
-		decoder->buffer.read_idx = (decoder->buffer.read_idx + 1) % 3;
-		int new_count = --decoder->buffer.count;
-		
-		/* Verbose buffer logging - disabled for performance */
-		/* if (frames_displayed % 100 == 0) {
-			blog(LOG_INFO, "[FFmpeg Decoder] Consumed frame, new count=%d", new_count);
-		} */
-		
-		/* Signal decoder thread if buffer was full */
-		if (new_count == 2) {
-			pthread_cond_signal(&decoder->buffer.cond);
-		}
+		consume_frame(decoder);
 		pthread_mutex_unlock(&decoder->buffer.lock);
 	}
 	
@@ -711,6 +2137,8 @@ struct ffmpeg_decoder *ffmpeg_decoder_create(obs_source_t *source)
 	decoder->source = source;
 	decoder->state = DECODER_STATE_STOPPED;
 	pthread_mutex_init(&decoder->mutex, NULL);
+	pthread_mutex_init(&decoder->opener.lock, NULL);
+	pthread_cond_init(&decoder->opener.cond, NULL);
 	
 	/* Initialize performance monitor */
 	decoder->perf_monitor = bzalloc(sizeof(perf_monitor_t));
@@ -718,9 +2146,31 @@ struct ffmpeg_decoder *ffmpeg_decoder_create(obs_source_t *source)
 		perf_monitor_init((perf_monitor_t*)decoder->perf_monitor);
 	}
 	
+	/* Initialize load-shedding policy (Balanced until the source says otherwise) */
+	decoder->policy = bzalloc(sizeof(struct decode_policy));
+	decode_policy_init(decoder->policy, DECODE_POLICY_BALANCED);
+	decoder->frame_decimation = 1;
+	decoder->scale_divisor = 1;
+	decoder->cache_admission = true;
+	decoder->deinterlace.mode = DEINTERLACE_EDGE;
+	
+	struct packet_queue_limits video_limits = {PACKET_QUEUE_VIDEO_BYTES, PACKET_QUEUE_VIDEO_DURATION_US, 0};
+	struct packet_queue_limits audio_limits = {PACKET_QUEUE_AUDIO_BYTES, PACKET_QUEUE_AUDIO_DURATION_US, 0};
+	decoder->packets = packet_queue_create(&video_limits, &audio_limits);
+	
+	/* Read-ahead for network shares, mapped reads for local files */
+	decoder->read_ahead_mode = READ_AHEAD_REMOTE;
+	decoder->read_ahead_mb = 16;
+	
+	/* Join the machine-wide load governor */
+	decoder->governor_entry = load_governor_register((perf_monitor_t*)decoder->perf_monitor,
+		decoder->policy);
+	
 	/* Initialize clock system */
 	pthread_mutex_init(&decoder->clock.lock, NULL);
 	decoder->clock.playback_rate = 1.0;
+	decoder->requested_rate = 1.0;
+	decoder->rate_skip_frame = AVDISCARD_DEFAULT;
 	
 	/* Initialize frame buffer */
 	pthread_mutex_init(&decoder->buffer.lock, NULL);
@@ -728,9 +2178,10 @@ struct ffmpeg_decoder *ffmpeg_decoder_create(obs_source_t *source)
 	decoder->buffer.write_idx = 0;
 	decoder->buffer.read_idx = 0;
 	decoder->buffer.count = 0;
+	decoder->buffer.depth = FRAME_BUFFER_SLOTS;
 	
 	/* Allocate buffer frames */
-	for (int i = 0; i < 3; i++) {
+	for (int i = 0; i < FRAME_BUFFER_SLOTS; i++) {
 		decoder->buffer.frames[i].frame = av_frame_alloc();
 		if (!decoder->buffer.frames[i].frame) {
 			blog(LOG_ERROR, "Failed to allocate buffer frame %d", i);
@@ -771,6 +2222,13 @@ void ffmpeg_decoder_destroy(struct ffmpeg_decoder *decoder)
 	
 	blog(LOG_INFO, "Destroying decoder");
 	
+	/* The opener would start the threads again */
+	stop_opener(decoder);
+	
+	/* Leave the governor before the monitor and policy go away */
+	load_governor_unregister(decoder->governor_entry);
+	decoder->governor_entry = NULL;
+	
 	/* Signal threads to stop */
 	pthread_mutex_lock(&decoder->mutex);
 	atomic_store(&decoder->stopping, true);
@@ -790,6 +2248,7 @@ void ffmpeg_decoder_destroy(struct ffmpeg_decoder *decoder)
 	}
 	
 	/* Stop decoder thread */
+	packet_queue_abort(decoder->packets);
 	if (atomic_load(&decoder->thread_running)) {
 		/* Wait for thread to exit */
 		pthread_join(decoder->thread, NULL);
@@ -797,6 +2256,13 @@ void ffmpeg_decoder_destroy(struct ffmpeg_decoder *decoder)
 		blog(LOG_INFO, "Decoder thread stopped");
 	}
 	
+	/* Stop demux thread */
+	if (decoder->demux_thread_created) {
+		decoder->interrupt_request = true;
+		pthread_join(decoder->demux_thread, NULL);
+		decoder->demux_thread_created = false;
+	}
+	
 	/* Now it's safe to clear callbacks - threads are stopped, no need for mutex */
 	decoder->video_cb = NULL;
 	decoder->audio_cb = NULL;
@@ -816,7 +2282,7 @@ void ffmpeg_decoder_destroy(struct ffmpeg_decoder *decoder)
 	}
 	
 	/* Free buffer frames and clear all references */
-	for (int i = 0; i < 3; i++) {
+	for (int i = 0; i < FRAME_BUFFER_SLOTS; i++) {
 		/* Free frame reference (zero-copy or regular) */
 		if (decoder->buffer.frames[i].frame) {
 			av_frame_unref(decoder->buffer.frames[i].frame);
@@ -843,12 +2309,17 @@ void ffmpeg_decoder_destroy(struct ffmpeg_decoder *decoder)
 		/* Reset frame state */
 		decoder->buffer.frames[i].ready = false;
 		decoder->buffer.frames[i].is_hw_frame = false;
+		decoder->buffer.frames[i].native_format = VIDEO_FORMAT_NONE;
 	}
 	
 	if (decoder->sws_ctx)
 		sws_freeContext(decoder->sws_ctx);
 	if (decoder->p010_sws_ctx)
 		sws_freeContext(decoder->p010_sws_ctx);
+	if (decoder->hdr_sws_ctx)
+		sws_freeContext(decoder->hdr_sws_ctx);
+	if (decoder->scale_frame)
+		av_frame_free(&decoder->scale_frame);
 	if (decoder->swr_ctx)
 		swr_free(&decoder->swr_ctx);
 	
@@ -896,9 +2367,14 @@ void ffmpeg_decoder_destroy(struct ffmpeg_decoder *decoder)
 		decoder->audio_codec_ctx = NULL;
 	}
 	
-	if (decoder->format_ctx) {
-		avformat_close_input(&decoder->format_ctx);
-		decoder->format_ctx = NULL;
+	close_input(decoder);
+	packet_queue_destroy(decoder->packets);
+	da_free(decoder->keyframes);
+	av_frame_free(&decoder->alpha_cache.hit);
+	av_frame_free(&decoder->deinterlace.pending);
+	if (decoder->alpha_cache.cache) {
+		frame_cache_destroy(decoder->alpha_cache.cache);
+		bfree(decoder->alpha_cache.cache);
 	}
 	
 	bfree(decoder->current_path);
@@ -908,8 +2384,16 @@ void ffmpeg_decoder_destroy(struct ffmpeg_decoder *decoder)
 		bfree(decoder->perf_monitor);
 	}
 	
+	/* Free load-shedding policy */
+	if (decoder->policy) {
+		decode_policy_destroy(decoder->policy);
+		bfree(decoder->policy);
+	}
+	
 	/* Destroy synchronization primitives */
 	pthread_mutex_destroy(&decoder->mutex);
+	pthread_mutex_destroy(&decoder->opener.lock);
+	pthread_cond_destroy(&decoder->opener.cond);
 	pthread_mutex_destroy(&decoder->clock.lock);
 	pthread_mutex_destroy(&decoder->buffer.lock);
 	pthread_cond_destroy(&decoder->buffer.cond);
@@ -922,6 +2406,9 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 	if (!decoder || !path)
 		return false;
 	
+	/* Caller's path, path itself may be replaced below */
+	const char *media_path = path;
+	
 	/* Handle long file paths on Windows */
 	#ifdef _WIN32
 	size_t path_len = strlen(path);
@@ -954,10 +2441,10 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 	blog(LOG_INFO, "Initializing decoder with file: %s", path);
 	
 	/* Stop any existing playback */
-	ffmpeg_decoder_stop_thread(decoder);
+	stop_threads(decoder);
 	
 	/* Clear old buffer frames before reinitializing */
-	for (int i = 0; i < 3; i++) {
+	for (int i = 0; i < FRAME_BUFFER_SLOTS; i++) {
 		/* Free BGRA buffers (return to pool) */
 		if (decoder->buffer.frames[i].bgra_data[0]) {
 			release_frame_buffer(decoder->buffer.frames[i].bgra_data[0]);
@@ -976,7 +2463,12 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 		}
 		decoder->buffer.frames[i].ready = false;
 		decoder->buffer.frames[i].is_hw_frame = false;
+		decoder->buffer.frames[i].native_format = VIDEO_FORMAT_NONE;
 	}
+	decoder->buffer.write_idx = 0;
+	decoder->buffer.read_idx = 0;
+	decoder->buffer.count = 0;
+	next_frame_generation(decoder);
 	
 	/* Clear old state */
 	if (decoder->hw_device_ctx) {
@@ -987,13 +2479,47 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 		av_frame_free(&decoder->hw_frame);
 		decoder->hw_frame = NULL;
 	}
-	if (decoder->format_ctx)
-		avformat_close_input(&decoder->format_ctx);
+	close_input(decoder);
 	if (decoder->video_codec_ctx)
 		avcodec_free_context(&decoder->video_codec_ctx);
 	if (decoder->audio_codec_ctx)
 		avcodec_free_context(&decoder->audio_codec_ctx);
 	
+	/* Until the new file is open there is no current file */
+	decoder->initialized = false;
+	bfree(decoder->current_path);
+	decoder->current_path = NULL;
+	
+	/* Scalers are sized for the previous file */
+	if (decoder->sws_ctx) {
+		sws_freeContext(decoder->sws_ctx);
+		decoder->sws_ctx = NULL;
+	}
+	if (decoder->p010_sws_ctx) {
+		sws_freeContext(decoder->p010_sws_ctx);
+		decoder->p010_sws_ctx = NULL;
+	}
+	if (decoder->hdr_sws_ctx) {
+		sws_freeContext(decoder->hdr_sws_ctx);
+		decoder->hdr_sws_ctx = NULL;
+	}
+	
+	/* Force the policy to be re-applied to the new codec */
+	decoder->policy_generation = 0;
+	
+	/* The queue was emptied when the threads stopped */
+	decoder->demux_generation = decoder->seek_generation;
+	decoder->demux_seek.pending = false;
+	
+	/* Pick up the current target size; lowres is chosen at codec open */
+	pthread_mutex_lock(&decoder->mutex);
+	atomic_store(&decoder->target_size_changed, false);
+	decoder->target_width = decoder->requested_target_width;
+	decoder->target_height = decoder->requested_target_height;
+	pthread_mutex_unlock(&decoder->mutex);
+	decoder->lowres = 0;
+	decoder->discard_until_pts = AV_NOPTS_VALUE;
+	
 	/* Allocate format context and set up interrupt callback */
 	decoder->format_ctx = avformat_alloc_context();
 	if (!decoder->format_ctx) {
@@ -1006,11 +2532,20 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 	decoder->format_ctx->interrupt_callback.callback = interrupt_callback;
 	decoder->format_ctx->interrupt_callback.opaque = decoder;
 	
+	/* Local files are read from a mapping or read-ahead threads instead of read() calls */
+	open_custom_io(decoder, path);
+	if (decoder->custom_io) {
+		decoder->format_ctx->pb = decoder->custom_io;
+		decoder->format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+	}
+	
 	/* Open input file with timeout for network files */
 	AVDictionary *opts = NULL;
 	av_dict_set(&opts, "timeout", "5000000", 0);  /* 5 second timeout */
 	
-	int ret = avformat_open_input(&decoder->format_ctx, path, NULL, &opts);
+	/* A file opened before skips format probing */
+	const AVInputFormat *cached_format = stream_cache_get_input_format(media_path);
+	int ret = avformat_open_input(&decoder->format_ctx, path, cached_format, &opts);
 	av_dict_free(&opts);
 	
 	/* Free long_path if we allocated it */
@@ -1025,14 +2560,21 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 		char errbuf[AV_ERROR_MAX_STRING_SIZE];
 		av_strerror(ret, errbuf, sizeof(errbuf));
 		blog(LOG_ERROR, "Failed to open file: %s - Error: %s", path, errbuf);
+		/* format_ctx is already freed on failure */
+		close_input(decoder);
 		return false;
 	}
 	
-	/* Find stream info */
-	if (avformat_find_stream_info(decoder->format_ctx, NULL) < 0) {
-		blog(LOG_ERROR, "Failed to find stream info");
-		avformat_close_input(&decoder->format_ctx);
-		return false;
+	/* Find stream info - from the cache when this file was probed before */
+	if (stream_cache_apply(media_path, decoder->format_ctx)) {
+		blog(LOG_INFO, "Using cached stream parameters, skipped stream probing");
+	} else {
+		if (avformat_find_stream_info(decoder->format_ctx, NULL) < 0) {
+			blog(LOG_ERROR, "Failed to find stream info");
+			close_input(decoder);
+			return false;
+		}
+		stream_cache_store(media_path, decoder->format_ctx);
 	}
 	
 	/* Find video and audio streams */
@@ -1050,7 +2592,7 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 	
 	if (decoder->video_stream_idx < 0) {
 		blog(LOG_ERROR, "No video stream found");
-		avformat_close_input(&decoder->format_ctx);
+		close_input(decoder);
 		return false;
 	}
 	
@@ -1059,7 +2601,7 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 	const AVCodec *video_codec = avcodec_find_decoder(video_stream->codecpar->codec_id);
 	if (!video_codec) {
 		blog(LOG_ERROR, "Video codec not found");
-		avformat_close_input(&decoder->format_ctx);
+		close_input(decoder);
 		return false;
 	}
 	
@@ -1076,6 +2618,9 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 	decoder->video_codec_ctx = avcodec_alloc_context3(video_codec);
 	avcodec_parameters_to_context(decoder->video_codec_ctx, video_stream->codecpar);
 	
+	/* Threading and decode shortcuts from the performance policy */
+	decode_policy_apply_codec_open(decoder->policy, decoder->video_codec_ctx);
+	
 	/* Get sample aspect ratio (SAR) for proper display */
 	AVRational sar = decoder->video_codec_ctx->sample_aspect_ratio;
 	if (sar.num == 0 || sar.den == 0) {
@@ -1095,7 +2640,7 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 	if (width <= 0 || height <= 0) {
 		blog(LOG_ERROR, "Invalid video resolution: %dx%d", width, height);
 		avcodec_free_context(&decoder->video_codec_ctx);
-		avformat_close_input(&decoder->format_ctx);
+		close_input(decoder);
 		return false;
 	}
 	
@@ -1217,6 +2762,7 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 				decoder->video_codec_ctx = avcodec_alloc_context3(video_codec);
 				AVStream *video_stream = decoder->format_ctx->streams[decoder->video_stream_idx];
 				avcodec_parameters_to_context(decoder->video_codec_ctx, video_stream->codecpar);
+				decode_policy_apply_codec_open(decoder->policy, decoder->video_codec_ctx);
 			}
 		}
 		
@@ -1229,7 +2775,7 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 			if (avcodec_open2(decoder->video_codec_ctx, video_codec, NULL) < 0) {
 				blog(LOG_ERROR, "[HEVC] Failed to open HEVC codec in software mode");
 				avcodec_free_context(&decoder->video_codec_ctx);
-				avformat_close_input(&decoder->format_ctx);
+				close_input(decoder);
 				return false;
 			}
 		}
@@ -1242,10 +2788,18 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 			blog(LOG_INFO, "Using software decoding for %s", video_codec->name);
 		}
 		
+		/* Decode at reduced resolution when the target size allows it */
+		decoder->lowres = choose_lowres(decoder, video_codec);
+		decoder->video_codec_ctx->lowres = decoder->lowres;
+		if (decoder->lowres > 0) {
+			blog(LOG_INFO, "Using lowres %d for target size %dx%d", decoder->lowres,
+				decoder->target_width, decoder->target_height);
+		}
+		
 		if (avcodec_open2(decoder->video_codec_ctx, video_codec, NULL) < 0) {
 			blog(LOG_ERROR, "Failed to open video codec");
 			avcodec_free_context(&decoder->video_codec_ctx);
-			avformat_close_input(&decoder->format_ctx);
+			close_input(decoder);
 			return false;
 		}
 	}
@@ -1273,38 +2827,7 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 				decoder->audio_stream_idx = -1;
 			} else {
 				/* Setup audio resampler if needed */
-				if (decoder->audio_codec_ctx->sample_fmt != AV_SAMPLE_FMT_FLTP ||
-				    decoder->audio_codec_ctx->ch_layout.nb_channels != 2) {
-					
-					AVChannelLayout stereo_layout = AV_CHANNEL_LAYOUT_STEREO;
-					decoder->swr_ctx = swr_alloc();
-					av_opt_set_chlayout(decoder->swr_ctx, "in_chlayout", &decoder->audio_codec_ctx->ch_layout, 0);
-					av_opt_set_int(decoder->swr_ctx, "in_sample_rate", decoder->audio_codec_ctx->sample_rate, 0);
-					av_opt_set_sample_fmt(decoder->swr_ctx, "in_sample_fmt", decoder->audio_codec_ctx->sample_fmt, 0);
-					av_opt_set_chlayout(decoder->swr_ctx, "out_chlayout", &stereo_layout, 0);
-					av_opt_set_int(decoder->swr_ctx, "out_sample_rate", decoder->audio_codec_ctx->sample_rate, 0);
-					av_opt_set_sample_fmt(decoder->swr_ctx, "out_sample_fmt", AV_SAMPLE_FMT_FLTP, 0);
-					swr_init(decoder->swr_ctx);
-					
-					/* Allocate resampled audio buffer */
-					decoder->max_resampled_samples = 4096;  /* Conservative max samples per frame */
-					int ret = av_samples_alloc(decoder->resampled_audio_data, 
-						&decoder->resampled_audio_linesize,
-						2,  /* stereo output */
-						decoder->max_resampled_samples,
-						AV_SAMPLE_FMT_FLTP,
-						0);
-					if (ret < 0) {
-						blog(LOG_WARNING, "Failed to allocate resampled audio buffer");
-						swr_free(&decoder->swr_ctx);
-					} else {
-						blog(LOG_INFO, "Audio resampler initialized: %s %dHz %dch -> FLTP %dHz stereo",
-							av_get_sample_fmt_name(decoder->audio_codec_ctx->sample_fmt),
-							decoder->audio_codec_ctx->sample_rate,
-							decoder->audio_codec_ctx->ch_layout.nb_channels,
-							decoder->audio_codec_ctx->sample_rate);
-					}
-				}
+				setup_audio_resampler(decoder, false);
 				
 				blog(LOG_INFO, "Audio codec opened: %s, %d Hz, %d channels",
 					audio_codec->name,
@@ -1327,26 +2850,23 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 	 * Note: When hardware decoding is enabled, the codec's pix_fmt will be the HW format.
 	 * We'll create the scaler later when we know the actual software format.
 	 */
+	/* Sync scaler settings and queue depth with the policy */
+	apply_policy(decoder);
+	
 	if (!decoder->hw_decoding_enabled) {
 		enum AVPixelFormat src_pix_fmt = decoder->video_codec_ctx->pix_fmt;
 		
-		/* Use corrected dimensions for output if aspect ratio correction is needed */
-		int output_width = decoder->needs_aspect_correction ? decoder->adjusted_width : decoder->video_codec_ctx->width;
-		int output_height = decoder->needs_aspect_correction ? decoder->adjusted_height : decoder->video_codec_ctx->height;
+		/* Aspect-corrected and target-fitted output size */
+		int output_width, output_height;
+		get_output_size(decoder, &output_width, &output_height);
 		
 		blog(LOG_INFO, "[FFmpeg Decoder] Creating scaler: %dx%d -> %dx%d, pix_fmt=%s -> BGRA",
 			decoder->video_codec_ctx->width, decoder->video_codec_ctx->height,
 			output_width, output_height,
 			av_get_pix_fmt_name(src_pix_fmt));
 		
-		decoder->sws_ctx = sws_getContext(
-			decoder->video_codec_ctx->width, decoder->video_codec_ctx->height,
-			src_pix_fmt,
-			output_width, output_height,
-			AV_PIX_FMT_BGRA,  /* BGRA format - known to work */
-			SWS_FAST_BILINEAR, NULL, NULL, NULL);
-		
-		if (!decoder->sws_ctx) {
+		if (!create_bgra_scaler(decoder, decoder->video_codec_ctx->width,
+		                        decoder->video_codec_ctx->height, src_pix_fmt)) {
 			blog(LOG_ERROR, "[FFmpeg Decoder] Failed to create scaler context");
 			ffmpeg_decoder_destroy(decoder);
 			return false;
@@ -1381,12 +2901,148 @@ bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path)
 	decoder->current_path = bstrdup(path);
 	decoder->duration = decoder->format_ctx->duration;
 	
+	/* Seek targets and clock positions are relative to the stream start
+	 * (e.g. MPEG-TS timestamps rarely start at zero) */
+	AVStream *start_stream = decoder->format_ctx->streams[decoder->video_stream_idx];
+	decoder->start_pts_us = start_stream->start_time != AV_NOPTS_VALUE ?
+		av_rescale_q(start_stream->start_time, start_stream->time_base, AV_TIME_BASE_Q) : 0;
+	
+	load_keyframe_index(decoder, start_stream);
+	setup_alpha_cache(decoder, start_stream);
+	av_frame_free(&decoder->deinterlace.pending);
+	decoder->deinterlace.active = false;
+	decoder->hdr_logged = false;
+	
 	decoder->initialized = true;
 	blog(LOG_INFO, "Initialized: %s", path);
 	
 	return true;
 }
 
+/* Reads packets into the queue up to its limits ahead of the decoder, so
+ * slow reads and slow decodes don't hold each other up. Also services demuxer
+ * seeks and rewinds at the end of the file, queueing an empty packet
+ * (stream_index -1) to tell the decoder thread where the file ended */
+static void *demux_thread(void *opaque)
+{
+	struct ffmpeg_decoder *decoder = opaque;
+	
+	set_thread_name("fmgnice-demux");
+	
+	AVPacket *packet = av_packet_alloc();
+	AVStream *video_stream = decoder->format_ctx->streams[decoder->video_stream_idx];
+	AVStream *audio_stream = decoder->audio_codec_ctx ?
+		decoder->format_ctx->streams[decoder->audio_stream_idx] : NULL;
+	
+	/* Queued duration of video packets that don't carry one */
+	int64_t frame_us = video_stream->avg_frame_rate.num > 0 && video_stream->avg_frame_rate.den > 0 ?
+		av_rescale_q(1, av_inv_q(video_stream->avg_frame_rate), AV_TIME_BASE_Q) : 0;
+	bool at_end = false;
+	
+	while (packet && !atomic_load(&decoder->stopping)) {
+		pthread_mutex_lock(&decoder->mutex);
+		bool seek = decoder->demux_seek.pending;
+		int64_t seek_pts = decoder->demux_seek.pts;
+		uint32_t generation = decoder->demux_seek.generation;
+		decoder->demux_seek.pending = false;
+		bool looping = decoder->looping;
+		pthread_mutex_unlock(&decoder->mutex);
+		
+		if (seek) {
+			if (decoder->read_ahead_active) {
+				/* Start loading the keyframe's data while the demuxer seeks */
+				const AVIndexEntry *entry = avformat_index_get_entry_from_timestamp(
+					video_stream, seek_pts, AVSEEK_FLAG_BACKWARD);
+				if (entry)
+					readahead_io_hint(decoder->custom_io, entry->pos);
+			}
+			av_seek_frame(decoder->format_ctx, decoder->video_stream_idx, seek_pts, AVSEEK_FLAG_BACKWARD);
+			decoder->demux_generation = generation;
+			at_end = false;
+			
+			pthread_mutex_lock(&decoder->mutex);
+			decoder->demux_position_us = INT64_MIN;
+			pthread_mutex_unlock(&decoder->mutex);
+		}
+		
+		/* Not looping - wait for a seek */
+		if (at_end) {
+			os_sleep_ms(20);
+			continue;
+		}
+		
+		/* Read packet - will be interrupted if interrupt_request is set */
+		int ret = av_read_frame(decoder->format_ctx, packet);
+		if (ret < 0) {
+			if (ret == AVERROR_EXIT || decoder->interrupt_request)
+				break;
+			
+			if (ret == AVERROR_EOF) {
+				packet->stream_index = -1;
+				if (!packet_queue_put(decoder->packets, packet, PACKET_QUEUE_VIDEO, 0,
+				                      decoder->demux_generation))
+					break;
+				
+				if (looping)
+					av_seek_frame(decoder->format_ctx, -1, 0, AVSEEK_FLAG_BACKWARD);
+				else
+					at_end = true;
+				
+				pthread_mutex_lock(&decoder->mutex);
+				decoder->demux_position_us = INT64_MIN;
+				pthread_mutex_unlock(&decoder->mutex);
+				continue;
+			}
+			
+			/* Error reading - sleep briefly and try again */
+			os_sleep_ms(10);
+			continue;
+		}
+		
+		enum packet_queue_stream stream;
+		int64_t duration_us = 0;
+		if (packet->stream_index == decoder->video_stream_idx) {
+			stream = PACKET_QUEUE_VIDEO;
+			duration_us = packet->duration > 0 ?
+				av_rescale_q(packet->duration, video_stream->time_base, AV_TIME_BASE_Q) : frame_us;
+			
+			/* What the seek planner knows about the file so far */
+			if (packet->pts != AV_NOPTS_VALUE) {
+				int64_t pts_us = av_rescale_q(packet->pts, video_stream->time_base, AV_TIME_BASE_Q);
+				pthread_mutex_lock(&decoder->mutex);
+				if (pts_us > decoder->demux_position_us)
+					decoder->demux_position_us = pts_us;
+				if ((packet->flags & AV_PKT_FLAG_KEY) && !decoder->intra_only)
+					add_keyframe(decoder, pts_us);
+				pthread_mutex_unlock(&decoder->mutex);
+			}
+		} else if (audio_stream && packet->stream_index == decoder->audio_stream_idx) {
+			stream = PACKET_QUEUE_AUDIO;
+			if (packet->duration > 0)
+				duration_us = av_rescale_q(packet->duration, audio_stream->time_base, AV_TIME_BASE_Q);
+		} else {
+			av_packet_unref(packet);
+			continue;
+		}
+		
+		/* Waits while the stream's share of the queue is full */
+		if (!packet_queue_put(decoder->packets, packet, stream, duration_us, decoder->demux_generation))
+			break;
+	}
+	
+	av_packet_free(&packet);
+	
+	struct packet_queue_stats stats;
+	packet_queue_get_stats(decoder->packets, &stats);
+	blog(LOG_INFO, "Demux thread stopped - queue peak %lld KB video, %lld KB audio, "
+		"%llu waits for room, %llu underruns, %llu packets dropped at seeks",
+		(long long)(stats.peak_bytes[PACKET_QUEUE_VIDEO] / 1024),
+		(long long)(stats.peak_bytes[PACKET_QUEUE_AUDIO] / 1024),
+		(unsigned long long)stats.full_waits, (unsigned long long)stats.underruns,
+		(unsigned long long)stats.dropped);
+	return NULL;
+}
+
 static void *decoder_thread(void *opaque)
 {
 	struct ffmpeg_decoder *decoder = opaque;
@@ -1400,6 +3056,8 @@ static void *decoder_thread(void *opaque)
 	AVPacket *packet = av_packet_alloc();
 	uint64_t last_video_pts = 0;
 	uint64_t frames_decoded = 0;
+	int64_t last_decoded_pts_us = AV_NOPTS_VALUE;
+	uint32_t frames_since_seek = 0;
 	
 	blog(LOG_INFO, "Decoder thread started - format_ctx: %p, video_codec_ctx: %p",
 		decoder->format_ctx, decoder->video_codec_ctx);
@@ -1429,34 +3087,66 @@ static void *decoder_thread(void *opaque)
 		if (atomic_load(&decoder->seek_request)) {
 			atomic_store(&decoder->seek_request, false);
 			int64_t seek_target = decoder->seek_target;
+			bool seek_accurate = decoder->seek_target_accurate;
+			/* The clock is re-anchored at the seek target, pending slew is moot */
+			decoder->pending_clock_slew_ns = 0;
+			atomic_store(&decoder->clock_slew_active, false);
 			pthread_mutex_unlock(&decoder->mutex);
 			
-			/* Clear frame buffer before seeking */
-			pthread_mutex_lock(&decoder->buffer.lock);
-			for (int i = 0; i < 3; i++) {
-				decoder->buffer.frames[i].ready = false;
-				if (decoder->buffer.frames[i].frame) {
-					av_frame_unref(decoder->buffer.frames[i].frame);
-				}
+			int64_t seek_abs = seek_target + decoder->start_pts_us;
+			
+			/* A newer target makes the accurate-seek decode in progress moot */
+			if (decoder->discard_until_pts != AV_NOPTS_VALUE)
+				decoder->seek_stats.aborted++;
+			
+			if (seek_within_buffer(decoder, seek_abs)) {
+				decoder->seek_stats.skipped++;
+				blog(LOG_INFO, "Seek to %lld us served from queued frames (%llu of %llu seeks skipped, %llu coalesced)",
+					(long long)seek_target, (unsigned long long)decoder->seek_stats.skipped,
+					(unsigned long long)decoder->seek_stats.requested,
+					(unsigned long long)decoder->seek_stats.coalesced);
+				continue;
+			}
+			
+			/* Frames already buffered are from before the seek */
+			next_frame_generation(decoder);
+			
+			/* Close enough ahead - keep decoding, showing nothing until the target */
+			if (plan_forward_decode(decoder, last_decoded_pts_us, seek_abs, seek_accurate)) {
+				decoder->seek_stats.forwarded++;
+				decoder->waiting_for_first_frame = true;
+				decoder->waiting_for_first_audio = true;
+				decoder->discard_until_pts = seek_abs - 1;
+				blog(LOG_INFO, "Seek to %lld us: decoding forward %lld ms instead of seeking",
+					(long long)seek_target, (long long)((seek_abs - last_decoded_pts_us) / 1000));
+				continue;
 			}
-			decoder->buffer.write_idx = 0;
-			decoder->buffer.read_idx = 0;
-			decoder->buffer.count = 0;
-			pthread_mutex_unlock(&decoder->buffer.lock);
+			
+			/* Any catch-up in progress was towards the old target */
+			end_catchup(decoder);
 			
 			/* Seek to target position */
-			int64_t seek_pts = av_rescale_q(seek_target, AV_TIME_BASE_Q,
+			int64_t seek_pts = av_rescale_q(seek_abs, AV_TIME_BASE_Q,
 				decoder->format_ctx->streams[decoder->video_stream_idx]->time_base);
-			av_seek_frame(decoder->format_ctx, decoder->video_stream_idx, seek_pts, AVSEEK_FLAG_BACKWARD);
+			request_demux_seek(decoder, seek_pts);
 			
 			/* Flush codec buffers */
 			avcodec_flush_buffers(decoder->video_codec_ctx);
 			if (decoder->audio_codec_ctx)
 				avcodec_flush_buffers(decoder->audio_codec_ctx);
+			decoder->alpha_cache.decoder_behind = false;
+			av_frame_free(&decoder->deinterlace.pending);
 			
 			/* Reset for seek - clock will be reset on first frame */
 			decoder->waiting_for_first_frame = true;
 			decoder->waiting_for_first_audio = true;
+			decoder->seek_start_time = os_gettime_ns();
+			frames_since_seek = 0;
+			/* Accurate: decode from the keyframe but only show from the target */
+			decoder->discard_until_pts = seek_accurate && seek_target > 0 ?
+				seek_abs - 1 : AV_NOPTS_VALUE;
+			if (seek_accurate)
+				start_catchup(decoder, seek_abs);
 			
 			blog(LOG_INFO, "Seek requested to %lld us, clock will reset on first frame", 
 				(long long)seek_target);
@@ -1468,74 +3158,86 @@ static void *decoder_thread(void *opaque)
 		if (atomic_load(&decoder->stopping))
 			break;
 		
-		/* Read packet - will be interrupted if interrupt_request is set */
-		int ret = av_read_frame(decoder->format_ctx, packet);
+		/* Next packet from the demux thread. The wait is short so seek and
+		 * stop requests are still seen while the demuxer is slow */
+		uint32_t packet_generation = 0;
+		int ret = packet_queue_get(decoder->packets, packet, &packet_generation, 20);
 		if (ret < 0) {
-			/* Check if we were interrupted */
-			if (ret == AVERROR_EXIT || decoder->interrupt_request) {
-				blog(LOG_INFO, "Decoder thread interrupted");
-				break;
-			}
-			/* End of file or error */
-			if (decoder->looping && ret == AVERROR_EOF) {
+			blog(LOG_INFO, "Decoder thread interrupted");
+			break;
+		}
+		if (ret == 0)
+			continue;
+		if (packet_generation != decoder->seek_generation) {
+			av_packet_unref(packet);
+			continue;
+		}
+		
+		/* End of file marker */
+		if (packet->stream_index < 0) {
+			end_catchup(decoder);
+			if (decoder->looping) {
 				blog(LOG_INFO, "End of file reached, looping back to start");
 				
-				/* Clear frame buffer before looping */
-				pthread_mutex_lock(&decoder->buffer.lock);
-				for (int i = 0; i < 3; i++) {
-					decoder->buffer.frames[i].ready = false;
-					decoder->buffer.frames[i].pts = -1;  /* Mark as invalid */
-					decoder->buffer.frames[i].system_time = 0;
-					if (decoder->buffer.frames[i].frame) {
-						av_frame_unref(decoder->buffer.frames[i].frame);
-					}
-				}
-				decoder->buffer.write_idx = 0;
-				decoder->buffer.read_idx = 0;
-				decoder->buffer.count = 0;
-				/* Signal display thread that buffer changed */
-				pthread_cond_broadcast(&decoder->buffer.cond);
-				pthread_mutex_unlock(&decoder->buffer.lock);
-				
-				/* Longer delay to ensure display thread processes the clear */
-				os_sleep_ms(30);
+				/* Frames still buffered are timed for the previous pass */
+				next_frame_generation(decoder);
 				
-				/* Loop back to start */
-				av_seek_frame(decoder->format_ctx, -1, 0, AVSEEK_FLAG_BACKWARD);
+				/* The demuxer is already back at the start */
 				avcodec_flush_buffers(decoder->video_codec_ctx);
 				if (decoder->audio_codec_ctx)
 					avcodec_flush_buffers(decoder->audio_codec_ctx);
+				decoder->alpha_cache.decoder_behind = false;
+				av_frame_free(&decoder->deinterlace.pending);
 				
 				/* Reset for loop - clock will be reset on first frame */
 				decoder->waiting_for_first_frame = true;
 				decoder->waiting_for_first_audio = true;
+				decoder->discard_until_pts = AV_NOPTS_VALUE;
 				
 				blog(LOG_INFO, "Looping: seek complete, waiting for first frame");
-				continue;
-			} else if (ret == AVERROR_EOF) {
+			} else {
 				/* End of file, no loop - stop playback and wait */
 				pthread_mutex_lock(&decoder->mutex);
 				atomic_store(&decoder->playing, false);
 				pthread_mutex_unlock(&decoder->mutex);
-				/* Sleep to avoid busy loop */
-				os_sleep_ms(100);
-				continue;
-			} else if (ret < 0) {
-				/* Error reading - sleep briefly and try again */
-				os_sleep_ms(10);
-				continue;
 			}
+			continue;
 		}
 		
 		/* Decode video packet */
 		if (packet->stream_index == decoder->video_stream_idx) {
-			ret = avcodec_send_packet(decoder->video_codec_ctx, packet);
-			if (ret >= 0) {
-				while (avcodec_receive_frame(decoder->video_codec_ctx, decoder->frame) >= 0) {
-					/* Start performance tracking for this frame */
-					if (decoder->perf_monitor) {
-						perf_monitor_frame_start((perf_monitor_t*)decoder->perf_monitor);
-					}
+			/* Pick up policy and target size changes before decoding the next packet.
+			 * A lowres reopen rewinds to a keyframe, so this packet is stale. */
+			if (apply_target_size(decoder, last_decoded_pts_us)) {
+				av_packet_unref(packet);
+				continue;
+			}
+			apply_policy(decoder);
+			apply_rate(decoder);
+			apply_clock_slew(decoder);
+			
+			/* Keyframe-only rates: don't even hand other packets to the codec */
+			if (decoder->rate_skip_frame == AVDISCARD_NONKEY && !(packet->flags & AV_PKT_FLAG_KEY)) {
+				av_packet_unref(packet);
+				continue;
+			}
+			
+			/* Frames of a cached alpha loop are served without decoding */
+			int cached = use_alpha_cache(decoder, packet);
+			if (cached < 0) {
+				av_packet_unref(packet);
+				continue;
+			}
+			
+			/* Start performance tracking before the packet is decoded so
+			 * decode time includes the codec's actual work */
+			if (decoder->perf_monitor) {
+				perf_monitor_frame_start((perf_monitor_t*)decoder->perf_monitor);
+			}
+			/* Catching up: the GOP workers decode this stretch, not the packets */
+			ret = decoder->catchup.active || cached ? 0 : avcodec_send_packet(decoder->video_codec_ctx, packet);
+			if (ret >= 0) {
+				while (receive_video_frame(decoder, packet) >= 0) {
 					/* Handle hardware frame transfer if needed */
 					AVFrame *sw_frame = decoder->frame;
 					if (decoder->hw_decoding_active && decoder->frame->format == decoder->hw_pix_fmt) {
@@ -1587,24 +3289,17 @@ static void *decoder_thread(void *opaque)
 						    sw_frame->format != AV_PIX_FMT_P010LE) {
 							enum AVPixelFormat sw_pix_fmt = sw_frame->format;
 							
-							/* Use corrected dimensions for output if aspect ratio correction is needed */
-							int output_width = decoder->needs_aspect_correction ? decoder->adjusted_width : decoder->video_codec_ctx->width;
-							int output_height = decoder->needs_aspect_correction ? decoder->adjusted_height : decoder->video_codec_ctx->height;
+							/* Aspect-corrected and target-fitted output size */
+							int output_width, output_height;
+							get_output_size(decoder, &output_width, &output_height);
 							
 							blog(LOG_INFO, "[FFmpeg Decoder] Creating HW scaler: %dx%d -> %dx%d, %s -> BGRA",
 								sw_frame->width, sw_frame->height,
 								output_width, output_height,
 								av_get_pix_fmt_name(sw_pix_fmt));
 							
-							/* Use BILINEAR for hardware decoded frames for performance
-							 * Hardware decoding + complex scaling can overload the system */
-							decoder->sws_ctx = sws_getContext(
-								sw_frame->width, sw_frame->height, sw_pix_fmt,
-								output_width, output_height,
-								AV_PIX_FMT_BGRA,  /* BGRA format - known to work */
-								SWS_BILINEAR | SWS_ACCURATE_RND, NULL, NULL, NULL);
-							
-							if (!decoder->sws_ctx) {
+							/* Scaler algorithm comes from the performance policy */
+							if (!create_bgra_scaler(decoder, sw_frame->width, sw_frame->height, sw_pix_fmt)) {
 								blog(LOG_ERROR, "[FFmpeg Decoder] Failed to create HW scaler context for format %s",
 									av_get_pix_fmt_name(sw_pix_fmt));
 								decoder->hw_decoding_active = false;
@@ -1626,7 +3321,8 @@ static void *decoder_thread(void *opaque)
 					
 					if (sw_frame->pts != AV_NOPTS_VALUE) {
 						double pts_seconds = sw_frame->pts * av_q2d(stream->time_base);
-						pts_us = (int64_t)(pts_seconds * 1000000.0);
+						/* Second fields are shown half a frame after their frame */
+						pts_us = (int64_t)(pts_seconds * 1000000.0) + decoder->deinterlace.field_offset_us;
 					}
 					
 					/* Mark decode complete for performance tracking */
@@ -1634,27 +3330,102 @@ static void *decoder_thread(void *opaque)
 						perf_monitor_decode_complete((perf_monitor_t*)decoder->perf_monitor);
 					}
 					
-					/* On first frame after start/seek, reset clock */
+					if (pts_us != AV_NOPTS_VALUE)
+						last_decoded_pts_us = pts_us;
+					frames_since_seek++;
+					
+					/* Codec was reopened or accurate seek - skip frames before the
+					 * target. Done before the clock is anchored on the first frame */
+					if (decoder->discard_until_pts != AV_NOPTS_VALUE && pts_us != AV_NOPTS_VALUE) {
+						/* A newer seek replaces this one, stop decoding towards its target */
+						if (atomic_load(&decoder->seek_request)) {
+							av_frame_unref(decoder->frame);
+							break;
+						}
+						if (pts_us <= decoder->discard_until_pts) {
+							av_frame_unref(decoder->frame);
+							if (decoder->perf_monitor) {
+								perf_monitor_frame_start((perf_monitor_t*)decoder->perf_monitor);
+							}
+							continue;
+						}
+						decoder->discard_until_pts = AV_NOPTS_VALUE;
+					}
+					
+					/* On first frame after start/seek, reset clock unless audio already anchored it */
 					if (decoder->waiting_for_first_frame && pts_us != AV_NOPTS_VALUE) {
-						clock_reset(decoder, pts_us);
+						if (decoder->waiting_for_first_audio)
+							clock_reset(decoder, pts_us);
 						decoder->waiting_for_first_frame = false;
+						decoder->last_selected_display_time = 0;
 						decoder->pts_offset = pts_us * 1000;  /* Video PTS offset in ns */
+						measure_seek(decoder, frames_since_seek);
 						
-						/* Only set start time if audio hasn't set it yet */
-						if (decoder->waiting_for_first_audio) {
-							decoder->start_time_ns = os_gettime_ns();
-						}
-						
-						blog(LOG_INFO, "First video frame after seek/start, PTS %lld us, start_time set: %s", 
+						blog(LOG_INFO, "First video frame after seek/start, PTS %lld us, clock anchored: %s", 
 							(long long)pts_us, decoder->waiting_for_first_audio ? "yes" : "no");
 					}
 					
+					/* Governor budget: drop frames before any conversion work */
+					if (decoder->frame_decimation > 1 &&
+					    decoder->decimation_counter++ % decoder->frame_decimation != 0) {
+						av_frame_unref(decoder->frame);
+						if (decoder->perf_monitor) {
+							perf_monitor_frame_start((perf_monitor_t*)decoder->perf_monitor);
+						}
+						continue;
+					}
+					
 					if (pts_us != AV_NOPTS_VALUE) {
+						/* Interlaced frames are deinterlaced before any conversion,
+						 * hardware ones after their transfer */
+						sw_frame = deinterlace_decoded(decoder, sw_frame);
+						
+						/* Downscaling for a target size routes every format through the scaler */
+						bool downscale = is_target_downscaled(decoder, sw_frame);
+						
+						/* Software frames OBS can take as they are are passed by
+						 * reference, resizing still needs the CPU scaler */
+						enum video_format native_format = VIDEO_FORMAT_NONE;
+						if (sw_frame == decoder->frame && !downscale &&
+						    !decoder->needs_aspect_correction && decoder->scale_divisor == 1)
+							native_format = negotiate_video_format(sw_frame->format);
+						/* HDR frames keep their 10 bits, hardware P010 included, and
+						 * are resized at 10 bits when the output size differs */
+						if (is_hdr_frame(sw_frame)) {
+							sw_frame = resize_hdr_frame(decoder, sw_frame);
+							native_format = negotiate_video_format(sw_frame->format);
+							if (!decoder->hdr_logged) {
+								decoder->hdr_logged = true;
+								blog(LOG_INFO, "[FFmpeg Decoder] HDR %s passthrough: %s",
+									sw_frame->color_trc == AVCOL_TRC_SMPTE2084 ? "PQ" : "HLG",
+									native_format != VIDEO_FORMAT_NONE ? av_get_pix_fmt_name(sw_frame->format) :
+									"format not supported, converted to SDR");
+							}
+						}
+						/* The I412 repack and alpha conversion need the SIMD kernels */
+						if (native_format == VIDEO_FORMAT_I412 && !simd_get_best_10_to_12_repack())
+							native_format = VIDEO_FORMAT_NONE;
+						if (native_format == VIDEO_FORMAT_BGRA && sw_frame->format != AV_PIX_FMT_BGRA &&
+						    !simd_check_sse42())
+							native_format = VIDEO_FORMAT_NONE;
+						
 						/* Check if scaler is ready for formats that need it */
-						bool needs_scaler = !(decoder->hw_decoding_active && 
+						bool needs_scaler = downscale || !(decoder->hw_decoding_active && 
 						                     (sw_frame->format == AV_PIX_FMT_NV12 || sw_frame->format == AV_PIX_FMT_P010LE));
+						/* 10-bit software frames go through the NV12 converter at native size */
+						if (!downscale && sw_frame->format == AV_PIX_FMT_YUV420P10LE)
+							needs_scaler = false;
+						if (native_format != VIDEO_FORMAT_NONE)
+							needs_scaler = false;
 						
-						if (needs_scaler && !decoder->sws_ctx) {
+						/* (Re)create the scaler if missing or the input changed (e.g. lowres reopen) */
+						bool scaler_stale = !decoder->sws_ctx ||
+							decoder->sws_src_format != sw_frame->format ||
+							decoder->sws_src_width != sw_frame->width ||
+							decoder->sws_src_height != sw_frame->height;
+						
+						if (needs_scaler && scaler_stale &&
+						    !create_bgra_scaler(decoder, sw_frame->width, sw_frame->height, sw_frame->format)) {
 							blog(LOG_WARNING, "[FFmpeg Decoder] Scaler not ready for frame format %s with PTS %lld, skipping", 
 								av_get_pix_fmt_name(sw_frame->format), (long long)pts_us);
 							if (decoder->frame) {
@@ -1671,6 +3442,18 @@ static void *decoder_thread(void *opaque)
 						/* Get target display time using clock system */
 						uint64_t display_time = clock_get_system_time_for_pts(decoder, pts_us);
 						
+						/* Faster than 1x: skip frames that would share an output frame with
+						 * the previous one before paying for conversion */
+						if (decoder->rate_frame_interval_ns && decoder->last_selected_display_time &&
+						    display_time < decoder->last_selected_display_time + decoder->rate_frame_interval_ns) {
+							av_frame_unref(decoder->frame);
+							if (decoder->perf_monitor) {
+								perf_monitor_frame_start((perf_monitor_t*)decoder->perf_monitor);
+							}
+							continue;
+						}
+						decoder->last_selected_display_time = display_time;
+						
 						if (frames_decoded % 100 == 0) {
 							blog(LOG_INFO, "[FFmpeg Decoder] Display time calculated: %llu", 
 								(unsigned long long)display_time);
@@ -1688,14 +3471,23 @@ static void *decoder_thread(void *opaque)
 						}
 						
 						/* Wait if buffer is full */
-						while (decoder->buffer.count >= 3 && !atomic_load(&decoder->stopping)) {
+						uint64_t wait_start = os_gettime_ns();
+						while (decoder->buffer.count >= decoder->buffer.depth && !atomic_load(&decoder->stopping) &&
+							!atomic_load(&decoder->seek_request)) {
 							/* Signal display thread that frames are available */
 							pthread_cond_signal(&decoder->buffer.cond);
 							/* Wait with condition variable instead of polling */
 							pthread_cond_wait(&decoder->buffer.cond, &decoder->buffer.lock);
 						}
+						/* Time spent waiting for the display is not decode/convert load */
+						if (decoder->perf_monitor) {
+							perf_monitor_exclude_wait((perf_monitor_t*)decoder->perf_monitor,
+								os_gettime_ns() - wait_start);
+						}
 						
-						if (!atomic_load(&decoder->stopping)) {
+						/* A frame from before a pending seek is dropped rather than
+						 * waited on */
+						if (!atomic_load(&decoder->stopping) && !atomic_load(&decoder->seek_request)) {
 							/* Get next buffer slot */
 							struct buffered_frame *buf_frame = &decoder->buffer.frames[decoder->buffer.write_idx];
 							
@@ -1721,7 +3513,7 @@ static void *decoder_thread(void *opaque)
 							
 							/* For P010 hardware format, pass directly to OBS - no conversion needed */
 							/* For YUV420P10 software format, we still need to convert */
-							if (is_yuv420p10) {
+							if (is_yuv420p10 && !downscale && native_format == VIDEO_FORMAT_NONE) {
 								if (frames_decoded == 0) {
 									blog(LOG_INFO, "[FFmpeg Decoder] Detected 10-bit format: %s (%d), will convert to 8-bit",
 										av_get_pix_fmt_name(sw_frame->format), sw_frame->format);
@@ -1798,36 +3590,85 @@ static void *decoder_thread(void *opaque)
 								temp_frame->pts = sw_frame->pts;
 								temp_frame->pkt_dts = sw_frame->pkt_dts;
 								temp_frame->best_effort_timestamp = sw_frame->best_effort_timestamp;
+								temp_frame->colorspace = sw_frame->colorspace;
+								temp_frame->color_range = sw_frame->color_range;
 								
 								/* Use the 8-bit frame instead */
 								sw_frame = temp_frame;
 								temp_frame_to_free = temp_frame;  /* Remember to free it later */
 							}
 							
+							/* 10-bit 4:4:4 is shown as I412 from a repacked copy */
+							if (native_format == VIDEO_FORMAT_I412 && sw_frame->format == AV_PIX_FMT_YUV444P10LE) {
+								AVFrame *repacked = repack_to_i412(sw_frame);
+								if (!repacked) {
+									blog(LOG_ERROR, "[FFmpeg Decoder] Failed to repack 10-bit 4:4:4 frame for I412 output");
+									pthread_mutex_unlock(&decoder->buffer.lock);
+									continue;
+								}
+								sw_frame = repacked;
+								temp_frame_to_free = repacked;
+							}
+							
+							/* Alpha sources go from their planes to BGRA in one pass */
+							if (native_format == VIDEO_FORMAT_BGRA && sw_frame->format != AV_PIX_FMT_BGRA) {
+								AVFrame *converted = convert_alpha_to_bgra(sw_frame);
+								if (!converted) {
+									blog(LOG_ERROR, "[FFmpeg Decoder] Failed to convert %s frame to BGRA",
+										av_get_pix_fmt_name(sw_frame->format));
+									pthread_mutex_unlock(&decoder->buffer.lock);
+									continue;
+								}
+								sw_frame = converted;
+								temp_frame_to_free = converted;
+								cache_alpha_frame(decoder, converted);
+							}
+							/* A decoded frame is stored, any resync is done */
+							if (!decoder->alpha_cache.from_cache)
+								decoder->alpha_cache.resyncing = false;
+							
 							/* Always output NV12 or P010 for hardware frames */
 							/* For BGRA output mode with hardware frames, we still output NV12/P010 to OBS */
-							bool is_hw_format = (sw_frame->format == AV_PIX_FMT_NV12 || 
+							bool is_hw_format = !downscale &&
+							                    (sw_frame->format == AV_PIX_FMT_NV12 || 
 							                     sw_frame->format == AV_PIX_FMT_P010LE);
 							buf_frame->is_hw_frame = is_hw_format;
 							
 							/* Check if we can use zero-copy (direct frame reference) */
 							/* P010LE MUST use zero-copy since we can't convert it */
 							bool can_zero_copy = false;
-							if (is_p010) {
+							if (is_p010 && !downscale) {
 								/* P010 must always use zero-copy - we can't convert it */
 								can_zero_copy = !decoder->needs_aspect_correction;
 							} else if (is_hw_format) {
 								/* NV12 can use zero-copy if configured for NV12 output */
 								can_zero_copy = decoder->use_nv12_output && !decoder->needs_aspect_correction;
 							}
+							/* Negotiated formats are shown from the frame itself */
+							if (native_format != VIDEO_FORMAT_NONE) {
+								buf_frame->is_hw_frame = false;
+								can_zero_copy = true;
+							}
 							buf_frame->zero_copy = can_zero_copy;
+							buf_frame->native_format = native_format;
+							get_frame_color_params(sw_frame, &buf_frame->colorspace, &buf_frame->full_range);
+							get_frame_hdr_params(sw_frame, &buf_frame->trc, &buf_frame->max_luminance);
 							
 							/* Allocate BGRA buffer for this frame if needed */
-							if (!buf_frame->bgra_data[0]) {
-								/* Use corrected dimensions for buffer allocation */
-								int buffer_width = decoder->needs_aspect_correction ? decoder->adjusted_width : decoder->video_codec_ctx->width;
-								int buffer_height = decoder->needs_aspect_correction ? decoder->adjusted_height : decoder->video_codec_ctx->height;
-								
+							int buffer_width, buffer_height;
+							get_output_size(decoder, &buffer_width, &buffer_height);
+							
+							/* Output size changed (resolution budget) - reallocate */
+							if (buf_frame->bgra_data[0] &&
+							    (buf_frame->width != buffer_width || buf_frame->height != buffer_height)) {
+								av_freep(&buf_frame->bgra_data[0]);
+								for (int j = 0; j < 4; j++) {
+									buf_frame->bgra_data[j] = NULL;
+									buf_frame->bgra_linesize[j] = 0;
+								}
+							}
+							
+							if (!buf_frame->bgra_data[0] && native_format == VIDEO_FORMAT_NONE) {
 								int ret = av_image_alloc(buf_frame->bgra_data, (int*)buf_frame->bgra_linesize,
 									buffer_width, buffer_height,
 									AV_PIX_FMT_BGRA, 32);
@@ -1836,30 +3677,25 @@ static void *decoder_thread(void *opaque)
 									pthread_mutex_unlock(&decoder->buffer.lock);
 									continue;
 								}
+								buf_frame->width = buffer_width;
+								buf_frame->height = buffer_height;
 							}
 							
 							/* Create scaler if needed for software frames (but not for hardware formats) */
-							if (!decoder->sws_ctx && !buf_frame->is_hw_frame) {
+							if (!decoder->sws_ctx && !buf_frame->is_hw_frame && native_format == VIDEO_FORMAT_NONE) {
 								enum AVPixelFormat src_pix_fmt = sw_frame->format;
 								
-								/* Use corrected dimensions for output if aspect ratio correction is needed */
-								int output_width = decoder->needs_aspect_correction ? decoder->adjusted_width : decoder->video_codec_ctx->width;
-								int output_height = decoder->needs_aspect_correction ? decoder->adjusted_height : decoder->video_codec_ctx->height;
+								/* Aspect-corrected and target-fitted output size */
+								int output_width, output_height;
+								get_output_size(decoder, &output_width, &output_height);
 								
 								blog(LOG_INFO, "[FFmpeg Decoder] Creating software scaler: %dx%d -> %dx%d, %s -> BGRA",
 									sw_frame->width, sw_frame->height,
 									output_width, output_height,
 									av_get_pix_fmt_name(src_pix_fmt));
 								
-								/* Use BILINEAR for real-time performance
-								 * BICUBIC is better quality but can be too slow for multiple streams */
-								decoder->sws_ctx = sws_getContext(
-									sw_frame->width, sw_frame->height, src_pix_fmt,
-									output_width, output_height,
-									AV_PIX_FMT_BGRA,
-									SWS_BILINEAR | SWS_ACCURATE_RND, NULL, NULL, NULL);
-								
-								if (!decoder->sws_ctx) {
+								/* Scaler algorithm comes from the performance policy */
+								if (!create_bgra_scaler(decoder, sw_frame->width, sw_frame->height, src_pix_fmt)) {
 									blog(LOG_ERROR, "[FFmpeg Decoder] Failed to create software scaler");
 									pthread_mutex_unlock(&decoder->buffer.lock);
 									continue;
@@ -1887,8 +3723,8 @@ static void *decoder_thread(void *opaque)
 								scale_ret = sw_frame->height; /* Success */
 								
 								if (frames_decoded % 100 == 0) {
-									const char *fmt = is_p010 ? "P010" : "NV12";
-									blog(LOG_INFO, "[FFmpeg Decoder] Using %s zero-copy (no memcpy)", fmt);
+									blog(LOG_INFO, "[FFmpeg Decoder] Using %s zero-copy (no memcpy)",
+										av_get_pix_fmt_name(sw_frame->format));
 								}
 							} else if (buf_frame->is_hw_frame && !is_p010) {
 								/* Output NV12 with memory copy (for compatibility) - but NOT for P010! */
@@ -1955,10 +3791,31 @@ static void *decoder_thread(void *opaque)
 							} else if (!buf_frame->is_hw_frame) {
 								/* Convert frame to BGRA into this frame's buffer */
 								
-								/* Try SIMD conversion first for YUV420P only if no aspect correction needed */
+								/* Try SIMD conversion first for planar YUV, only if the
+								 * frame fills the BGRA buffer 1:1 */
 								yuv_convert_func simd_converter = NULL;
-								if (sw_frame->format == AV_PIX_FMT_YUV420P && !decoder->needs_aspect_correction) {
-									simd_converter = simd_get_best_yuv420_converter();
+								yuv10_convert_func simd_converter10 = NULL;
+								if (!decoder->needs_aspect_correction && decoder->scale_divisor == 1 && !downscale &&
+								    buf_frame->width == sw_frame->width && buf_frame->height == sw_frame->height) {
+									switch (sw_frame->format) {
+									case AV_PIX_FMT_YUV420P:
+										simd_converter = simd_get_best_yuv420_converter();
+										break;
+									case AV_PIX_FMT_YUV422P:
+										simd_converter = simd_get_best_yuv422_converter();
+										break;
+									case AV_PIX_FMT_YUV444P:
+										simd_converter = simd_get_best_yuv444_converter();
+										break;
+									case AV_PIX_FMT_YUV422P10LE:
+										simd_converter10 = simd_get_best_yuv422p10_converter();
+										break;
+									case AV_PIX_FMT_YUV444P10LE:
+										simd_converter10 = simd_get_best_yuv444p10_converter();
+										break;
+									default:
+										break;
+									}
 								}
 								
 								if (simd_converter) {
@@ -1970,13 +3827,17 @@ static void *decoder_thread(void *opaque)
 										buf_frame->bgra_data[0], buf_frame->bgra_linesize[0],
 										sw_frame->width, sw_frame->height);
 									scale_ret = sw_frame->height;
+								} else if (simd_converter10) {
+									simd_converter10(
+										(const uint16_t*)sw_frame->data[0], sw_frame->linesize[0],
+										(const uint16_t*)sw_frame->data[1], sw_frame->linesize[1],
+										(const uint16_t*)sw_frame->data[2], sw_frame->linesize[2],
+										buf_frame->bgra_data[0], buf_frame->bgra_linesize[0],
+										sw_frame->width, sw_frame->height);
+									scale_ret = sw_frame->height;
 								} else {
 									/* Use swscale for aspect ratio correction or format conversion */
-									int scale_height = sw_frame->height;  /* Use actual frame height for input */
-									scale_ret = sws_scale(decoder->sws_ctx, 
-										(const uint8_t * const *)sw_frame->data, sw_frame->linesize,
-										0, scale_height,
-										buf_frame->bgra_data, (int*)buf_frame->bgra_linesize);
+									scale_ret = scale_to_bgra(decoder, sw_frame, buf_frame);
 								}
 							}
 							
@@ -2009,15 +3870,18 @@ static void *decoder_thread(void *opaque)
 							}
 							buf_frame->pts = pts_us;
 							buf_frame->system_time = display_time;
+							buf_frame->generation = atomic_load(&decoder->buffer.generation);
 							buf_frame->ready = true;
 							
 							/* Mark frame complete for performance tracking */
 							if (decoder->perf_monitor) {
 								perf_monitor_frame_complete((perf_monitor_t*)decoder->perf_monitor);
+								/* Let Balanced mode react to the bottleneck signals */
+								decode_policy_evaluate(decoder->policy, (perf_monitor_t*)decoder->perf_monitor);
 							}
 							
 							/* Update buffer indices */
-							decoder->buffer.write_idx = (decoder->buffer.write_idx + 1) % 3;
+							decoder->buffer.write_idx = (decoder->buffer.write_idx + 1) % FRAME_BUFFER_SLOTS;
 							int old_count = decoder->buffer.count;
 							decoder->buffer.count++;
 							
@@ -2035,8 +3899,8 @@ static void *decoder_thread(void *opaque)
 							
 							frames_decoded++;
 							if (frames_decoded % 300 == 1) { /* Log every 300 frames (~10 seconds at 30fps) */
-								blog(LOG_INFO, "[FFmpeg Decoder] Decoded frame %lld, PTS=%lld ms, buffer: %d/3, size: %dx%d", 
-									frames_decoded, (long long)(pts_us / 1000), decoder->buffer.count,
+								blog(LOG_INFO, "[FFmpeg Decoder] Decoded frame %lld, PTS=%lld ms, buffer: %d/%d, size: %dx%d", 
+									frames_decoded, (long long)(pts_us / 1000), decoder->buffer.count, decoder->buffer.depth,
 									decoder->video_codec_ctx->width, decoder->video_codec_ctx->height);
 							}
 						}
@@ -2053,11 +3917,32 @@ static void *decoder_thread(void *opaque)
 						av_frame_unref(decoder->frame);
 					}
 					/* Note: hw_frame is reused, don't unref it here */
+					
+					/* Further frames from this packet are timed from here */
+					if (decoder->perf_monitor) {
+						perf_monitor_frame_start((perf_monitor_t*)decoder->perf_monitor);
+					}
 				}
 			}
 		}
 		/* Decode audio packet */
 		else if (packet->stream_index == decoder->audio_stream_idx && decoder->audio_codec_ctx) {
+			/* After a codec reopen the demuxer rewinds to a keyframe - don't replay audio */
+			if (decoder->discard_until_pts != AV_NOPTS_VALUE && packet->pts != AV_NOPTS_VALUE &&
+			    av_rescale_q(packet->pts, decoder->format_ctx->streams[decoder->audio_stream_idx]->time_base,
+			                 AV_TIME_BASE_Q) <= decoder->discard_until_pts) {
+				av_packet_unref(packet);
+				continue;
+			}
+			
+			/* No time-stretching - audio is skipped entirely away from 1x */
+			if (decoder->audio_muted) {
+				av_packet_unref(packet);
+				continue;
+			}
+			
+			apply_sync_master(decoder);
+			
 			ret = avcodec_send_packet(decoder->audio_codec_ctx, packet);
 			if (ret >= 0) {
 				while (avcodec_receive_frame(decoder->audio_codec_ctx, decoder->audio_frame) >= 0) {
@@ -2068,84 +3953,53 @@ static void *decoder_thread(void *opaque)
 					/* Output audio frame */
 					if (decoder->audio_cb && decoder->audio_frame && decoder->audio_frame->nb_samples > 0) {
 						struct obs_source_audio audio = {0};
-						audio.samples_per_sec = decoder->audio_codec_ctx->sample_rate;
+						audio.samples_per_sec = decoder->audio_out_sample_rate;
 						audio.format = AUDIO_FORMAT_FLOAT_PLANAR;
-						audio.speakers = SPEAKERS_STEREO;
+						audio.speakers = decoder->audio_out_speakers;
 						audio.frames = decoder->audio_frame->nb_samples;
 						
-						/* Calculate timestamp - use frame PTS directly */
+						/* Both streams are timed from the same master clock */
 						AVStream *stream = decoder->format_ctx->streams[decoder->audio_stream_idx];
-						if (decoder->audio_frame->pts != AV_NOPTS_VALUE) {
+						bool has_pts = decoder->audio_frame->pts != AV_NOPTS_VALUE;
+						uint64_t master_ns = 0;
+						if (has_pts) {
 							double pts_seconds = decoder->audio_frame->pts * av_q2d(stream->time_base);
-							uint64_t pts_ns = (uint64_t)(pts_seconds * 1000000000.0);
+							int64_t pts_us = (int64_t)(pts_seconds * 1000000.0);
 							
-							/* On first audio frame, establish audio baseline */
+							/* On first audio frame after start/seek, re-anchor the sample clock */
 							if (decoder->waiting_for_first_audio) {
-								decoder->audio_pts_offset = pts_ns;  /* Audio PTS offset */
 								decoder->waiting_for_first_audio = false;
+								decoder->sync.anchored = false;
 								
-								/* Only set start time if video hasn't set it yet */
-								if (decoder->waiting_for_first_frame) {
-									decoder->start_time_ns = os_gettime_ns();
-								}
+								/* Only reset the clock if video hasn't already */
+								if (decoder->waiting_for_first_frame)
+									clock_reset(decoder, pts_us);
 								
-								blog(LOG_INFO, "First audio frame, PTS: %lld ns, start_time set: %s", 
-									pts_ns, decoder->waiting_for_first_frame ? "yes" : "no");
+								blog(LOG_INFO, "First audio frame, PTS: %lld us, clock anchored: %s", 
+									(long long)pts_us, decoder->waiting_for_first_frame ? "yes" : "no");
 							}
 							
-							/* Use audio-specific PTS offset for audio timestamp */
-							/* Apply same timeline sync as video for perfect A/V sync */
-							audio.timestamp = decoder->start_time_ns + (pts_ns - decoder->audio_pts_offset);
-							
-							/* Log audio sync periodically for debugging */
-							static int audio_frame_count = 0;
-							if (++audio_frame_count % 1000 == 0) {
-								int64_t video_pts = decoder->frame_pts;
-								int64_t audio_pts = pts_ns / 1000;  /* Convert to microseconds */
-								int64_t av_diff = (video_pts - audio_pts) / 1000;  /* Diff in ms */
-								if (abs((int)av_diff) > 50) {
-									blog(LOG_INFO, "A/V sync: video=%lld ms, audio=%lld ms, diff=%lld ms",
-										(long long)(video_pts / 1000), (long long)(audio_pts / 1000), (long long)av_diff);
-								}
-							}
-						} else {
-							audio.timestamp = os_gettime_ns();
+							master_ns = clock_get_system_time_for_pts(decoder, pts_us);
 						}
 						
 						/* Handle audio resampling if needed */
 						bool audio_ready = false;
 						if (decoder->swr_ctx) {
-							/* Check if input samples exceed our buffer capacity */
+							/* Buffer is pre-sized at open; only oversized PCM packets grow it */
 							int expected_out_samples = swr_get_out_samples(decoder->swr_ctx, 
 								decoder->audio_frame->nb_samples);
 							
 							if (expected_out_samples > decoder->max_resampled_samples) {
-								/* Dynamically resize buffer if needed */
-								int new_size = expected_out_samples * 2;  /* Double for safety */
-								blog(LOG_WARNING, "Audio buffer too small (%d samples needed, %d available), resizing to %d",
-									expected_out_samples, decoder->max_resampled_samples, new_size);
-								
-								/* Free old buffer */
-								av_freep(&decoder->resampled_audio_data[0]);
-								
-								/* Allocate new larger buffer */
-								int ret = av_samples_alloc(decoder->resampled_audio_data, 
-									&decoder->resampled_audio_linesize,
-									2, new_size, AV_SAMPLE_FMT_FLTP, 0);
-								
-								if (ret < 0) {
-									blog(LOG_ERROR, "Failed to resize audio buffer: %s", av_err2str(ret));
+								blog(LOG_DEBUG, "Growing audio buffer to %d samples", expected_out_samples);
+								if (!ensure_resample_capacity(decoder, expected_out_samples)) {
 									/* Skip this frame as fallback */
 									continue;
 								}
-								
-								decoder->max_resampled_samples = new_size;
-								blog(LOG_INFO, "Audio buffer resized successfully to %d samples", new_size);
 							}
 							
 							/* Now safe to resample */
 							if (expected_out_samples <= decoder->max_resampled_samples) {
-								/* Safe to resample audio to FLTP stereo */
+								/* Resample to OBS's rate and layout */
 								int out_samples = swr_convert(decoder->swr_ctx,
 									decoder->resampled_audio_data,
 									decoder->max_resampled_samples,
@@ -2162,7 +4016,7 @@ static void *decoder_thread(void *opaque)
 									
 									/* Use resampled audio */
 									audio.frames = out_samples;
-									for (int i = 0; i < 2; i++) {  /* Stereo output */
+									for (int i = 0; i < decoder->audio_out_channels; i++) {
 										audio.data[i] = decoder->resampled_audio_data[i];
 									}
 									audio_ready = true;
@@ -2171,9 +4025,9 @@ static void *decoder_thread(void *opaque)
 								}
 							}
 						} else {
-							/* Audio is already in correct format (FLTP stereo) */
+							/* Audio is already in OBS's format */
 							int valid_channels = 0;
-							for (int i = 0; i < 2 && i < AV_NUM_DATA_POINTERS; i++) {
+							for (int i = 0; i < decoder->audio_out_channels && i < AV_NUM_DATA_POINTERS; i++) {
 								if (decoder->audio_frame->data[i]) {
 									audio.data[i] = decoder->audio_frame->data[i];
 									valid_channels++;
@@ -2181,11 +4035,14 @@ static void *decoder_thread(void *opaque)
 									break;
 								}
 							}
-							audio_ready = (valid_channels == 2);
+							audio_ready = (valid_channels == decoder->audio_out_channels);
 						}
 						
 						/* Only output if we have valid audio data and callbacks */
 						if (audio_ready) {
+							audio.timestamp = has_pts ?
+								sync_audio_frame(decoder, master_ns, audio.frames) : os_gettime_ns();
+							
 							/* Get callback under lock and check stopping flag */
 							pthread_mutex_lock(&decoder->mutex);
 							if (!atomic_load(&decoder->stopping) && decoder->audio_cb && decoder->opaque) {
@@ -2209,6 +4066,7 @@ static void *decoder_thread(void *opaque)
 	}
 	
 	av_packet_free(&packet);
+	end_catchup(decoder);
 	
 	/* Mark thread as not running */
 	pthread_mutex_lock(&decoder->mutex);
@@ -2257,6 +4115,13 @@ void ffmpeg_decoder_play_with_timeline(struct ffmpeg_decoder *decoder, uint64_t
 		blog(LOG_INFO, "Display thread already running");
 	}
 	
+	/* Start demux thread if not running */
+	if (!decoder->demux_thread_created) {
+		packet_queue_start(decoder->packets);
+		decoder->demux_thread_created =
+			pthread_create(&decoder->demux_thread, NULL, demux_thread, decoder) == 0;
+	}
+	
 	/* Start decoder thread if not running */
 	if (!decoder->thread_running) {
 		blog(LOG_INFO, "Starting decoder thread");
@@ -2299,11 +4164,8 @@ void ffmpeg_decoder_stop(struct ffmpeg_decoder *decoder)
 	blog(LOG_INFO, "Playback stopped");
 }
 
-void ffmpeg_decoder_stop_thread(struct ffmpeg_decoder *decoder)
+static void stop_threads(struct ffmpeg_decoder *decoder)
 {
-	if (!decoder)
-		return;
-	
 	blog(LOG_INFO, "Stopping decoder threads (aggressive cleanup)...");
 	
 	/* CRITICAL: Set interrupt flag FIRST to interrupt FFmpeg blocking calls */
@@ -2316,6 +4178,9 @@ void ffmpeg_decoder_stop_thread(struct ffmpeg_decoder *decoder)
 	/* Don't clear callbacks here - they should persist across stop/play cycles */
 	pthread_mutex_unlock(&decoder->mutex);
 	
+	/* Release the decoder and demux threads from queue waits */
+	packet_queue_abort(decoder->packets);
+	
 	/* Wake up display thread */
 	pthread_mutex_lock(&decoder->buffer.lock);
 	pthread_cond_broadcast(&decoder->buffer.cond);
@@ -2403,10 +4268,221 @@ thread_stopped:
 		blog(LOG_INFO, "Decoder thread stopped");
 	}
 	
+	/* Interrupted above if it was reading, aborted queue if it was waiting for room */
+	if (decoder->demux_thread_created) {
+		pthread_join(decoder->demux_thread, NULL);
+		decoder->demux_thread_created = false;
+	}
+	
+	/* Packets of this run are stale for the next one */
+	packet_queue_clear(decoder->packets);
+	packet_queue_start(decoder->packets);
+	
 	/* Reset stopping flag for next play */
 	atomic_store(&decoder->stopping, false);
 }
 
+/* Asynchronous open
+ * Opening and probing a file, and creating a hardware decoder, take from tens
+ * to hundreds of milliseconds - too long for the caller (the OBS video tick).
+ * One opener thread per decoder works through the newest request only */
+
+static inline bool open_superseded(struct ffmpeg_decoder *decoder, uint64_t id)
+{
+	return decoder->opener.latest_id != id;
+}
+
+/* Remove the waiting request, if any. Called with the opener lock held */
+static struct decoder_open_request take_pending(struct ffmpeg_decoder *decoder)
+{
+	struct decoder_open_request req = decoder->opener.pending;
+	memset(&decoder->opener.pending, 0, sizeof(req));
+	return req;
+}
+
+static void complete_request(struct decoder_open_request *req, enum decoder_open_result result)
+{
+	if (req->path && req->cb)
+		req->cb(req->opaque, req->id, result);
+	bfree(req->path);
+	req->path = NULL;
+}
+
+static enum decoder_open_result run_open(struct ffmpeg_decoder *decoder,
+	const struct decoder_open_request *req)
+{
+	if (open_superseded(decoder, req->id))
+		return DECODER_OPEN_CANCELLED;
+	
+	uint64_t start = os_gettime_ns();
+	bool ok = ffmpeg_decoder_initialize(decoder, req->path);
+	
+	/* A superseded open was interrupted, or is for a file nobody wants now */
+	if (open_superseded(decoder, req->id))
+		return DECODER_OPEN_CANCELLED;
+	if (!ok)
+		return DECODER_OPEN_FAILED;
+	
+	uint64_t now = os_gettime_ns();
+	int64_t seek_us = req->seek_us;
+	
+	/* The timeline kept moving while the request waited and the file opened */
+	if (req->timeline_start_ms && seek_us >= 0)
+		seek_us += (int64_t)((now - req->posted_ns) / 1000);
+	
+	/* Under the lock, so a cancel either lands before playback starts or
+	 * returns after it and can stop it */
+	pthread_mutex_lock(&decoder->opener.lock);
+	if (open_superseded(decoder, req->id)) {
+		pthread_mutex_unlock(&decoder->opener.lock);
+		return DECODER_OPEN_CANCELLED;
+	}
+	if (seek_us > 0)
+		ffmpeg_decoder_seek(decoder, seek_us);
+	ffmpeg_decoder_play_with_timeline(decoder, req->timeline_start_ms);
+	pthread_mutex_unlock(&decoder->opener.lock);
+	
+	blog(LOG_INFO, "Opened %s in %llu ms, playing from %lld ms", req->path,
+		(unsigned long long)((now - start) / 1000000), (long long)(seek_us / 1000));
+	return DECODER_OPEN_OK;
+}
+
+static void *opener_thread(void *opaque)
+{
+	struct ffmpeg_decoder *decoder = opaque;
+	
+	set_thread_name("fmgnice-opener");
+	
+	pthread_mutex_lock(&decoder->opener.lock);
+	while (!decoder->opener.stopping) {
+		if (!decoder->opener.pending.path) {
+			pthread_cond_wait(&decoder->opener.cond, &decoder->opener.lock);
+			continue;
+		}
+		
+		struct decoder_open_request req = take_pending(decoder);
+		decoder->opener.active_id = req.id;
+		pthread_mutex_unlock(&decoder->opener.lock);
+		
+		enum decoder_open_result result = run_open(decoder, &req);
+		if (result == DECODER_OPEN_CANCELLED)
+			blog(LOG_INFO, "Open of %s superseded", req.path);
+		complete_request(&req, result);
+		
+		pthread_mutex_lock(&decoder->opener.lock);
+		decoder->opener.active_id = 0;
+		pthread_cond_broadcast(&decoder->opener.cond);
+	}
+	pthread_mutex_unlock(&decoder->opener.lock);
+	
+	return NULL;
+}
+
+/* Wait until no open is in flight. Not from the opener thread */
+static void wait_for_open(struct ffmpeg_decoder *decoder)
+{
+	pthread_mutex_lock(&decoder->opener.lock);
+	while (decoder->opener.active_id)
+		pthread_cond_wait(&decoder->opener.cond, &decoder->opener.lock);
+	pthread_mutex_unlock(&decoder->opener.lock);
+}
+
+static void stop_opener(struct ffmpeg_decoder *decoder)
+{
+	pthread_mutex_lock(&decoder->opener.lock);
+	decoder->opener.stopping = true;
+	decoder->opener.latest_id++;
+	struct decoder_open_request req = take_pending(decoder);
+	pthread_cond_broadcast(&decoder->opener.cond);
+	pthread_mutex_unlock(&decoder->opener.lock);
+	
+	complete_request(&req, DECODER_OPEN_CANCELLED);
+	
+	if (decoder->opener.thread_active) {
+		pthread_join(decoder->opener.thread, NULL);
+		decoder->opener.thread_active = false;
+	}
+}
+
+uint64_t ffmpeg_decoder_open_async(struct ffmpeg_decoder *decoder, const char *path,
+	int64_t seek_us, uint64_t timeline_start_ms, ffmpeg_decoder_open_cb cb, void *opaque)
+{
+	if (!decoder || !path)
+		return 0;
+	
+	pthread_mutex_lock(&decoder->opener.lock);
+	
+	if (decoder->opener.stopping) {
+		pthread_mutex_unlock(&decoder->opener.lock);
+		return 0;
+	}
+	
+	struct decoder_open_request superseded = take_pending(decoder);
+	
+	struct decoder_open_request *req = &decoder->opener.pending;
+	req->path = bstrdup(path);
+	req->id = ++decoder->opener.latest_id;
+	req->seek_us = seek_us;
+	req->timeline_start_ms = timeline_start_ms;
+	req->posted_ns = os_gettime_ns();
+	req->cb = cb;
+	req->opaque = opaque;
+	uint64_t id = req->id;
+	
+	/* Started on first use, decoders that only open synchronously don't carry an idle thread */
+	if (!decoder->opener.thread_active)
+		decoder->opener.thread_active =
+			pthread_create(&decoder->opener.thread, NULL, opener_thread, decoder) == 0;
+	pthread_cond_signal(&decoder->opener.cond);
+	
+	pthread_mutex_unlock(&decoder->opener.lock);
+	
+	complete_request(&superseded, DECODER_OPEN_CANCELLED);
+	
+	blog(LOG_INFO, "Open requested (#%llu): %s", (unsigned long long)id, path);
+	return id;
+}
+
+void ffmpeg_decoder_cancel_open(struct ffmpeg_decoder *decoder)
+{
+	if (!decoder)
+		return;
+	
+	pthread_mutex_lock(&decoder->opener.lock);
+	struct decoder_open_request req = take_pending(decoder);
+	if (req.path || decoder->opener.active_id)
+		decoder->opener.latest_id++;
+	pthread_mutex_unlock(&decoder->opener.lock);
+	
+	complete_request(&req, DECODER_OPEN_CANCELLED);
+	
+	/* The interrupt callback cuts a superseded open's I/O short */
+	wait_for_open(decoder);
+}
+
+bool ffmpeg_decoder_is_opening(struct ffmpeg_decoder *decoder)
+{
+	if (!decoder)
+		return false;
+	
+	pthread_mutex_lock(&decoder->opener.lock);
+	bool opening = decoder->opener.pending.path || decoder->opener.active_id;
+	pthread_mutex_unlock(&decoder->opener.lock);
+	
+	return opening;
+}
+
+void ffmpeg_decoder_stop_thread(struct ffmpeg_decoder *decoder)
+{
+	if (!decoder)
+		return;
+	
+	/* An open still in flight would start the threads again */
+	ffmpeg_decoder_cancel_open(decoder);
+	
+	stop_threads(decoder);
+}
+
 void ffmpeg_decoder_free_scalers(struct ffmpeg_decoder *decoder)
 {
 	if (!decoder)
@@ -2421,22 +4497,89 @@ void ffmpeg_decoder_free_scalers(struct ffmpeg_decoder *decoder)
 		sws_freeContext(decoder->p010_sws_ctx);
 		decoder->p010_sws_ctx = NULL;
 	}
+	if (decoder->hdr_sws_ctx) {
+		sws_freeContext(decoder->hdr_sws_ctx);
+		decoder->hdr_sws_ctx = NULL;
+	}
 	
 	blog(LOG_INFO, "[FFmpeg Decoder] Freed scalers for inactive scene");
 }
 
-void ffmpeg_decoder_seek(struct ffmpeg_decoder *decoder, int64_t position_us)
+static void request_seek(struct ffmpeg_decoder *decoder, int64_t position_us, bool accurate)
 {
 	if (!decoder || !decoder->initialized)
 		return;
 	
-	/* Simplified seek - just set flag for decoder thread to handle */
+	/* Simplified seek - just set flag for decoder thread to handle. Only the
+	 * newest target matters, one not handled yet is simply replaced */
 	pthread_mutex_lock(&decoder->mutex);
+	decoder->seek_stats.requested++;
+	if (atomic_load(&decoder->seek_request))
+		decoder->seek_stats.coalesced++;
 	atomic_store(&decoder->seek_request, true);
 	decoder->seek_target = position_us;
+	decoder->seek_target_accurate = accurate;
+	pthread_mutex_unlock(&decoder->mutex);
+	
+	/* Release a decoder thread waiting on a full buffer, its frames are stale */
+	pthread_mutex_lock(&decoder->buffer.lock);
+	pthread_cond_broadcast(&decoder->buffer.cond);
+	pthread_mutex_unlock(&decoder->buffer.lock);
+	
+	blog(LOG_INFO, "Seek requested to %lld us (%s)", (long long)position_us,
+		accurate ? "accurate" : "keyframe");
+}
+
+void ffmpeg_decoder_seek(struct ffmpeg_decoder *decoder, int64_t position_us)
+{
+	if (decoder)
+		request_seek(decoder, position_us, decoder->accurate_seek);
+}
+
+void ffmpeg_decoder_seek_accurate(struct ffmpeg_decoder *decoder, int64_t position_us)
+{
+	request_seek(decoder, position_us, true);
+}
+
+void ffmpeg_decoder_set_accurate_seek(struct ffmpeg_decoder *decoder, bool accurate)
+{
+	if (!decoder)
+		return;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	decoder->accurate_seek = accurate;
+	pthread_mutex_unlock(&decoder->mutex);
+}
+
+void ffmpeg_decoder_set_deinterlace(struct ffmpeg_decoder *decoder, int mode)
+{
+	if (!decoder)
+		return;
+	
+	/* Read by the decoder thread for every frame */
+	atomic_store(&decoder->deinterlace.mode, mode);
+}
+
+bool ffmpeg_decoder_get_clock_position(struct ffmpeg_decoder *decoder, int64_t *position_us)
+{
+	if (!decoder || !decoder->initialized || decoder->waiting_for_first_frame)
+		return false;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	int64_t pending = decoder->pending_clock_slew_ns;
 	pthread_mutex_unlock(&decoder->mutex);
 	
-	blog(LOG_INFO, "Seek requested to %lld us", (long long)position_us);
+	pthread_mutex_lock(&decoder->clock.lock);
+	bool anchored = decoder->clock.system_start != 0;
+	if (anchored) {
+		double elapsed_ns = (double)((int64_t)os_gettime_ns() -
+			(int64_t)decoder->clock.system_start - pending);
+		*position_us = decoder->clock.media_start_pts - decoder->start_pts_us +
+			(int64_t)(elapsed_ns / 1000.0 * decoder->clock.playback_rate);
+	}
+	pthread_mutex_unlock(&decoder->clock.lock);
+	
+	return anchored;
 }
 
 int64_t ffmpeg_decoder_get_position(struct ffmpeg_decoder *decoder)
@@ -2509,6 +4652,101 @@ void ffmpeg_decoder_set_output_format(struct ffmpeg_decoder *decoder, bool use_n
 		use_nv12 ? "NV12 (no conversion)" : "BGRA (with conversion)");
 }
 
+void ffmpeg_decoder_set_performance_mode(struct ffmpeg_decoder *decoder, int mode)
+{
+	if (!decoder || !decoder->policy)
+		return;
+	
+	/* Decoder thread picks up the new knobs on its next packet */
+	decode_policy_set_mode(decoder->policy, (enum decode_policy_mode)mode);
+}
+
+void ffmpeg_decoder_set_priority(struct ffmpeg_decoder *decoder, int priority)
+{
+	if (!decoder)
+		return;
+	
+	load_governor_set_priority(decoder->governor_entry, (enum load_priority)priority);
+}
+
+void ffmpeg_decoder_set_rate(struct ffmpeg_decoder *decoder, double rate)
+{
+	if (!decoder)
+		return;
+	
+	if (rate < RATE_MIN) rate = RATE_MIN;
+	if (rate > RATE_MAX) rate = RATE_MAX;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	if (decoder->requested_rate != rate) {
+		decoder->requested_rate = rate;
+		/* Decoder thread applies it before the next packet */
+		atomic_store(&decoder->rate_changed, true);
+	}
+	pthread_mutex_unlock(&decoder->mutex);
+}
+
+void ffmpeg_decoder_adjust_clock(struct ffmpeg_decoder *decoder, int64_t delta_ns)
+{
+	if (!decoder || !delta_ns)
+		return;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	decoder->pending_clock_slew_ns += delta_ns;
+	atomic_store(&decoder->clock_slew_active, decoder->pending_clock_slew_ns != 0);
+	pthread_mutex_unlock(&decoder->mutex);
+}
+
+void ffmpeg_decoder_set_read_ahead(struct ffmpeg_decoder *decoder, int mode, int window_mb)
+{
+	if (!decoder)
+		return;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	decoder->read_ahead_mode = mode;
+	decoder->read_ahead_mb = window_mb;
+	pthread_mutex_unlock(&decoder->mutex);
+}
+
+void ffmpeg_decoder_set_sync_master(struct ffmpeg_decoder *decoder, int master)
+{
+	if (!decoder)
+		return;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	if (decoder->requested_sync_master != master) {
+		decoder->requested_sync_master = master;
+		/* Decoder thread applies it before the next audio packet */
+		atomic_store(&decoder->sync_master_changed, true);
+	}
+	pthread_mutex_unlock(&decoder->mutex);
+}
+
+int64_t ffmpeg_decoder_get_av_drift(struct ffmpeg_decoder *decoder)
+{
+	if (!decoder || decoder->audio_stream_idx < 0)
+		return 0;
+	return decoder->sync.drift_ns;
+}
+
+void ffmpeg_decoder_set_target_size(struct ffmpeg_decoder *decoder, int width, int height)
+{
+	if (!decoder)
+		return;
+	
+	if (width <= 0 || height <= 0)
+		width = height = 0;
+	
+	pthread_mutex_lock(&decoder->mutex);
+	if (decoder->requested_target_width != width || decoder->requested_target_height != height) {
+		decoder->requested_target_width = width;
+		decoder->requested_target_height = height;
+		/* Decoder thread applies it before the next packet */
+		atomic_store(&decoder->target_size_changed, true);
+	}
+	pthread_mutex_unlock(&decoder->mutex);
+}
+
 /* Pause decoder but keep threads alive for quick resume */
 void ffmpeg_decoder_pause_ready(struct ffmpeg_decoder *decoder)
 {
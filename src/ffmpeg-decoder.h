@@ -48,16 +48,71 @@ struct gpu_zero_copy_ctx;
 /* Forward declaration for lock-free ring buffer */
 struct lockfree_ringbuffer;
 
+/* Forward declaration for the demuxer to decoder packet queue */
+struct packet_queue;
+
+/* Forward declaration for parallel GOP catch-up decoding */
+struct gop_decoder;
+
+/* Forward declaration for the alpha loop cache */
+struct frame_cache;
+
+/* Forward declaration for load-shedding policy and governor */
+struct decode_policy;
+struct load_governor_entry;
+
+/* Decoded frames held between the decoder and display threads */
+#define FRAME_BUFFER_SLOTS 3
+
+/* Which stream the other follows when audio drifts from the media clock */
+enum av_sync_master {
+	AV_SYNC_SYSTEM = 0,  /* Audio is resampled to follow the system clock */
+	AV_SYNC_AUDIO = 1,   /* Video is slewed to follow the audio sample clock */
+};
+
+/* When files are read through the read-ahead engine instead of a mapping */
+enum read_ahead_mode {
+	READ_AHEAD_OFF = 0,
+	READ_AHEAD_REMOTE = 1,   /* Files on network filesystems */
+	READ_AHEAD_ALWAYS = 2,
+};
+
+/* Outcome of an asynchronous open */
+enum decoder_open_result {
+	DECODER_OPEN_OK = 0,
+	DECODER_OPEN_FAILED = 1,
+	DECODER_OPEN_CANCELLED = 2,   /* Superseded by a newer request or cancelled */
+};
+
+typedef void (*ffmpeg_decoder_open_cb)(void *opaque, uint64_t request_id,
+	enum decoder_open_result result);
+
+struct decoder_open_request {
+	char *path;                   /* NULL = no request */
+	uint64_t id;
+	int64_t seek_us;
+	uint64_t timeline_start_ms;
+	uint64_t posted_ns;           /* When the request was made */
+	ffmpeg_decoder_open_cb cb;
+	void *opaque;
+};
+
 struct ffmpeg_decoder {
 	/* Source reference */
 	obs_source_t *source;
 	
 	/* FFmpeg contexts */
 	AVFormatContext *format_ctx;
+	AVIOContext *custom_io;  /* Mapped or read-ahead file, NULL when FFmpeg does the IO */
+	void (*custom_io_close)(AVIOContext **pb);
+	bool read_ahead_active;
+	int read_ahead_mode;     /* enum read_ahead_mode, protected by mutex */
+	int read_ahead_mb;
 	AVCodecContext *video_codec_ctx;
 	AVCodecContext *audio_codec_ctx;
 	struct SwsContext *sws_ctx;
 	struct SwsContext *p010_sws_ctx;  /* P010 to NV12 converter */
+	struct SwsContext *hdr_sws_ctx;   /* HDR frames resized at 10 bits */
 	struct SwrContext *swr_ctx;  /* Audio resampler */
 	
 	/* Hardware decoding */
@@ -95,18 +150,124 @@ struct ffmpeg_decoder {
 	/* Output format selection */
 	bool use_nv12_output; /* true = NV12, false = BGRA */
 	
+	/* Target output size for small on-canvas sources (0 = native) */
+	int requested_target_width;    /* Set by source, protected by mutex */
+	int requested_target_height;
+	atomic_bool target_size_changed;
+	int target_width;              /* Applied by decoder thread */
+	int target_height;
+	int lowres;                    /* Codec lowres factor currently open */
+	int64_t discard_until_pts;     /* Drop frames up to this PTS (us) after a lowres reopen */
+	
+	/* Playback rate */
+	double requested_rate;         /* Set by ffmpeg_decoder_set_rate, protected by mutex */
+	atomic_bool rate_changed;
+	enum AVDiscard rate_skip_frame;        /* Codec frame skipping for the current rate */
+	uint64_t rate_frame_interval_ns;       /* Minimum display spacing of selected frames */
+	uint64_t last_selected_display_time;   /* Display time (ns) of the last frame kept */
+	bool audio_muted;              /* Audio is not output at rates other than 1.0 */
+	
+	/* Gradual clock adjustment for small timeline epoch changes */
+	int64_t pending_clock_slew_ns; /* Remaining adjustment, protected by mutex */
+	atomic_bool clock_slew_active;
+	uint64_t last_clock_slew;      /* Decoder thread only */
+	
+	/* A/V sync */
+	int requested_sync_master;     /* Set by ffmpeg_decoder_set_sync_master, protected by mutex */
+	atomic_bool sync_master_changed;
+	struct {
+		enum av_sync_master master;
+		bool anchored;             /* Sample clock anchored since the last seek/loop/unmute */
+		uint64_t anchor_ns;        /* Timestamp of the first sample after anchoring */
+		uint64_t samples;          /* Output samples sent since anchoring */
+		volatile int64_t drift_ns; /* Smoothed audio sample clock minus master clock */
+		uint64_t last_correction_ns;
+		bool compensating;         /* Resampler is running with a compensation */
+		uint32_t resyncs;          /* Re-anchors because drift exceeded the threshold */
+	} sync;
+	
 	/* Audio resampling buffers */
 	uint8_t *resampled_audio_data[8];  /* Resampled audio data pointers */
 	int resampled_audio_linesize;      /* Linesize for resampled audio */
 	int max_resampled_samples;         /* Max samples allocated for resampling */
 	
+	/* Audio output format - OBS's own rate and layout, so OBS doesn't resample again */
+	uint32_t audio_out_sample_rate;
+	enum speaker_layout audio_out_speakers;
+	int audio_out_channels;
+	
 	/* Seeking */
 	atomic_bool seek_request;   /* Frequently checked - make atomic */
 	int64_t seek_target;
+	bool seek_target_accurate;  /* Decode up to the target instead of showing the keyframe */
+	bool accurate_seek;         /* Default for ffmpeg_decoder_seek */
+	int64_t start_pts_us;       /* Video stream start time, seek/position origin */
 	bool seek_flush;
 	bool waiting_for_first_frame;  /* Track first frame after seek */
 	uint64_t seek_start_time;      /* When seek was initiated */
-	uint32_t seek_generation;      /* Incremented on each seek to discard old frames */
+	uint32_t seek_generation;      /* Incremented on each demuxer seek, stale packets are dropped */
+	struct {
+		uint64_t requested;
+		uint64_t coalesced;        /* Replaced by a newer target before being handled */
+		uint64_t aborted;          /* Accurate-seek decodes cut short by a newer target */
+		uint64_t skipped;          /* Target already in the queued frames */
+		uint64_t forwarded;        /* Reached by decoding forward instead of seeking */
+	} seek_stats;
+	
+	/* Seek planning - whether a target just ahead is reached sooner by
+	 * decoding forward than by seeking back to its keyframe */
+	DARRAY(int64_t) keyframes;     /* Sorted keyframe times (us), protected by mutex */
+	bool keyframes_complete;       /* Container index listed the whole file */
+	bool intra_only;               /* Every frame is a keyframe */
+	int64_t demux_position_us;     /* Furthest video packet read since the last seek, protected by mutex */
+	uint64_t seek_overhead_ns;     /* Measured seek cost beyond the frames it decodes */
+	
+	/* Catch-up after an accurate seek - GOP workers decode the stretch past
+	 * the target in parallel while its video packets are dropped */
+	struct {
+		struct gop_decoder *gops;
+		bool active;               /* Video packets before end_us are dropped */
+		int64_t end_us;            /* Keyframe closing the stretch */
+		int64_t target_us;         /* Sought again if catch-up fails */
+		bool disabled;             /* Open GOPs or a failed worker, not tried again for this file */
+	} catchup;
+	
+	/* Short alpha sources (lower thirds) - frames converted to BGRA are kept
+	 * by stream pts so later passes of the loop skip decoding and conversion */
+	struct {
+		struct frame_cache *cache;
+		bool fits;                 /* The current file's frames fit the cache */
+		uint32_t frames;           /* Estimated frame count, the cache's capacity */
+		bool from_cache;           /* The packet being handled was served from the cache */
+		bool decoder_behind;       /* Packets were served since the codec last decoded */
+		bool resyncing;            /* Sought back so an inter codec has its references again */
+		AVFrame *hit;              /* Cached frame for the packet being handled */
+	} alpha_cache;
+	
+	/* Interlaced sources - frames flagged interlaced are deinterlaced on the
+	 * CPU, field-rate modes output each field as a frame of its own */
+	struct {
+		atomic_int mode;           /* enum deinterlace_mode, set by ffmpeg_decoder_set_deinterlace */
+		AVFrame *pending;          /* Second field of the last frame, returned next */
+		int64_t pending_offset_us; /* Half the frame's duration */
+		int64_t field_offset_us;   /* Added to the pts of the frame being handled */
+		bool active;               /* Logged for the current file */
+	} deinterlace;
+	
+	/* HDR passthrough logged for the current file */
+	bool hdr_logged;
+	
+	/* Demuxing runs on its own thread, feeding the decoder thread through a
+	 * queue bounded by bytes and duration per stream */
+	pthread_t demux_thread;
+	bool demux_thread_created;
+	struct packet_queue *packets;
+	struct {
+		bool pending;              /* Protected by mutex */
+		int64_t pts;               /* Keyframe at or before this, video stream time base */
+		uint32_t generation;       /* seek_generation the packets after it belong to */
+	} demux_seek;
+	uint32_t demux_generation;     /* Generation of the packets being read, demux thread only */
 	
 	/* Threading */
 	pthread_t thread;
@@ -118,12 +279,24 @@ struct ffmpeg_decoder {
 	bool reading_frame;  /* Flag to indicate when av_read_frame is active */
 	volatile bool interrupt_request;  /* Flag for FFmpeg interrupt callback */
 	
+	/* Asynchronous open (ffmpeg_decoder_open_async) */
+	struct {
+		pthread_t thread;
+		bool thread_active;
+		bool stopping;
+		pthread_mutex_t lock;
+		pthread_cond_t cond;               /* New request, or the active one finished */
+		struct decoder_open_request pending;
+		volatile uint64_t latest_id;       /* Newest request or cancel, older requests are superseded */
+		volatile uint64_t active_id;       /* Request being opened, 0 = idle */
+	} opener;
+	
 	/* Clock System (VLC-style) */
 	struct {
-		uint64_t system_start;   /* System time when playback started */
+		uint64_t system_start;   /* System time (ns) when playback started */
 		int64_t media_start_pts; /* Media PTS at start of playback */
 		int64_t last_pts;        /* Last presented PTS */
-		uint64_t last_system;    /* System time of last frame */
+		uint64_t last_system;    /* System time (ns) of last frame */
 		double playback_rate;    /* Playback speed multiplier */
 		pthread_mutex_t lock;    /* Clock-specific lock */
 	} clock;
@@ -136,20 +309,31 @@ struct ffmpeg_decoder {
 		struct buffered_frame {
 			AVFrame *frame;      /* Reference to the decoded frame (for zero-copy) */
 			int64_t pts;         /* Presentation timestamp */
-			uint64_t system_time; /* When to display (system time) */
+			uint64_t system_time; /* When to display (system time, ns) */
+			int generation;      /* buffer.generation it was decoded in */
 			bool ready;
 			bool is_hw_frame;    /* True if this is a hardware decoded frame */
 			bool zero_copy;      /* True if using zero-copy with frame reference */
+			/* OBS format the referenced frame is shown in as is, VIDEO_FORMAT_NONE when converted */
+			enum video_format native_format;
+			enum video_colorspace colorspace; /* From the frame's color metadata */
+			bool full_range;
+			enum video_trc trc;  /* PQ/HLG for HDR frames, shown as they are */
+			uint16_t max_luminance; /* Mastering peak in nits, 0 if unknown */
 			/* BGRA converted data for this frame (software decode only) */
 			uint8_t *bgra_data[4];
 			uint32_t bgra_linesize[4];
+			int width;           /* Dimensions of bgra_data */
+			int height;
 			/* NV12 data for hardware frames (used when not zero-copy) */
 			uint8_t *nv12_data[2];
 			uint32_t nv12_linesize[2];
-		} frames[3];             /* Small ring buffer */
+		} frames[FRAME_BUFFER_SLOTS]; /* Small ring buffer */
 		int write_idx;           /* Where to write next decoded frame */
 		int read_idx;            /* Next frame to display */
 		int count;               /* Number of buffered frames */
+		int depth;               /* Frames allowed ahead of display (<= FRAME_BUFFER_SLOTS) */
+		atomic_int generation;   /* Bumped at seeks, loops and file switches, older frames are skipped */
 		pthread_mutex_t lock;    /* Buffer lock */
 		pthread_cond_t cond;     /* Signal new frame available */
 	} buffer;
@@ -161,9 +345,7 @@ struct ffmpeg_decoder {
 	uint64_t frame_pts;
 	uint64_t next_pts;
 	uint64_t sys_ts;
-	uint64_t start_time_ns;  /* System time when playback started minus initial PTS */
 	int64_t pts_offset;      /* Video PTS offset to subtract from frame PTS after seeks */
-	int64_t audio_pts_offset;/* Audio PTS offset to subtract from audio PTS after seeks */
 	bool waiting_for_first_audio; /* Track first audio frame after seek */
 	
 	/* Callbacks */
@@ -185,6 +367,23 @@ struct ffmpeg_decoder {
 	/* Performance monitoring */
 	void* perf_monitor; /* struct perf_monitor_t* */
 	
+	/* Load-shedding policy (Performance Mode) */
+	struct decode_policy *policy;
+	uint32_t policy_generation;  /* Generation of knobs last applied by decoder thread */
+	int sws_flags;               /* Scaler algorithm from policy */
+	int sws_threads;             /* Scaler slice threads from policy */
+	int sws_src_width;           /* Source parameters of sws_ctx, for rebuilds */
+	int sws_src_height;
+	enum AVPixelFormat sws_src_format;
+	AVFrame *scale_frame;        /* Wrapper for threaded sws_scale_frame() output */
+	int frame_decimation;        /* Keep 1 of every N frames (governor budget) */
+	uint32_t decimation_counter;
+	int scale_divisor;           /* Output resolution divisor (governor budget) */
+	bool cache_admission;        /* New frames may enter the alpha cache (policy level) */
+	
+	/* Machine-wide load governor registration */
+	struct load_governor_entry *governor_entry;
+	
 	/* Zero-copy GPU pipeline */
 	void* gpu_zero_copy_ctx; /* struct gpu_zero_copy_ctx* */
 	
@@ -204,9 +403,29 @@ struct ffmpeg_decoder {
 struct ffmpeg_decoder *ffmpeg_decoder_create(obs_source_t *source);
 void ffmpeg_decoder_destroy(struct ffmpeg_decoder *decoder);
 
-/* Initialize decoder with file */
+/* Initialize decoder with file. Blocks for the whole open and probe, and
+ * must not be mixed with an asynchronous open that is still in flight */
 bool ffmpeg_decoder_initialize(struct ffmpeg_decoder *decoder, const char *path);
 
+/* Open path on a background thread, then seek to seek_us and play against
+ * timeline_start_ms (when set, seek_us is advanced by the time the open
+ * took). Playback of the current file stops when the open begins, so its
+ * last frame stays on screen until the new file's first one. A newer request
+ * or ffmpeg_decoder_cancel_open supersedes one still waiting or opening.
+ * cb gets the request's outcome on the opener thread - or, for a request
+ * that never started, on the thread superseding it - and must not call back
+ * into the decoder. Until then the file state (current path, duration,
+ * seeking) belongs to the opener. Returns the request id */
+uint64_t ffmpeg_decoder_open_async(struct ffmpeg_decoder *decoder, const char *path,
+	int64_t seek_us, uint64_t timeline_start_ms, ffmpeg_decoder_open_cb cb, void *opaque);
+
+/* Cancel the waiting or in-flight open, if any, and wait for the opener to
+ * let go of the decoder. Not from an open callback */
+void ffmpeg_decoder_cancel_open(struct ffmpeg_decoder *decoder);
+
+/* True from ffmpeg_decoder_open_async until the request completes */
+bool ffmpeg_decoder_is_opening(struct ffmpeg_decoder *decoder);
+
 /* Playback control */
 void ffmpeg_decoder_play(struct ffmpeg_decoder *decoder);
 void ffmpeg_decoder_play_with_timeline(struct ffmpeg_decoder *decoder, uint64_t timeline_start_ms);
@@ -224,9 +443,25 @@ bool ffmpeg_decoder_is_paused_ready(struct ffmpeg_decoder *decoder);
 /* Seeking - position in microseconds */
 void ffmpeg_decoder_seek(struct ffmpeg_decoder *decoder, int64_t position_us);
 
+/* Seek that lands exactly on the target, whatever the seek mode */
+void ffmpeg_decoder_seek_accurate(struct ffmpeg_decoder *decoder, int64_t position_us);
+
+/* Accurate seeks decode (without showing) from the keyframe up to the
+ * target; fast seeks start playback at the keyframe */
+void ffmpeg_decoder_set_accurate_seek(struct ffmpeg_decoder *decoder, bool accurate);
+
+/* Deinterlacing of interlaced frames (enum deinterlace_mode: 0 = off,
+ * 1 = blend, 2 = bob, 3 = edge-directed). Bob and edge-directed double the
+ * frame rate. Switchable while playing */
+void ffmpeg_decoder_set_deinterlace(struct ffmpeg_decoder *decoder, int mode);
+
 /* Get current position in microseconds */
 int64_t ffmpeg_decoder_get_position(struct ffmpeg_decoder *decoder);
 
+/* Media position the playback clock maps "now" to, including clock
+ * adjustments still being slewed in. False until the clock is anchored */
+bool ffmpeg_decoder_get_clock_position(struct ffmpeg_decoder *decoder, int64_t *position_us);
+
 /* Get total duration in microseconds */
 int64_t ffmpeg_decoder_get_duration(struct ffmpeg_decoder *decoder);
 const char *ffmpeg_decoder_get_current_path(struct ffmpeg_decoder *decoder);
@@ -241,4 +476,38 @@ void ffmpeg_decoder_set_callbacks(struct ffmpeg_decoder *decoder,
 	void *opaque);
 
 /* Set output format (NV12 or BGRA) */
-void ffmpeg_decoder_set_output_format(struct ffmpeg_decoder *decoder, bool use_nv12);
\ No newline at end of file
+void ffmpeg_decoder_set_output_format(struct ffmpeg_decoder *decoder, bool use_nv12);
+
+/* Set performance mode (0 = Quality, 1 = Balanced, 2 = Performance)
+ * Codec threading takes effect on next initialize, everything else live */
+void ffmpeg_decoder_set_performance_mode(struct ffmpeg_decoder *decoder, int mode);
+
+/* Set load governor priority (enum load_priority: 0 = program, 1 = preview, 2 = hidden) */
+void ffmpeg_decoder_set_priority(struct ffmpeg_decoder *decoder, int priority);
+
+/* Decode for a smaller on-canvas size (0, 0 = native). Output keeps the
+ * video's aspect ratio and is never upscaled. Switchable while playing */
+void ffmpeg_decoder_set_target_size(struct ffmpeg_decoder *decoder, int width, int height);
+
+/* Playback speed multiplier (1.0 = normal). The current position is kept,
+ * above 1.0 frames that would never be shown are skipped before decoding
+ * or conversion, and audio is muted while the rate isn't 1.0 */
+void ffmpeg_decoder_set_rate(struct ffmpeg_decoder *decoder, double rate);
+
+/* Shift playback timing by delta_ns (positive = later) without seeking.
+ * Spread over playback at up to 5% of real time, so video repeats or drops
+ * frames and audio follows through drift correction. Cleared by a seek */
+void ffmpeg_decoder_adjust_clock(struct ffmpeg_decoder *decoder, int64_t delta_ns);
+
+/* Select the A/V sync master (enum av_sync_master). Both streams are timed
+ * from one clock; drift between the audio sample clock and that clock is
+ * measured continuously and corrected on the follower */
+void ffmpeg_decoder_set_sync_master(struct ffmpeg_decoder *decoder, int master);
+
+/* Read files in the read_ahead_mode cases (enum read_ahead_mode) through
+ * reader threads keeping window_mb in flight ahead of the demuxer. Other
+ * local files are memory mapped. Takes effect on the next initialize */
+void ffmpeg_decoder_set_read_ahead(struct ffmpeg_decoder *decoder, int mode, int window_mb);
+
+/* Smoothed audio-minus-master drift in nanoseconds (0 without audio) */
+int64_t ffmpeg_decoder_get_av_drift(struct ffmpeg_decoder *decoder);
\ No newline at end of file
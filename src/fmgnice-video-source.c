@@ -8,7 +8,14 @@
 #include <util/platform.h>
 #include <util/dstr.h>
 #include <string.h>
+#include <math.h>
 #include "ffmpeg-decoder.h"
+#include "load-governor.h"
+#include "thumbnail-cache.h"
+#include "page-warmer.h"
+#include "stream-cache.h"
+#include "shared-timeline.h"
+#include "epoch-sync.h"
 
 /* External functions from plugin-main.c */
 extern void fmgnice_register_source(void *source);
@@ -32,6 +39,15 @@ extern void fmgnice_unregister_source(void *source);
 #define S_CACHE_SIZE_MB                "cache_size_mb"
 #define S_PERFORMANCE_MODE             "performance_mode"
 #define S_OUTPUT_FORMAT                "output_format"
+#define S_DECODE_SIZE                  "decode_size"
+#define S_DEINTERLACE                  "deinterlace"
+#define S_AV_SYNC_MASTER               "av_sync_master"
+#define S_EPOCH_SYNC                   "epoch_sync"
+#define S_EPOCH_SYNC_ROLE              "epoch_sync_role"
+#define S_EPOCH_SYNC_ADDRESS           "epoch_sync_address"
+#define S_READ_AHEAD                   "read_ahead"
+#define S_READ_AHEAD_MB                "read_ahead_mb"
+#define S_WARM_AHEAD_SEC               "warm_ahead_sec"
 
 #define T_PLAYLIST                     "Playlist"
 #define T_LOOP                         "Loop Playlist"
@@ -47,6 +63,37 @@ extern void fmgnice_unregister_source(void *source);
 #define T_CACHE_SIZE_MB                "Cache Size (MB)"
 #define T_PERFORMANCE_MODE             "Performance Mode"
 #define T_OUTPUT_FORMAT                "Output Format"
+#define T_DECODE_SIZE                  "Decode Resolution"
+#define T_DEINTERLACE                  "Deinterlacing"
+#define T_AV_SYNC_MASTER               "A/V Sync Master"
+#define T_EPOCH_SYNC                   "Multi-host Sync"
+#define T_EPOCH_SYNC_ROLE              "Multi-host Role"
+#define T_EPOCH_SYNC_ADDRESS           "Multi-host Address (file path or host:port)"
+#define T_READ_AHEAD                   "Read-Ahead"
+#define T_READ_AHEAD_MB                "Read-Ahead Window (MB)"
+#define T_WARM_AHEAD_SEC               "Pre-load Next File (seconds, 0 = off)"
+
+/* Auto decode size: how often to re-measure the on-canvas size, and how much
+ * it must change before the decoder is retargeted */
+#define CANVAS_SIZE_INTERVAL_NS        2000000000ULL
+#define CANVAS_SIZE_HYSTERESIS         0.25
+
+/* Data warmed ahead of a seek target */
+#define WARM_SEEK_SPAN_US              3000000
+
+/* Timeline epoch moves up to this size are slewed into the decoder clock,
+ * larger ones seek */
+#define TIMELINE_SLEW_MAX_MS           500
+
+/* Drift controller: timeline position vs the decoder's playback clock.
+ * Small errors are slewed out a little at a time (frames are dropped or
+ * repeated), only large ones seek */
+#define DRIFT_DEADBAND_US              15000
+#define DRIFT_MAX_CORRECTION_US        50000       /* Per interval, 5% of real time */
+#define DRIFT_CORRECTION_INTERVAL_NS   1000000000ULL
+#define DRIFT_SEEK_THRESHOLD_US        2000000
+#define DRIFT_SETTLE_NS                1000000000ULL   /* After a seek or file switch */
+#define DRIFT_REPORT_INTERVAL_NS       60000000000ULL
 
 struct fvs_source {
 	obs_source_t *source;
@@ -69,16 +116,38 @@ struct fvs_source {
 	/* Sync settings */
 	int sync_mode; /* 0=global, 1=local, 2=disabled */
 	int sync_offset;
+	int av_sync_master; /* 0=system clock, 1=audio */
+	int epoch_sync; /* 0=off, 1=file, 2=UDP beacon (process-wide) */
+	int epoch_sync_role; /* 0=leader, 1=follower */
 	
 	/* Performance settings */
 	int seek_mode; /* 0=accurate, 1=fast */
 	bool frame_drop;
 	int performance_mode; /* 0=quality, 1=balanced, 2=performance */
 	int output_format; /* 0=BGRA (compatibility), 1=NV12 (performance) */
+	int load_priority; /* Last priority reported to the load governor, -1 = none */
+	int decode_size; /* 0=native, 1=auto (on-canvas size), 2=1080p, 3=720p, 4=540p, 5=360p */
+	int deinterlace; /* 0=off, 1=blend, 2=bob, 3=edge-directed */
+	int read_ahead; /* 0=off, 1=network files, 2=all files */
+	int read_ahead_mb;
+	int warm_ahead_sec; /* Warm the next file this long before the switch, 0 = off */
+	int canvas_width;  /* Largest on-canvas size found by auto mode, 0 = unknown */
+	int canvas_height;
+	uint64_t last_canvas_check;
+	
+	/* Scrub previews and poster frames */
+	struct thumbnail_cache *thumbs;
+	
+	/* Page-cache warming of upcoming files and seek targets */
+	struct page_warmer *warmer;
+	bool warm_armed;           /* Next file not yet warmed for the coming switch */
+	size_t warm_index;         /* File warm_armed belongs to */
+	atomic_bool scrubbing;     /* Decoder frames are held back while a preview is shown */
+	double playback_rate;      /* Set through the set_rate procedure */
 	
 	/* Timeline tracking */
 	uint64_t timeline_start_time;    /* When playlist started (wall clock) */
-	uint64_t timeline_pause_time;    /* Deprecated - not used anymore */
+	uint64_t timeline_pause_time;    /* Shared timeline paused at this time, 0 = running */
 	uint64_t timeline_total_offset;  /* Deprecated - not used anymore */
 	bool timeline_active;             /* Whether source is currently visible */
 	
@@ -89,6 +158,23 @@ struct fvs_source {
 	/* Loop detection */
 	int64_t last_expected_offset;
 	
+	/* Files are opened on the decoder's opener thread, the tick keeps going
+	 * (and the last frame stays on screen) meanwhile */
+	uint64_t open_request;           /* In-flight open, 0 = none */
+	volatile uint64_t open_completed;  /* Last request the decoder finished with */
+	
+	/* Drift controller */
+	struct {
+		double error_us;           /* Smoothed expected minus actual position */
+		int64_t max_error_us;      /* Largest absolute error since the last report */
+		uint64_t settle_until;     /* No corrections before this time */
+		uint64_t last_correction;
+		uint64_t last_report;
+		uint32_t corrections;
+		uint32_t seeks;
+		int64_t slewed_us;         /* Total correction applied by slewing */
+	} drift;
+	
 	/* Saved state for resume */
 	int64_t saved_position;
 	size_t saved_index;
@@ -102,24 +188,69 @@ struct fvs_source {
 	pthread_mutex_t mutex;
 };
 
-/* Global timeline for synchronization across all sources */
-static uint64_t g_global_timeline_start = 0;
+/* Global timeline for synchronization across all sources, shared with
+ * every OBS instance on this host */
+#define GLOBAL_TIMELINE_NAME "fmgnice-video-timeline"
+static struct shared_timeline *g_timeline = NULL;
 static pthread_mutex_t g_timeline_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-/* Reset global timeline - call this to start a new synchronized show/event */
-void fmgnice_reset_global_timeline(void)
+static struct shared_timeline *global_timeline(void)
 {
 	pthread_mutex_lock(&g_timeline_mutex);
-	uint64_t old_timeline = g_global_timeline_start;
-	g_global_timeline_start = 0;
+	if (!g_timeline) {
+		g_timeline = shared_timeline_open(GLOBAL_TIMELINE_NAME);
+		if (!g_timeline) {
+			/* Still syncs the sources of this instance */
+			blog(LOG_WARNING, "[fmgNICE Video] Shared timeline unavailable, syncing within this process only");
+			g_timeline = shared_timeline_open(NULL);
+		}
+	}
+	struct shared_timeline *tl = g_timeline;
 	pthread_mutex_unlock(&g_timeline_mutex);
+	return tl;
+}
+
+/* Called on module unload */
+void fmgnice_close_global_timeline(void)
+{
+	epoch_sync_shutdown();
 	
-	if (old_timeline != 0) {
+	pthread_mutex_lock(&g_timeline_mutex);
+	shared_timeline_close(g_timeline);
+	g_timeline = NULL;
+	pthread_mutex_unlock(&g_timeline_mutex);
+}
+
+/* Reset global timeline - call this to start a new synchronized show/event */
+void fmgnice_reset_global_timeline(void)
+{
+	struct shared_timeline_state state;
+	struct shared_timeline *tl = global_timeline();
+	bool had_timeline = shared_timeline_read(tl, &state) && state.epoch_ms != 0;
+	
+	shared_timeline_reset(tl);
+	
+	if (had_timeline) {
 		blog(LOG_INFO, "[fmgNICE Video] Global timeline reset (was %llu ms)", 
-			(unsigned long long)old_timeline);
+			(unsigned long long)state.epoch_ms);
 	}
 }
 
+/* Pause or resume the global timeline in every instance on this host */
+void fmgnice_set_global_timeline_paused(bool paused)
+{
+	shared_timeline_set_paused(global_timeline(), paused, os_gettime_ns() / 1000000);
+	blog(LOG_INFO, "[fmgNICE Video] Global timeline %s", paused ? "paused" : "resumed");
+}
+
+/* First source on the host sets the global timeline, all others join it */
+static void join_global_timeline(struct fvs_source *s)
+{
+	uint64_t hash = shared_timeline_hash_playlist(s->playlist.array, s->playlist.num);
+	s->timeline_start_time = shared_timeline_join(global_timeline(),
+		os_gettime_ns() / 1000000, hash);
+}
+
 static const char *fvs_get_name(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -143,6 +274,7 @@ static void fvs_destroy(void *data)
 	
 	/* Unregister from global tracking */
 	fmgnice_unregister_source(s);
+	epoch_sync_release(s);
 	
 	/* Stop outputting frames immediately */
 	if (s->source) {
@@ -162,6 +294,9 @@ static void fvs_destroy(void *data)
 		s->decoder = NULL;
 	}
 	
+	thumbnail_cache_destroy(s->thumbs);
+	page_warmer_destroy(s->warmer);
+	
 	free_playlist(s);
 	da_free(s->durations);
 	pthread_mutex_destroy(&s->mutex);
@@ -179,6 +314,10 @@ static void get_frame(void *opaque, struct obs_source_frame *frame)
 	/* Validate frame data */
 	if (!frame->data[0] || frame->width == 0 || frame->height == 0)
 		return;
+	
+	/* Keep the scrub preview on screen until scrubbing ends */
+	if (atomic_load(&s->scrubbing))
+		return;
 		
 	obs_source_output_video(s->source, frame);
 }
@@ -198,6 +337,17 @@ static void get_audio(void *opaque, struct obs_source_audio *audio)
 
 /* Removed media_stopped callback - decoder handles EOF internally */
 
+/* Called on the decoder's opener thread; the tick picks the result up */
+static void open_completed(void *opaque, uint64_t request_id, enum decoder_open_result result)
+{
+	struct fvs_source *s = opaque;
+	
+	if (result == DECODER_OPEN_FAILED)
+		blog(LOG_ERROR, "[fmgNICE Video] Failed to open file (request %llu)", (unsigned long long)request_id);
+	
+	s->open_completed = request_id;
+}
+
 static void cache_durations(struct fvs_source *s)
 {
 	da_resize(s->durations, 0);
@@ -207,10 +357,14 @@ static void cache_durations(struct fvs_source *s)
 		const char *path = s->playlist.array[i];
 		int64_t duration = 0;
 		
-		/* Get actual duration from video file using FFmpeg */
+		/* Get actual duration from video file using FFmpeg. The probe is
+		 * cached, so the decoder's open of the same file doesn't repeat it */
 		AVFormatContext *fmt_ctx = NULL;
-		if (avformat_open_input(&fmt_ctx, path, NULL, NULL) == 0) {
+		if (stream_cache_get_duration(path, &duration)) {
+			/* Probed before */
+		} else if (avformat_open_input(&fmt_ctx, path, NULL, NULL) == 0) {
 			if (avformat_find_stream_info(fmt_ctx, NULL) >= 0) {
+				stream_cache_store(path, fmt_ctx);
 				/* Duration is in AV_TIME_BASE units (microseconds) */
 				duration = fmt_ctx->duration;
 				if (duration == AV_NOPTS_VALUE || duration <= 0) {
@@ -241,6 +395,9 @@ static void cache_durations(struct fvs_source *s)
 	double total_hours = (double)s->total_duration / (1000000.0 * 3600.0);
 	blog(LOG_INFO, "[fmgNICE Video] Total playlist duration: %.2f hours (%lld ms)", 
 		total_hours, (long long)(s->total_duration / 1000));
+	
+	/* A new playlist may start inside the pre-load window */
+	s->warm_armed = true;
 }
 
 static void calculate_timeline_position(struct fvs_source *s, 
@@ -256,9 +413,11 @@ static void calculate_timeline_position(struct fvs_source *s,
 	}
 	
 	/* Calculate elapsed time since timeline start
-	 * For synchronized timeline, time always advances regardless of visibility
+	 * For synchronized timeline, time always advances regardless of visibility,
+	 * unless the shared timeline is paused
 	 */
-	uint64_t current_time = os_gettime_ns() / 1000000; /* Convert to ms */
+	uint64_t current_time = s->timeline_pause_time ? s->timeline_pause_time :
+		os_gettime_ns() / 1000000; /* Convert to ms */
 	uint64_t elapsed_ms = current_time - s->timeline_start_time;
 	int64_t elapsed_us = elapsed_ms * 1000; /* Convert to microseconds for FFmpeg */
 	
@@ -310,6 +469,97 @@ static void calculate_timeline_position(struct fvs_source *s,
 	}
 }
 
+/* Target box for a fixed decode size preset, 0x0 = native */
+static void decode_size_preset(int decode_size, int *width, int *height)
+{
+	switch (decode_size) {
+	case 2:  *width = 1920; *height = 1080; break;
+	case 3:  *width = 1280; *height = 720;  break;
+	case 4:  *width = 960;  *height = 540;  break;
+	case 5:  *width = 640;  *height = 360;  break;
+	default: *width = 0;    *height = 0;    break;
+	}
+}
+
+static void apply_decode_size(struct fvs_source *s)
+{
+	if (!s->decoder)
+		return;
+	
+	int width, height;
+	if (s->decode_size == 1) {
+		width = s->canvas_width;
+		height = s->canvas_height;
+	} else {
+		decode_size_preset(s->decode_size, &width, &height);
+	}
+	ffmpeg_decoder_set_target_size(s->decoder, width, height);
+}
+
+/* Pull the data around a seek target into the page cache, in parallel with
+ * the decoder's own seek (called with the source mutex held) */
+static void warm_seek_target(struct fvs_source *s, size_t index, int64_t offset)
+{
+	if (s->warm_ahead_sec <= 0 || index >= s->playlist.num || index >= s->durations.num)
+		return;
+	
+	page_warmer_warm_at(s->warmer, s->playlist.array[index], offset,
+		s->durations.array[index], WARM_SEEK_SPAN_US);
+}
+
+/* Once playback is within warm_ahead_sec of the end of the current file,
+ * warm the head of the file the timeline switches to next - file 0 again
+ * when the playlist loops (called with the source mutex held) */
+static void warm_upcoming(struct fvs_source *s, size_t index, int64_t offset)
+{
+	if (s->warm_ahead_sec <= 0 || index >= s->durations.num)
+		return;
+	
+	int64_t warm_us = (int64_t)s->warm_ahead_sec * 1000000;
+	int64_t remaining = s->durations.array[index] - offset;
+	
+	/* A file shorter than the window starts inside it */
+	if (remaining > warm_us || index != s->warm_index) {
+		s->warm_armed = true;
+		s->warm_index = index;
+		if (remaining > warm_us)
+			return;
+	}
+	if (!s->warm_armed)
+		return;
+	s->warm_armed = false;
+	
+	size_t next = index + 1;
+	if (next >= s->playlist.num || next >= s->durations.num) {
+		if (!s->loop)
+			return;
+		next = 0;
+	}
+	
+	blog(LOG_DEBUG, "[fmgNICE Video] Warming file %zu, %lld ms before the switch",
+		next, (long long)(remaining / 1000));
+	page_warmer_warm_head(s->warmer, s->playlist.array[next], s->durations.array[next], warm_us);
+}
+
+/* Switch the decoder to a playlist file at offset without blocking
+ * (called with the source mutex held) */
+static void open_file(struct fvs_source *s, size_t index, int64_t offset)
+{
+	s->open_request = ffmpeg_decoder_open_async(s->decoder, s->playlist.array[index], offset,
+		s->timeline_start_time, open_completed, s);
+}
+
+/* True while an open is in flight: the decoder's file state belongs to its
+ * opener thread until then (called with the source mutex held) */
+static bool open_in_flight(struct fvs_source *s)
+{
+	if (s->open_request && s->open_completed == s->open_request) {
+		s->open_request = 0;
+		s->drift.settle_until = os_gettime_ns() + DRIFT_SETTLE_NS;
+	}
+	return s->open_request != 0;
+}
+
 static void start_playback(struct fvs_source *s)
 {
 	if (s->playlist.num == 0)
@@ -344,32 +594,27 @@ static void start_playback(struct fvs_source *s)
 		ffmpeg_decoder_set_callbacks(s->decoder, get_frame, get_audio, s);
 		/* Set output format based on user preference */
 		ffmpeg_decoder_set_output_format(s->decoder, s->output_format == 1);
+		/* Apply performance policy before the codec is opened */
+		ffmpeg_decoder_set_performance_mode(s->decoder, s->performance_mode);
+		apply_decode_size(s);
+		ffmpeg_decoder_set_rate(s->decoder, s->playback_rate);
+		ffmpeg_decoder_set_sync_master(s->decoder, s->av_sync_master);
+		ffmpeg_decoder_set_accurate_seek(s->decoder, s->seek_mode == 0);
+		ffmpeg_decoder_set_deinterlace(s->decoder, s->deinterlace);
+		ffmpeg_decoder_set_read_ahead(s->decoder, s->read_ahead, s->read_ahead_mb);
+		/* New decoder starts hidden, report priority on next tick */
+		s->load_priority = -1;
 	}
 	
-	/* Check if we need to load a different file */
-	const char *current_path = ffmpeg_decoder_get_current_path(s->decoder);
+	/* Check if we need to load a different file (always while another
+	 * open is in flight, the decoder's current file isn't settled) */
 	const char *target_path = s->playlist.array[s->current_index];
+	const char *current_path = open_in_flight(s) ? NULL : ffmpeg_decoder_get_current_path(s->decoder);
 	bool need_reinit = !current_path || strcmp(current_path, target_path) != 0;
 	
-	if (need_reinit) {
-		blog(LOG_INFO, "[fmgNICE Video] Loading new file: %s", target_path);
-		
-		/* Stop any current playback */
-		ffmpeg_decoder_stop(s->decoder);
-		
-		/* Initialize with new file */
-		if (!ffmpeg_decoder_initialize(s->decoder, target_path)) {
-			blog(LOG_ERROR, "[fmgNICE Video] Failed to initialize decoder");
-			return;
-		}
-	} else {
-		blog(LOG_INFO, "[fmgNICE Video] File already loaded, seeking to position");
-	}
-	
-	/* Seek to synchronized position BEFORE starting playback */
 	if (offset > 0) {
 		/* Sanity check - don't seek past 95% of video duration */
-		int64_t duration = ffmpeg_decoder_get_duration(s->decoder);
+		int64_t duration = s->current_index < s->durations.num ? s->durations.array[s->current_index] : 0;
 		int64_t max_seek = duration > 0 ? (duration * 95 / 100) : ((int64_t)30 * 60 * 1000000 * 95 / 100);
 		
 		if (offset > max_seek) {
@@ -378,6 +623,21 @@ static void start_playback(struct fvs_source *s)
 			offset = max_seek;
 		}
 		
+		warm_seek_target(s, s->current_index, offset);
+	}
+	
+	if (need_reinit) {
+		/* Opened, seeked and started on the opener thread */
+		blog(LOG_INFO, "[fmgNICE Video] Loading new file: %s at %lld ms", target_path,
+			(long long)(offset / 1000));
+		open_file(s, s->current_index, offset);
+		return;
+	}
+	
+	blog(LOG_INFO, "[fmgNICE Video] File already loaded, seeking to position");
+	
+	/* Seek to synchronized position BEFORE starting playback */
+	if (offset > 0) {
 		blog(LOG_INFO, "[fmgNICE Video] Seeking to synchronized position: %lld us (%lld ms)", 
 			(long long)offset, (long long)(offset / 1000));
 		ffmpeg_decoder_seek(s->decoder, offset);
@@ -405,16 +665,7 @@ static void fvs_activate(void *data)
 	}
 	
 	/* Use global timeline for synchronization */
-	pthread_mutex_lock(&g_timeline_mutex);
-	if (g_global_timeline_start == 0) {
-		/* First source to activate sets the global timeline */
-		g_global_timeline_start = os_gettime_ns() / 1000000;
-		blog(LOG_INFO, "[fmgNICE Video] Initialized global timeline at %llu ms", 
-			(unsigned long long)g_global_timeline_start);
-	}
-	/* All sources use the same global timeline */
-	s->timeline_start_time = g_global_timeline_start;
-	pthread_mutex_unlock(&g_timeline_mutex);
+	join_global_timeline(s);
 	
 	/* Cache durations if not already done */
 	if (s->durations.num == 0) {
@@ -425,9 +676,12 @@ static void fvs_activate(void *data)
 		(unsigned long long)s->timeline_start_time);
 	
 	s->timeline_active = true;
+	s->drift.settle_until = os_gettime_ns() + DRIFT_SETTLE_NS;
+	/* Joining close to a switch still warms the next file */
+	s->warm_armed = true;
 	
 	/* Check if decoder is in paused ready state and can resume */
-	if (s->decoder && ffmpeg_decoder_is_paused_ready(s->decoder)) {
+	if (s->decoder && !open_in_flight(s) && ffmpeg_decoder_is_paused_ready(s->decoder)) {
 		blog(LOG_INFO, "[fmgNICE Video] Resuming from paused state - instant restart!");
 		if (ffmpeg_decoder_resume(s->decoder)) {
 			/* Successfully resumed - no need to restart */
@@ -442,6 +696,144 @@ static void fvs_activate(void *data)
 	pthread_mutex_unlock(&s->mutex);
 }
 
+struct canvas_size_search {
+	obs_source_t *source;
+	float width;
+	float height;
+};
+
+static bool find_canvas_size_item(obs_scene_t *scene, obs_sceneitem_t *item, void *param)
+{
+	struct canvas_size_search *search = param;
+	
+	UNUSED_PARAMETER(scene);
+	
+	if (!obs_sceneitem_visible(item))
+		return true;
+	
+	if (obs_sceneitem_is_group(item)) {
+		obs_sceneitem_group_enum_items(item, find_canvas_size_item, search);
+		return true;
+	}
+	
+	if (obs_sceneitem_get_source(item) != search->source)
+		return true;
+	
+	/* Box transform axes are the item's on-canvas edges, rotation included */
+	struct matrix4 box;
+	obs_sceneitem_get_box_transform(item, &box);
+	float width = hypotf(box.x.x, box.x.y);
+	float height = hypotf(box.y.x, box.y.y);
+	
+	if (width > search->width)
+		search->width = width;
+	if (height > search->height)
+		search->height = height;
+	return true;
+}
+
+static bool find_canvas_size_scene(void *param, obs_source_t *scene_source)
+{
+	obs_scene_t *scene = obs_scene_from_source(scene_source);
+	if (scene)
+		obs_scene_enum_items(scene, find_canvas_size_item, param);
+	return true;
+}
+
+/* Auto decode size: measure the largest size this source is drawn at on any
+ * scene and retarget the decoder when it changes noticeably */
+static void update_canvas_size(struct fvs_source *s)
+{
+	uint64_t now = os_gettime_ns();
+	if (now - s->last_canvas_check < CANVAS_SIZE_INTERVAL_NS)
+		return;
+	s->last_canvas_check = now;
+	
+	struct canvas_size_search search = { s->source, 0.0f, 0.0f };
+	obs_enum_scenes(find_canvas_size_scene, &search);
+	
+	/* Not found (e.g. nested in another source) - decode at native size */
+	int width = search.width >= 1.0f ? (int)ceilf(search.width) : 0;
+	int height = search.height >= 1.0f ? (int)ceilf(search.height) : 0;
+	
+	bool changed;
+	if (!width || !s->canvas_width) {
+		changed = width != s->canvas_width;
+	} else {
+		double ratio = (double)width / s->canvas_width;
+		changed = ratio > 1.0 + CANVAS_SIZE_HYSTERESIS || ratio < 1.0 / (1.0 + CANVAS_SIZE_HYSTERESIS);
+	}
+	
+	if (changed) {
+		blog(LOG_INFO, "[fmgNICE Video] On-canvas size %dx%d -> %dx%d",
+			s->canvas_width, s->canvas_height, width, height);
+		s->canvas_width = width;
+		s->canvas_height = height;
+		apply_decode_size(s);
+	}
+}
+
+/* Compare the timeline position with the decoder's playback clock every
+ * tick and correct drift (called with the source mutex held) */
+static void correct_drift(struct fvs_source *s, int64_t expected_offset)
+{
+	uint64_t now = os_gettime_ns();
+	int64_t position;
+	
+	/* Off-speed playback leaves the timeline on purpose */
+	if (now < s->drift.settle_until || s->playback_rate != 1.0 || atomic_load(&s->scrubbing) ||
+	    !ffmpeg_decoder_get_clock_position(s->decoder, &position))
+		return;
+	
+	/* Positive = playback is behind the timeline */
+	int64_t error = expected_offset - position;
+	int64_t abs_error = error < 0 ? -error : error;
+	if (abs_error > s->drift.max_error_us)
+		s->drift.max_error_us = abs_error;
+	
+	if (abs_error > DRIFT_SEEK_THRESHOLD_US) {
+		blog(LOG_INFO, "[fmgNICE Video] Drift %lld ms too large to slew, seeking to %lld ms",
+			(long long)(error / 1000), (long long)(expected_offset / 1000));
+		warm_seek_target(s, s->current_index, expected_offset);
+		ffmpeg_decoder_seek_accurate(s->decoder, expected_offset);
+		s->drift.seeks++;
+		s->drift.error_us = 0.0;
+		s->drift.settle_until = now + DRIFT_SETTLE_NS;
+		return;
+	}
+	
+	s->drift.error_us += ((double)error - s->drift.error_us) / 8.0;
+	
+	if (now - s->drift.last_correction >= DRIFT_CORRECTION_INTERVAL_NS) {
+		s->drift.last_correction = now;
+		
+		if (fabs(s->drift.error_us) > DRIFT_DEADBAND_US) {
+			double correction = s->drift.error_us;
+			if (correction > DRIFT_MAX_CORRECTION_US) correction = DRIFT_MAX_CORRECTION_US;
+			if (correction < -DRIFT_MAX_CORRECTION_US) correction = -DRIFT_MAX_CORRECTION_US;
+			
+			/* Behind: show frames earlier (drops), ahead: later (repeats) */
+			ffmpeg_decoder_adjust_clock(s->decoder, -(int64_t)(correction * 1000.0));
+			s->drift.error_us -= correction;
+			s->drift.slewed_us += (int64_t)fabs(correction);
+			s->drift.corrections++;
+		}
+	}
+	
+	if (now - s->drift.last_report >= DRIFT_REPORT_INTERVAL_NS) {
+		if (s->drift.last_report && (s->drift.corrections || s->drift.seeks)) {
+			blog(LOG_INFO, "[fmgNICE Video] Drift: %.1f ms now, max %lld ms, %u slews (%lld ms total), %u seeks",
+				s->drift.error_us / 1000.0, (long long)(s->drift.max_error_us / 1000),
+				s->drift.corrections, (long long)(s->drift.slewed_us / 1000), s->drift.seeks);
+		}
+		s->drift.last_report = now;
+		s->drift.max_error_us = 0;
+		s->drift.corrections = 0;
+		s->drift.seeks = 0;
+		s->drift.slewed_us = 0;
+	}
+}
+
 static void fvs_video_tick(void *data, float seconds)
 {
 	struct fvs_source *s = data;
@@ -451,8 +843,23 @@ static void fvs_video_tick(void *data, float seconds)
 	if (!s || !s->decoder)
 		return;
 	
+	/* Report visibility to the load governor - program sources are served
+	 * first, preview-only sources are shed first */
+	int priority = obs_source_active(s->source) ? LOAD_PRIORITY_PROGRAM :
+		obs_source_showing(s->source) ? LOAD_PRIORITY_PREVIEW : LOAD_PRIORITY_HIDDEN;
+	if (priority != s->load_priority) {
+		ffmpeg_decoder_set_priority(s->decoder, priority);
+		s->load_priority = priority;
+	}
+	load_governor_tick();
+	epoch_sync_tick(global_timeline());
+	
+	if (s->decode_size == 1 && priority != LOAD_PRIORITY_HIDDEN) {
+		update_canvas_size(s);
+	}
+	
 	/* Skip processing if source is not active/visible to save CPU */
-	if (!obs_source_active(s->source)) {
+	if (priority != LOAD_PRIORITY_PROGRAM) {
 		return;
 	}
 	
@@ -464,15 +871,41 @@ static void fvs_video_tick(void *data, float seconds)
 	
 	pthread_mutex_lock(&s->mutex);
 	
-	if (s->timeline_active && s->timeline_start_time > 0) {
+	/* Follow epoch and pause changes made by other sources or instances */
+	bool needs_resync = false;
+	struct shared_timeline_state tl_state;
+	if (s->timeline_active && s->timeline_start_time > 0 &&
+	    shared_timeline_read(global_timeline(), &tl_state)) {
+		if (tl_state.epoch_ms != 0 && tl_state.epoch_ms != s->timeline_start_time) {
+			int64_t delta_ms = (int64_t)(tl_state.epoch_ms - s->timeline_start_time);
+			if (delta_ms >= -TIMELINE_SLEW_MAX_MS && delta_ms <= TIMELINE_SLEW_MAX_MS) {
+				/* Small correction (e.g. a remote host's epoch) - slew, don't seek */
+				ffmpeg_decoder_adjust_clock(s->decoder, delta_ms * 1000000);
+			} else {
+				blog(LOG_INFO, "[fmgNICE Video] Global timeline moved: %llu -> %llu ms",
+					(unsigned long long)s->timeline_start_time, (unsigned long long)tl_state.epoch_ms);
+				needs_resync = true;
+			}
+			s->timeline_start_time = tl_state.epoch_ms;
+		}
+		
+		uint64_t pause_time = tl_state.paused ? tl_state.pause_time_ms : 0;
+		if (pause_time && !s->timeline_pause_time) {
+			/* Resuming reopens or seeks as needed */
+			ffmpeg_decoder_cancel_open(s->decoder);
+			ffmpeg_decoder_pause(s->decoder);
+		} else if (!pause_time && s->timeline_pause_time) {
+			needs_resync = true;
+		}
+		s->timeline_pause_time = pause_time;
+	}
+	
+	if (s->timeline_active && s->timeline_start_time > 0 && !s->timeline_pause_time) {
 		/* Calculate where we should be on the timeline */
 		size_t expected_index = 0;
 		int64_t expected_offset = 0;
 		calculate_timeline_position(s, &expected_index, &expected_offset);
 		
-		/* Get current playback position */
-		int64_t current_position = ffmpeg_decoder_get_position(s->decoder);
-		
 		/* Check if we need to loop back within the same file */
 		bool needs_loop_seek = false;
 		
@@ -487,9 +920,16 @@ static void fvs_video_tick(void *data, float seconds)
 		}
 		
 		s->last_expected_offset = expected_offset;
+		warm_upcoming(s, expected_index, expected_offset);
+		
+		/* The last frame stays up while a file opens. A newer switch
+		 * supersedes the open, nothing else touches the decoder */
+		bool opening = open_in_flight(s);
 		
 		/* Check if we should be playing a different file (including looping back to first) */
-		if (expected_index != s->current_index || needs_loop_seek) {
+		if (expected_index != s->current_index || needs_loop_seek || needs_resync) {
+			s->drift.settle_until = os_gettime_ns() + DRIFT_SETTLE_NS;
+			
 			if (expected_index != s->current_index) {
 				blog(LOG_INFO, "[fmgNICE Video] Timeline sync: switching from file %zu to %zu (looping: %s)",
 					s->current_index, expected_index, s->loop ? "yes" : "no");
@@ -500,22 +940,26 @@ static void fvs_video_tick(void *data, float seconds)
 			/* Load the new file or seek within current file */
 			if (s->current_index < s->playlist.num) {
 				const char *path = s->playlist.array[s->current_index];
-				const char *current_path = ffmpeg_decoder_get_current_path(s->decoder);
+				const char *current_path = opening ? NULL : ffmpeg_decoder_get_current_path(s->decoder);
 				
 				if (!current_path || strcmp(current_path, path) != 0) {
-					if (ffmpeg_decoder_initialize(s->decoder, path)) {
-						ffmpeg_decoder_seek(s->decoder, expected_offset);
-						ffmpeg_decoder_play_with_timeline(s->decoder, s->timeline_start_time);
-						blog(LOG_INFO, "[fmgNICE Video] Loaded file for timeline sync: %s at %lld ms",
-							path, (long long)(expected_offset / 1000));
-					}
-				} else if (needs_loop_seek) {
-					/* Same file but looping - just seek */
+					if (expected_offset > WARM_SEEK_SPAN_US)
+						warm_seek_target(s, s->current_index, expected_offset);
+					open_file(s, s->current_index, expected_offset);
+					blog(LOG_INFO, "[fmgNICE Video] Loading file for timeline sync: %s at %lld ms",
+						path, (long long)(expected_offset / 1000));
+				} else if (needs_loop_seek || needs_resync) {
+					/* Same file but looping or the timeline moved - just seek */
+					warm_seek_target(s, s->current_index, expected_offset);
 					ffmpeg_decoder_seek(s->decoder, expected_offset);
-					blog(LOG_INFO, "[fmgNICE Video] Looping within same file: seeking to %lld ms",
-						(long long)(expected_offset / 1000));
+					if (!ffmpeg_decoder_is_playing(s->decoder))
+						ffmpeg_decoder_play_with_timeline(s->decoder, s->timeline_start_time);
+					blog(LOG_INFO, "[fmgNICE Video] %s within same file: seeking to %lld ms",
+						needs_loop_seek ? "Looping" : "Resyncing", (long long)(expected_offset / 1000));
 				}
 			}
+		} else if (!opening) {
+			correct_drift(s, expected_offset);
 		}
 	}
 	
@@ -588,6 +1032,8 @@ static void fvs_deactivate(void *data)
 	
 	/* Pause decoder output but keep it ready */
 	if (s->decoder) {
+		/* A file still opening would start playing */
+		ffmpeg_decoder_cancel_open(s->decoder);
 		ffmpeg_decoder_pause_ready(s->decoder);
 		
 		/* Start timer thread for deferred shutdown */
@@ -646,12 +1092,25 @@ static void fvs_update(void *data, obs_data_t *settings)
 	s->prebuffer_ms = (int)obs_data_get_int(settings, S_PREBUFFER_MS);
 	s->sync_mode = (int)obs_data_get_int(settings, S_SYNC_MODE);
 	s->sync_offset = (int)obs_data_get_int(settings, S_SYNC_OFFSET);
+	s->av_sync_master = (int)obs_data_get_int(settings, S_AV_SYNC_MASTER);
+	s->epoch_sync = (int)obs_data_get_int(settings, S_EPOCH_SYNC);
+	s->epoch_sync_role = (int)obs_data_get_int(settings, S_EPOCH_SYNC_ROLE);
+	/* Process-wide, the first source that turned it on owns the settings */
+	epoch_sync_configure(s, (enum epoch_sync_backend)s->epoch_sync,
+		(enum epoch_sync_role)s->epoch_sync_role,
+		obs_data_get_string(settings, S_EPOCH_SYNC_ADDRESS));
 	s->seek_mode = (int)obs_data_get_int(settings, S_SEEK_MODE);
 	s->frame_drop = obs_data_get_bool(settings, S_FRAME_DROP);
 	s->audio_buffer_ms = (int)obs_data_get_int(settings, S_AUDIO_BUFFER_MS);
 	s->cache_size_mb = (int)obs_data_get_int(settings, S_CACHE_SIZE_MB);
 	s->performance_mode = (int)obs_data_get_int(settings, S_PERFORMANCE_MODE);
 	s->output_format = (int)obs_data_get_int(settings, S_OUTPUT_FORMAT);
+	s->decode_size = (int)obs_data_get_int(settings, S_DECODE_SIZE);
+	s->deinterlace = (int)obs_data_get_int(settings, S_DEINTERLACE);
+	s->read_ahead = (int)obs_data_get_int(settings, S_READ_AHEAD);
+	s->read_ahead_mb = (int)obs_data_get_int(settings, S_READ_AHEAD_MB);
+	s->warm_ahead_sec = (int)obs_data_get_int(settings, S_WARM_AHEAD_SEC);
+	s->last_canvas_check = 0; /* Re-measure on next tick in auto mode */
 	
 	/* Handle timeline initialization and resets */
 	if (playlist_changed) {
@@ -674,6 +1133,12 @@ static void fvs_update(void *data, obs_data_t *settings)
 		da_resize(s->durations, 0);
 		cache_durations(s);
 		
+		/* Generate poster frames in the background */
+		thumbnail_cache_cancel_posters(s->thumbs);
+		for (size_t i = 0; i < s->playlist.num; i++) {
+			thumbnail_cache_request_poster(s->thumbs, s->playlist.array[i]);
+		}
+		
 		/* Restore timeline position if we were playing */
 		if (was_playing || was_active) {
 			/* Keep using the global timeline - don't adjust it */
@@ -688,15 +1153,10 @@ static void fvs_update(void *data, obs_data_t *settings)
 				
 				/* Load appropriate file if needed */
 				if (new_index < s->playlist.num) {
-					const char *path = s->playlist.array[new_index];
 					s->current_index = new_index;
-					
-					if (ffmpeg_decoder_initialize(s->decoder, path)) {
-						ffmpeg_decoder_seek(s->decoder, new_offset);
-						ffmpeg_decoder_play_with_timeline(s->decoder, s->timeline_start_time);
-						blog(LOG_INFO, "[fmgNICE Video] Resumed playback after playlist change: file %zu at %lld ms",
-							new_index, (long long)(new_offset / 1000));
-					}
+					open_file(s, new_index, new_offset);
+					blog(LOG_INFO, "[fmgNICE Video] Resuming playback after playlist change: file %zu at %lld ms",
+						new_index, (long long)(new_offset / 1000));
 				}
 			}
 		}
@@ -705,16 +1165,7 @@ static void fvs_update(void *data, obs_data_t *settings)
 	/* Initialize timeline if needed (first time only) */
 	if (s->timeline_start_time == 0 && s->playlist.num > 0) {
 		/* Use global timeline for synchronization */
-		pthread_mutex_lock(&g_timeline_mutex);
-		if (g_global_timeline_start == 0) {
-			/* First source to be created/updated sets the global timeline */
-			g_global_timeline_start = os_gettime_ns() / 1000000;
-			blog(LOG_INFO, "[fmgNICE Video] Initialized global timeline at %llu ms", 
-				(unsigned long long)g_global_timeline_start);
-		}
-		/* All sources use the same global timeline */
-		s->timeline_start_time = g_global_timeline_start;
-		pthread_mutex_unlock(&g_timeline_mutex);
+		join_global_timeline(s);
 		
 		cache_durations(s);
 		blog(LOG_INFO, "[fmgNICE Video] Timeline initialized at source creation/update: %llu ms",
@@ -725,14 +1176,140 @@ static void fvs_update(void *data, obs_data_t *settings)
 		blog(LOG_INFO, "[fmgNICE Video] Timeline ready, waiting for source activation");
 	}
 	
-	/* Update decoder output format if it exists */
+	/* Update decoder output format and performance policy if it exists */
 	if (s->decoder) {
 		ffmpeg_decoder_set_output_format(s->decoder, s->output_format == 1);
+		ffmpeg_decoder_set_performance_mode(s->decoder, s->performance_mode);
+		ffmpeg_decoder_set_sync_master(s->decoder, s->av_sync_master);
+		ffmpeg_decoder_set_accurate_seek(s->decoder, s->seek_mode == 0);
+		ffmpeg_decoder_set_deinterlace(s->decoder, s->deinterlace);
+		/* Used from the next file opened */
+		ffmpeg_decoder_set_read_ahead(s->decoder, s->read_ahead, s->read_ahead_mb);
+		apply_decode_size(s);
 	}
 	
 	pthread_mutex_unlock(&s->mutex);
 }
 
+/* Playlist time (from the start of the first file) to file index and offset */
+static bool resolve_playlist_time(struct fvs_source *s, int64_t time_us,
+                                  size_t *out_index, int64_t *out_offset)
+{
+	if (s->durations.num == 0 || s->durations.num != s->playlist.num)
+		return false;
+	
+	if (time_us < 0)
+		time_us = 0;
+	if (s->loop && s->total_duration > 0)
+		time_us %= s->total_duration;
+	
+	int64_t accumulated = 0;
+	for (size_t i = 0; i < s->durations.num; i++) {
+		if (time_us < accumulated + s->durations.array[i]) {
+			*out_index = i;
+			*out_offset = time_us - accumulated;
+			return true;
+		}
+		accumulated += s->durations.array[i];
+	}
+	
+	*out_index = s->durations.num - 1;
+	*out_offset = s->durations.array[*out_index];
+	return true;
+}
+
+/* Show the keyframe nearest to a playlist position without touching the
+ * playback decoder. Decoder output is held back until scrub_end */
+static void proc_scrub_preview(void *data, calldata_t *cd)
+{
+	struct fvs_source *s = data;
+	int64_t time_us = (int64_t)calldata_int(cd, "time_ms") * 1000;
+	
+	size_t index;
+	int64_t offset;
+	char *path = NULL;
+	
+	pthread_mutex_lock(&s->mutex);
+	if (resolve_playlist_time(s, time_us, &index, &offset))
+		path = bstrdup(s->playlist.array[index]);
+	pthread_mutex_unlock(&s->mutex);
+	
+	if (!path)
+		return;
+	
+	struct thumbnail thumb;
+	if (thumbnail_cache_get(s->thumbs, path, offset, &thumb)) {
+		atomic_store(&s->scrubbing, true);
+		
+		struct obs_source_frame frame = {0};
+		frame.data[0] = thumb.data;
+		frame.linesize[0] = thumb.linesize;
+		frame.width = thumb.width;
+		frame.height = thumb.height;
+		frame.format = VIDEO_FORMAT_BGRA;
+		frame.timestamp = os_gettime_ns();
+		obs_source_output_video(s->source, &frame);
+		
+		thumbnail_free(&thumb);
+	}
+	
+	bfree(path);
+}
+
+/* Resume showing the decoder's frames */
+static void proc_scrub_end(void *data, calldata_t *cd)
+{
+	struct fvs_source *s = data;
+	
+	UNUSED_PARAMETER(cd);
+	
+	atomic_store(&s->scrubbing, false);
+}
+
+/* Copy a file's poster frame into the caller's struct thumbnail (free it
+ * with thumbnail_free). found is false until the worker has produced it */
+static void proc_get_poster(void *data, calldata_t *cd)
+{
+	struct fvs_source *s = data;
+	size_t index = (size_t)calldata_int(cd, "index");
+	struct thumbnail *thumb = calldata_ptr(cd, "thumbnail");
+	bool found = false;
+	char *path = NULL;
+	
+	pthread_mutex_lock(&s->mutex);
+	if (index < s->playlist.num)
+		path = bstrdup(s->playlist.array[index]);
+	pthread_mutex_unlock(&s->mutex);
+	
+	if (path && thumb)
+		found = thumbnail_cache_get_poster(s->thumbs, path, thumb);
+	
+	calldata_set_bool(cd, "found", found);
+	bfree(path);
+}
+
+/* Playback speed multiplier, 1.0 = normal */
+static void proc_set_rate(void *data, calldata_t *cd)
+{
+	struct fvs_source *s = data;
+	double rate = calldata_float(cd, "rate");
+	
+	if (rate <= 0.0)
+		return;
+	
+	pthread_mutex_lock(&s->mutex);
+	s->playback_rate = rate;
+	if (s->decoder)
+		ffmpeg_decoder_set_rate(s->decoder, rate);
+	pthread_mutex_unlock(&s->mutex);
+}
+
+static void proc_set_timeline_paused(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	fmgnice_set_global_timeline_paused(calldata_bool(cd, "paused"));
+}
+
 static void *fvs_create(obs_data_t *settings, obs_source_t *source)
 {
 	/* No longer limiting to one instance - thread safety issues have been fixed */
@@ -743,11 +1320,23 @@ static void *fvs_create(obs_data_t *settings, obs_source_t *source)
 	}
 	
 	s->source = source;
+	s->load_priority = -1;
+	s->thumbs = thumbnail_cache_create(0, 0);
+	s->warmer = page_warmer_create();
+	s->playback_rate = 1.0;
 	
 	pthread_mutex_init(&s->mutex, NULL);
 	
 	fvs_update(s, settings);
 	
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	proc_handler_add(ph, "void scrub_preview(in int time_ms)", proc_scrub_preview, s);
+	proc_handler_add(ph, "void scrub_end()", proc_scrub_end, s);
+	proc_handler_add(ph, "void get_poster(in int index, in ptr thumbnail, out bool found)",
+		proc_get_poster, s);
+	proc_handler_add(ph, "void set_rate(in float rate)", proc_set_rate, s);
+	proc_handler_add(ph, "void set_timeline_paused(in bool paused)", proc_set_timeline_paused, s);
+	
 	/* Register with global tracking for emergency cleanup */
 	fmgnice_register_source(s);
 	
@@ -763,12 +1352,20 @@ static void fvs_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, S_PREBUFFER_MS, 200);
 	obs_data_set_default_int(settings, S_SYNC_MODE, 0); /* Global */
 	obs_data_set_default_int(settings, S_SYNC_OFFSET, 0);
+	obs_data_set_default_int(settings, S_AV_SYNC_MASTER, 0); /* System clock */
+	obs_data_set_default_int(settings, S_EPOCH_SYNC, 0); /* Off */
+	obs_data_set_default_int(settings, S_EPOCH_SYNC_ROLE, 0); /* Leader */
 	obs_data_set_default_int(settings, S_SEEK_MODE, 0); /* Accurate */
 	obs_data_set_default_bool(settings, S_FRAME_DROP, false);
 	obs_data_set_default_int(settings, S_AUDIO_BUFFER_MS, 100);
 	obs_data_set_default_int(settings, S_CACHE_SIZE_MB, 256);
 	obs_data_set_default_int(settings, S_PERFORMANCE_MODE, 1); /* Balanced */
 	obs_data_set_default_int(settings, S_OUTPUT_FORMAT, 0); /* BGRA by default for compatibility */
+	obs_data_set_default_int(settings, S_DECODE_SIZE, 0); /* Native */
+	obs_data_set_default_int(settings, S_DEINTERLACE, 3); /* Edge-directed */
+	obs_data_set_default_int(settings, S_READ_AHEAD, 1); /* Network files */
+	obs_data_set_default_int(settings, S_READ_AHEAD_MB, 16);
+	obs_data_set_default_int(settings, S_WARM_AHEAD_SEC, 5);
 }
 
 static void fvs_save(void *data, obs_data_t *settings)
@@ -866,6 +1463,24 @@ static obs_properties_t *fvs_properties(void *data)
 	
 	obs_properties_add_int_slider(sync_group, S_SYNC_OFFSET, T_SYNC_OFFSET, -5000, 5000, 10);
 	
+	obs_property_t *av_sync_master = obs_properties_add_list(sync_group, S_AV_SYNC_MASTER, T_AV_SYNC_MASTER,
+		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(av_sync_master, "System Clock (Resample audio)", 0);
+	obs_property_list_add_int(av_sync_master, "Audio (Video follows audio)", 1);
+	
+	obs_property_t *epoch_sync = obs_properties_add_list(sync_group, S_EPOCH_SYNC, T_EPOCH_SYNC,
+		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(epoch_sync, "Off (This host only)", 0);
+	obs_property_list_add_int(epoch_sync, "Shared Epoch File", 1);
+	obs_property_list_add_int(epoch_sync, "UDP Beacon", 2);
+	
+	obs_property_t *epoch_sync_role = obs_properties_add_list(sync_group, S_EPOCH_SYNC_ROLE, T_EPOCH_SYNC_ROLE,
+		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(epoch_sync_role, "Leader (Publish this host's timeline)", 0);
+	obs_property_list_add_int(epoch_sync_role, "Follower (Use the leader's timeline)", 1);
+	
+	obs_properties_add_text(sync_group, S_EPOCH_SYNC_ADDRESS, T_EPOCH_SYNC_ADDRESS, OBS_TEXT_DEFAULT);
+	
 	/* Performance Options */
 	obs_properties_t *perf_group = obs_properties_create();
 	obs_properties_add_group(props, "perf_group", "Performance", OBS_GROUP_NORMAL, perf_group);
@@ -886,6 +1501,31 @@ static obs_properties_t *fvs_properties(void *data)
 	obs_property_list_add_int(output_format, "BGRA (Compatible, slower conversion)", 0);
 	obs_property_list_add_int(output_format, "NV12 (Native GPU format, no conversion)", 1);
 	
+	obs_property_t *decode_size = obs_properties_add_list(perf_group, S_DECODE_SIZE, T_DECODE_SIZE,
+		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(decode_size, "Native", 0);
+	obs_property_list_add_int(decode_size, "Auto (Match on-canvas size)", 1);
+	obs_property_list_add_int(decode_size, "1080p", 2);
+	obs_property_list_add_int(decode_size, "720p", 3);
+	obs_property_list_add_int(decode_size, "540p", 4);
+	obs_property_list_add_int(decode_size, "360p", 5);
+	
+	obs_property_t *deinterlace = obs_properties_add_list(perf_group, S_DEINTERLACE, T_DEINTERLACE,
+		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(deinterlace, "Off (Show woven frames)", 0);
+	obs_property_list_add_int(deinterlace, "Blend (Frame rate)", 1);
+	obs_property_list_add_int(deinterlace, "Bob (Field rate, 50/60p)", 2);
+	obs_property_list_add_int(deinterlace, "Edge-directed (Field rate, 50/60p)", 3);
+	
+	obs_property_t *read_ahead = obs_properties_add_list(perf_group, S_READ_AHEAD, T_READ_AHEAD,
+		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(read_ahead, "Off (Memory-map local files)", 0);
+	obs_property_list_add_int(read_ahead, "Network Files", 1);
+	obs_property_list_add_int(read_ahead, "All Files (Slow disks)", 2);
+	
+	obs_properties_add_int(perf_group, S_READ_AHEAD_MB, T_READ_AHEAD_MB, 4, 256, 4);
+	obs_properties_add_int(perf_group, S_WARM_AHEAD_SEC, T_WARM_AHEAD_SEC, 0, 60, 1);
+	
 	obs_properties_add_bool(perf_group, S_FRAME_DROP, T_FRAME_DROP);
 	
 	/* Information text */
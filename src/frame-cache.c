@@ -43,15 +43,17 @@ enum cache_state {
 	CACHE_READY = 2
 };
 
-void frame_cache_init(struct frame_cache *cache, bool enable_converted_cache)
+void frame_cache_init(struct frame_cache *cache, bool enable_converted_cache, uint32_t capacity)
 {
 	if (!cache)
 		return;
 	
 	memset(cache, 0, sizeof(*cache));
+	cache->max_entries = capacity ? capacity : FRAME_CACHE_SIZE;
+	cache->entries = bzalloc(cache->max_entries * sizeof(struct cached_frame));
 	
 	/* Initialize all entries */
-	for (int i = 0; i < FRAME_CACHE_SIZE; i++) {
+	for (int i = 0; i < (int)cache->max_entries; i++) {
 		cache->entries[i].frame = NULL;
 		cache->entries[i].bgra_data = NULL;
 		cache->entries[i].ref_count = 0;
@@ -68,10 +70,9 @@ void frame_cache_init(struct frame_cache *cache, bool enable_converted_cache)
 	
 	cache->enabled = true;
 	cache->cache_converted_frames = enable_converted_cache;
-	cache->max_entries = FRAME_CACHE_SIZE;
 	
-	blog(LOG_INFO, "Frame cache initialized with %d slots, converted cache: %s",
-		FRAME_CACHE_SIZE, enable_converted_cache ? "enabled" : "disabled");
+	blog(LOG_INFO, "Frame cache initialized with %u slots, converted cache: %s",
+		cache->max_entries, enable_converted_cache ? "enabled" : "disabled");
 }
 
 void frame_cache_destroy(struct frame_cache *cache)
@@ -83,7 +84,7 @@ void frame_cache_destroy(struct frame_cache *cache)
 	frame_cache_log_stats(cache);
 	
 	/* Free all cached frames and data */
-	for (int i = 0; i < FRAME_CACHE_SIZE; i++) {
+	for (int i = 0; i < (int)cache->max_entries; i++) {
 		if (cache->entries[i].frame) {
 			av_frame_free(&cache->entries[i].frame);
 		}
@@ -92,6 +93,7 @@ void frame_cache_destroy(struct frame_cache *cache)
 		}
 	}
 	
+	bfree(cache->entries);
 	pthread_mutex_destroy(&cache->lock);
 	memset(cache, 0, sizeof(*cache));
 }
@@ -101,7 +103,7 @@ static int find_lru_entry(struct frame_cache *cache)
 	uint64_t oldest_time = UINT64_MAX;
 	int lru_idx = -1;
 	
-	for (int i = 0; i < FRAME_CACHE_SIZE; i++) {
+	for (int i = 0; i < (int)cache->max_entries; i++) {
 		uint32_t state = atomic_load_32(&cache->entries[i].state);
 		
 		/* Find empty slot first */
@@ -127,7 +129,7 @@ struct cached_frame* frame_cache_get(struct frame_cache *cache, int64_t pts)
 		return NULL;
 	
 	/* Search for frame with matching PTS */
-	for (int i = 0; i < FRAME_CACHE_SIZE; i++) {
+	for (int i = 0; i < (int)cache->max_entries; i++) {
 		if (atomic_load_32(&cache->entries[i].state) == CACHE_READY) {
 			if (cache->entries[i].pts == pts) {
 				/* Found cached frame */
@@ -144,6 +146,17 @@ struct cached_frame* frame_cache_get(struct frame_cache *cache, int64_t pts)
 	return NULL;
 }
 
+AVFrame *frame_cache_ref(struct frame_cache *cache, int64_t pts)
+{
+	struct cached_frame *entry = frame_cache_get(cache, pts);
+	if (!entry)
+		return NULL;
+	
+	AVFrame *frame = entry->frame ? av_frame_clone(entry->frame) : NULL;
+	frame_cache_release(cache, entry);
+	return frame;
+}
+
 bool frame_cache_put(struct frame_cache *cache, AVFrame *frame, int64_t pts,
                      uint8_t *bgra_data, uint32_t *bgra_linesize,
                      uint32_t width, uint32_t height)
@@ -153,8 +166,17 @@ bool frame_cache_put(struct frame_cache *cache, AVFrame *frame, int64_t pts,
 	
 	pthread_mutex_lock(&cache->lock);
 	
-	/* Find slot to use */
-	int slot = find_lru_entry(cache);
+	/* Find slot to use - the same PTS again replaces its entry */
+	int slot = -1;
+	for (int i = 0; i < (int)cache->max_entries; i++) {
+		if (atomic_load_32(&cache->entries[i].state) == CACHE_READY &&
+		    cache->entries[i].pts == pts && cache->entries[i].ref_count == 0) {
+			slot = i;
+			break;
+		}
+	}
+	if (slot < 0)
+		slot = find_lru_entry(cache);
 	if (slot < 0) {
 		pthread_mutex_unlock(&cache->lock);
 		return false;
@@ -216,7 +238,7 @@ void frame_cache_invalidate(struct frame_cache *cache)
 	atomic_increment_32(&cache->current_gen);
 	
 	/* Clear all entries */
-	for (int i = 0; i < FRAME_CACHE_SIZE; i++) {
+	for (int i = 0; i < (int)cache->max_entries; i++) {
 		atomic_store_32(&cache->entries[i].state, CACHE_EMPTY);
 		if (cache->entries[i].frame) {
 			av_frame_free(&cache->entries[i].frame);
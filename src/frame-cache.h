@@ -21,20 +21,20 @@
 #define CACHE_LINE_SIZE 64          /* CPU cache line size */
 #define CACHE_ALIGNED __declspec(align(CACHE_LINE_SIZE))
 
-/* Atomic types */
+/* Atomic types, prefixed so they don't clash with the decoder's */
 #ifdef _MSC_VER
-typedef volatile LONG atomic_uint32_t;
-typedef volatile LONGLONG atomic_uint64_t;
+typedef volatile LONG frame_cache_atomic32_t;
+typedef volatile LONGLONG frame_cache_atomic64_t;
 #else
-typedef _Atomic(uint32_t) atomic_uint32_t;
-typedef _Atomic(uint64_t) atomic_uint64_t;
+typedef _Atomic(uint32_t) frame_cache_atomic32_t;
+typedef _Atomic(uint64_t) frame_cache_atomic64_t;
 #endif
 
 struct cached_frame {
 	AVFrame *frame;              /* Cached decoded frame */
 	int64_t pts;                 /* Presentation timestamp */
 	uint32_t ref_count;          /* Reference count for safe access */
-	atomic_uint32_t state;       /* 0=empty, 1=loading, 2=ready */
+	frame_cache_atomic32_t state; /* 0=empty, 1=loading, 2=ready */
 	
 	/* Pre-converted BGRA data */
 	uint8_t *bgra_data;
@@ -48,18 +48,18 @@ struct cached_frame {
 };
 
 struct frame_cache {
-	/* Cache entries */
-	CACHE_ALIGNED struct cached_frame entries[FRAME_CACHE_SIZE];
+	/* Cache entries, max_entries of them */
+	struct cached_frame *entries;
 	
 	/* Cache management */
-	atomic_uint32_t current_gen;    /* Generation counter for cache invalidation */
+	frame_cache_atomic32_t current_gen; /* Generation counter for cache invalidation */
 	pthread_mutex_t lock;            /* Protects LRU and insertion */
 	
 	/* Statistics */
-	atomic_uint64_t hits;
-	atomic_uint64_t misses;
-	atomic_uint64_t evictions;
-	atomic_uint64_t insertions;
+	frame_cache_atomic64_t hits;
+	frame_cache_atomic64_t misses;
+	frame_cache_atomic64_t evictions;
+	frame_cache_atomic64_t insertions;
 	
 	/* Configuration */
 	bool enabled;
@@ -67,8 +67,8 @@ struct frame_cache {
 	uint32_t max_entries;
 };
 
-/* Initialize frame cache */
-void frame_cache_init(struct frame_cache *cache, bool enable_converted_cache);
+/* Initialize frame cache with room for capacity frames, 0 = FRAME_CACHE_SIZE */
+void frame_cache_init(struct frame_cache *cache, bool enable_converted_cache, uint32_t capacity);
 
 /* Cleanup frame cache */
 void frame_cache_destroy(struct frame_cache *cache);
@@ -76,7 +76,10 @@ void frame_cache_destroy(struct frame_cache *cache);
 /* Lookup frame in cache by PTS */
 struct cached_frame* frame_cache_get(struct frame_cache *cache, int64_t pts);
 
-/* Add frame to cache */
+/* New reference to the cached frame at pts, NULL on a miss */
+AVFrame *frame_cache_ref(struct frame_cache *cache, int64_t pts);
+
+/* Add frame to cache, replacing an entry with the same PTS */
 bool frame_cache_put(struct frame_cache *cache, AVFrame *frame, int64_t pts,
                      uint8_t *bgra_data, uint32_t *bgra_linesize,
                      uint32_t width, uint32_t height);
@@ -0,0 +1,395 @@
+/*
+ * Parallel GOP decoding implementation
+ */
+
+#include "gop-decoder.h"
+#include "stream-cache.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+
+#define blog(level, format, ...) \
+	blog(level, "[GOP Decoder] " format, ##__VA_ARGS__)
+
+struct gop_frame {
+	AVFrame *frame;
+	int64_t bytes;
+	struct gop_frame *next;
+};
+
+struct gop {
+	int64_t start_us;
+	int64_t end_us;
+	struct gop_frame *head;        /* Decoded frames, presentation order */
+	struct gop_frame *tail;
+	bool done;
+};
+
+/* Demuxer and codec of one worker */
+struct gop_worker {
+	AVFormatContext *format_ctx;
+	AVCodecContext *codec_ctx;
+	AVPacket *packet;
+	AVFrame *frame;
+};
+
+struct gop_decoder {
+	char *path;
+	int stream_index;
+	int lowres;
+
+	struct gop *gops;
+	int gop_count;
+	int next_job;                  /* Next GOP a worker picks up, in order */
+	int read_gop;                  /* GOP the consumer is reading */
+	int64_t held_bytes;
+	int64_t max_bytes;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;           /* Frame delivered or taken, GOP done, or stopping */
+	pthread_t *threads;
+	int thread_count;
+	volatile bool stopping;
+	bool failed;
+	bool open_gop;
+};
+
+static int worker_interrupt(void *opaque)
+{
+	struct gop_decoder *gd = opaque;
+	return gd->stopping ? 1 : 0;
+}
+
+static void worker_close(struct gop_worker *w)
+{
+	if (w->codec_ctx)
+		avcodec_free_context(&w->codec_ctx);
+	if (w->format_ctx)
+		avformat_close_input(&w->format_ctx);
+	if (w->frame)
+		av_frame_free(&w->frame);
+	if (w->packet)
+		av_packet_free(&w->packet);
+}
+
+/* Own demuxer and single-threaded codec - the workers are the parallelism */
+static bool worker_open(struct gop_decoder *gd, struct gop_worker *w)
+{
+	w->format_ctx = avformat_alloc_context();
+	if (!w->format_ctx)
+		return false;
+	w->format_ctx->interrupt_callback.callback = worker_interrupt;
+	w->format_ctx->interrupt_callback.opaque = gd;
+
+	if (avformat_open_input(&w->format_ctx, gd->path, stream_cache_get_input_format(gd->path), NULL) < 0)
+		return false;
+	if (!stream_cache_apply(gd->path, w->format_ctx) && avformat_find_stream_info(w->format_ctx, NULL) < 0)
+		return false;
+	if (gd->stream_index >= (int)w->format_ctx->nb_streams)
+		return false;
+
+	AVStream *stream = w->format_ctx->streams[gd->stream_index];
+	if (stream->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
+		return false;
+	const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+	if (!codec)
+		return false;
+
+	w->codec_ctx = avcodec_alloc_context3(codec);
+	if (!w->codec_ctx)
+		return false;
+	avcodec_parameters_to_context(w->codec_ctx, stream->codecpar);
+	w->codec_ctx->thread_count = 1;
+	w->codec_ctx->lowres = gd->lowres;
+	if (avcodec_open2(w->codec_ctx, codec, NULL) < 0)
+		return false;
+
+	w->packet = av_packet_alloc();
+	w->frame = av_frame_alloc();
+	return w->packet && w->frame;
+}
+
+/* Queue a frame of GOP i for the consumer. Waits while too much is held,
+ * unless the consumer is reading this GOP. False when stopping */
+static bool deliver(struct gop_decoder *gd, int i, AVFrame *frame)
+{
+	int64_t bytes = av_image_get_buffer_size(frame->format, frame->width, frame->height, 1);
+	if (bytes < 0)
+		bytes = 0;
+
+	pthread_mutex_lock(&gd->lock);
+	while (!gd->stopping && i != gd->read_gop && gd->held_bytes > 0 &&
+	       gd->held_bytes + bytes > gd->max_bytes)
+		pthread_cond_wait(&gd->cond, &gd->lock);
+
+	if (gd->stopping) {
+		pthread_mutex_unlock(&gd->lock);
+		return false;
+	}
+
+	struct gop_frame *node = bzalloc(sizeof(struct gop_frame));
+	node->frame = av_frame_alloc();
+	if (!node->frame) {
+		bfree(node);
+		pthread_mutex_unlock(&gd->lock);
+		return true;
+	}
+	av_frame_move_ref(node->frame, frame);
+	node->bytes = bytes;
+
+	struct gop *g = &gd->gops[i];
+	if (g->tail)
+		g->tail->next = node;
+	else
+		g->head = node;
+	g->tail = node;
+	gd->held_bytes += bytes;
+
+	pthread_cond_broadcast(&gd->cond);
+	pthread_mutex_unlock(&gd->lock);
+	return true;
+}
+
+/* Decoded frames inside the GOP go to the consumer, others are dropped */
+static bool receive_frames(struct gop_decoder *gd, struct gop_worker *w, int i, AVStream *stream)
+{
+	const struct gop *g = &gd->gops[i];
+
+	while (avcodec_receive_frame(w->codec_ctx, w->frame) >= 0) {
+		int64_t pts_us = w->frame->pts != AV_NOPTS_VALUE ?
+			av_rescale_q(w->frame->pts, stream->time_base, AV_TIME_BASE_Q) : AV_NOPTS_VALUE;
+
+		if (pts_us == AV_NOPTS_VALUE || pts_us < g->start_us || pts_us >= g->end_us) {
+			av_frame_unref(w->frame);
+			continue;
+		}
+		if (!deliver(gd, i, w->frame)) {
+			av_frame_unref(w->frame);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Decode from the keyframe at the GOP's start up to the next GOP's keyframe */
+static void decode_gop(struct gop_decoder *gd, struct gop_worker *w, int i)
+{
+	const struct gop *g = &gd->gops[i];
+	AVStream *stream = w->format_ctx->streams[gd->stream_index];
+	int64_t start = av_rescale_q(g->start_us, AV_TIME_BASE_Q, stream->time_base);
+	int64_t end = av_rescale_q(g->end_us, AV_TIME_BASE_Q, stream->time_base);
+
+	if (av_seek_frame(w->format_ctx, gd->stream_index, start, AVSEEK_FLAG_BACKWARD) < 0) {
+		blog(LOG_WARNING, "Seek to GOP at %lld ms failed", (long long)(g->start_us / 1000));
+		return;
+	}
+	avcodec_flush_buffers(w->codec_ctx);
+
+	int64_t key_pts = AV_NOPTS_VALUE;
+	while (!gd->stopping && av_read_frame(w->format_ctx, w->packet) >= 0) {
+		AVPacket *pkt = w->packet;
+		if (pkt->stream_index != gd->stream_index) {
+			av_packet_unref(pkt);
+			continue;
+		}
+
+		bool key = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+		if (key && pkt->pts != AV_NOPTS_VALUE && pkt->pts >= end) {
+			av_packet_unref(pkt);
+			break;
+		}
+
+		/* Presented before the keyframe it follows - references the previous GOP */
+		if (key) {
+			key_pts = pkt->pts;
+		} else if (key_pts != AV_NOPTS_VALUE && pkt->pts != AV_NOPTS_VALUE && pkt->pts < key_pts) {
+			pthread_mutex_lock(&gd->lock);
+			gd->open_gop = true;
+			pthread_cond_broadcast(&gd->cond);
+			pthread_mutex_unlock(&gd->lock);
+		}
+
+		int ret = avcodec_send_packet(w->codec_ctx, pkt);
+		av_packet_unref(pkt);
+		if (ret < 0 && ret != AVERROR(EAGAIN))
+			continue;
+		if (!receive_frames(gd, w, i, stream))
+			return;
+	}
+
+	/* Frames the codec still holds back for reordering */
+	avcodec_send_packet(w->codec_ctx, NULL);
+	receive_frames(gd, w, i, stream);
+}
+
+static void *gop_worker(void *opaque)
+{
+	struct gop_decoder *gd = opaque;
+	struct gop_worker w = {0};
+
+	os_set_thread_name("fmgnice-gop");
+
+	bool ok = worker_open(gd, &w);
+
+	pthread_mutex_lock(&gd->lock);
+	if (!ok && !gd->stopping) {
+		blog(LOG_WARNING, "Worker failed to open %s", gd->path);
+		gd->failed = true;
+		pthread_cond_broadcast(&gd->cond);
+	}
+
+	while (ok && !gd->stopping && gd->next_job < gd->gop_count) {
+		int i = gd->next_job++;
+		pthread_mutex_unlock(&gd->lock);
+
+		decode_gop(gd, &w, i);
+
+		pthread_mutex_lock(&gd->lock);
+		gd->gops[i].done = true;
+		pthread_cond_broadcast(&gd->cond);
+	}
+	pthread_mutex_unlock(&gd->lock);
+
+	worker_close(&w);
+	return NULL;
+}
+
+struct gop_decoder *gop_decoder_start(const char *path, int stream_index, int lowres,
+	const int64_t *bounds, int gops, int workers, int64_t max_bytes)
+{
+	if (!path || !bounds || gops < 1 || workers < 1)
+		return NULL;
+
+	struct gop_decoder *gd = bzalloc(sizeof(struct gop_decoder));
+	gd->path = bstrdup(path);
+	gd->stream_index = stream_index;
+	gd->lowres = lowres;
+	gd->max_bytes = max_bytes;
+	gd->gop_count = gops;
+	gd->gops = bzalloc(sizeof(struct gop) * gops);
+	for (int i = 0; i < gops; i++) {
+		gd->gops[i].start_us = bounds[i];
+		gd->gops[i].end_us = bounds[i + 1];
+	}
+
+	pthread_mutex_init(&gd->lock, NULL);
+	pthread_cond_init(&gd->cond, NULL);
+
+	if (workers > gops)
+		workers = gops;
+	gd->threads = bzalloc(sizeof(pthread_t) * workers);
+	for (int i = 0; i < workers; i++) {
+		if (pthread_create(&gd->threads[gd->thread_count], NULL, gop_worker, gd) == 0)
+			gd->thread_count++;
+	}
+
+	if (!gd->thread_count) {
+		gop_decoder_destroy(gd);
+		return NULL;
+	}
+
+	blog(LOG_INFO, "Decoding %d GOPs from %lld ms to %lld ms on %d workers", gops,
+		(long long)(bounds[0] / 1000), (long long)(bounds[gops] / 1000), gd->thread_count);
+	return gd;
+}
+
+void gop_decoder_destroy(struct gop_decoder *gd)
+{
+	if (!gd)
+		return;
+
+	pthread_mutex_lock(&gd->lock);
+	gd->stopping = true;
+	pthread_cond_broadcast(&gd->cond);
+	pthread_mutex_unlock(&gd->lock);
+
+	for (int i = 0; i < gd->thread_count; i++)
+		pthread_join(gd->threads[i], NULL);
+
+	for (int i = 0; i < gd->gop_count; i++) {
+		struct gop_frame *node = gd->gops[i].head;
+		while (node) {
+			struct gop_frame *next = node->next;
+			av_frame_free(&node->frame);
+			bfree(node);
+			node = next;
+		}
+	}
+
+	pthread_cond_destroy(&gd->cond);
+	pthread_mutex_destroy(&gd->lock);
+	bfree(gd->threads);
+	bfree(gd->gops);
+	bfree(gd->path);
+	bfree(gd);
+}
+
+int gop_decoder_receive(struct gop_decoder *gd, AVFrame *frame, bool wait)
+{
+	if (!gd || !frame)
+		return -1;
+
+	pthread_mutex_lock(&gd->lock);
+
+	for (;;) {
+		if (gd->failed || gd->open_gop || gd->read_gop >= gd->gop_count) {
+			pthread_mutex_unlock(&gd->lock);
+			return -1;
+		}
+
+		struct gop *g = &gd->gops[gd->read_gop];
+		struct gop_frame *node = g->head;
+		if (node) {
+			g->head = node->next;
+			if (!g->head)
+				g->tail = NULL;
+			gd->held_bytes -= node->bytes;
+
+			/* Room for a worker waiting to deliver */
+			pthread_cond_broadcast(&gd->cond);
+			pthread_mutex_unlock(&gd->lock);
+
+			av_frame_move_ref(frame, node->frame);
+			av_frame_free(&node->frame);
+			bfree(node);
+			return 1;
+		}
+
+		if (g->done) {
+			gd->read_gop++;
+			pthread_cond_broadcast(&gd->cond);
+			continue;
+		}
+
+		if (!wait || gd->stopping) {
+			pthread_mutex_unlock(&gd->lock);
+			return 0;
+		}
+		pthread_cond_wait(&gd->cond, &gd->lock);
+	}
+}
+
+bool gop_decoder_failed(struct gop_decoder *gd)
+{
+	if (!gd)
+		return false;
+
+	pthread_mutex_lock(&gd->lock);
+	bool failed = gd->failed;
+	pthread_mutex_unlock(&gd->lock);
+	return failed;
+}
+
+bool gop_decoder_open_gop(struct gop_decoder *gd)
+{
+	if (!gd)
+		return false;
+
+	pthread_mutex_lock(&gd->lock);
+	bool open_gop = gd->open_gop;
+	pthread_mutex_unlock(&gd->lock);
+	return open_gop;
+}
@@ -0,0 +1,45 @@
+/*
+ * Parallel GOP decoding for catch-up
+ * Closed GOPs decode independently of each other, so a stretch of video can
+ * be split at its keyframes and the pieces decoded at the same time, each
+ * worker with its own demuxer and single-threaded codec. Frames come back
+ * through a reassembly queue in presentation order
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libavcodec/avcodec.h>
+
+#ifdef __cplusplus
+}
+#endif
+
+struct gop_decoder;
+
+/* Decode the GOPs starting at bounds[0..gops-1] (us, stream time), each
+ * ending where the next one starts and the last at bounds[gops]. Decoded
+ * frames held for the consumer are limited to max_bytes, except for the GOP
+ * it is reading. NULL on failure */
+struct gop_decoder *gop_decoder_start(const char *path, int stream_index, int lowres,
+	const int64_t *bounds, int gops, int workers, int64_t max_bytes);
+
+/* Stops the workers, dropping undelivered frames */
+void gop_decoder_destroy(struct gop_decoder *gd);
+
+/* Next frame in presentation order, moved into frame. Without wait only a
+ * frame already decoded is returned. Returns 1 with a frame, 0 if none is
+ * ready, -1 once every GOP has been delivered or decoding failed */
+int gop_decoder_receive(struct gop_decoder *gd, AVFrame *frame, bool wait);
+
+/* The stretch couldn't be decoded as independent GOPs: a worker failed to
+ * open the file, or a GOP has leading pictures referencing the one before
+ * it (open GOP), so frames at the boundaries are missing */
+bool gop_decoder_failed(struct gop_decoder *gd);
+bool gop_decoder_open_gop(struct gop_decoder *gd);
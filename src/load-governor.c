@@ -0,0 +1,221 @@
+/*
+ * Machine-wide load governor implementation
+ */
+
+#include "load-governor.h"
+#include "cpu-affinity.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define blog(level, format, ...) \
+	blog(level, "[Load Governor] " format, ##__VA_ARGS__)
+
+/* Fraction of total core time sources may use before budgets kick in */
+#define GOVERNOR_TARGET_UTILIZATION 0.75
+/* Budgets are only relaxed once estimated load is below this fraction of capacity */
+#define GOVERNOR_RELAX_UTILIZATION 0.60
+#define GOVERNOR_INTERVAL_NS 2000000000ULL
+
+/* Budget tiers, from no restriction to maximum shedding */
+struct governor_tier {
+	int floor_level;
+	int frame_decimation;
+	int scale_divisor;
+	double cost;          /* Estimated fraction of unrestricted CPU cost */
+};
+
+static const struct governor_tier tiers[] = {
+	{ DECODE_LEVEL_FULL,  1, 1, 1.00 },
+	{ DECODE_LEVEL_HEAVY, 1, 1, 0.80 },
+	{ DECODE_LEVEL_MAX,   1, 2, 0.50 },
+	{ DECODE_LEVEL_MAX,   2, 2, 0.25 },
+	{ DECODE_LEVEL_MAX,   3, 4, 0.10 },
+};
+#define TIER_COUNT ((int)(sizeof(tiers) / sizeof(tiers[0])))
+
+/* Program sources never have frames dropped by the governor */
+#define PROGRAM_MAX_TIER 2
+
+struct load_governor_entry {
+	const perf_monitor_t *monitor;
+	struct decode_policy *policy;
+	enum load_priority priority;
+	int tier;              /* Budget tier currently applied */
+	double base_demand;    /* Estimated unrestricted core-seconds per second */
+	int target_tier;       /* Scratch for rebalance */
+	int shed_tier;         /* Tier needed to fit under capacity */
+};
+
+static pthread_mutex_t g_governor_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct load_governor_entry*) g_entries = {0};
+static uint64_t g_last_rebalance = 0;
+
+struct load_governor_entry *load_governor_register(const perf_monitor_t *monitor,
+	struct decode_policy *policy)
+{
+	if (!monitor || !policy)
+		return NULL;
+
+	struct load_governor_entry *entry = bzalloc(sizeof(struct load_governor_entry));
+	entry->monitor = monitor;
+	entry->policy = policy;
+	entry->priority = LOAD_PRIORITY_HIDDEN;
+
+	pthread_mutex_lock(&g_governor_mutex);
+	da_push_back(g_entries, &entry);
+	pthread_mutex_unlock(&g_governor_mutex);
+
+	return entry;
+}
+
+void load_governor_unregister(struct load_governor_entry *entry)
+{
+	if (!entry)
+		return;
+
+	pthread_mutex_lock(&g_governor_mutex);
+	for (size_t i = 0; i < g_entries.num; i++) {
+		if (g_entries.array[i] == entry) {
+			da_erase(g_entries, i);
+			break;
+		}
+	}
+	if (g_entries.num == 0) {
+		da_free(g_entries);
+	}
+	pthread_mutex_unlock(&g_governor_mutex);
+
+	bfree(entry);
+}
+
+void load_governor_set_priority(struct load_governor_entry *entry, enum load_priority priority)
+{
+	if (!entry)
+		return;
+
+	pthread_mutex_lock(&g_governor_mutex);
+	entry->priority = priority;
+	pthread_mutex_unlock(&g_governor_mutex);
+}
+
+/* Core-seconds per second this source currently costs. Frames removed by
+ * decimation never reach the monitor's frame timing. */
+static double measured_demand(const struct load_governor_entry *e)
+{
+	const perf_monitor_t *monitor = e->monitor;
+	if (!monitor->avg_render_time || monitor->fps <= 0.0)
+		return 0.0;
+	return (double)monitor->avg_render_time / 1000000000.0 * monitor->fps /
+		tiers[e->tier].frame_decimation;
+}
+
+static double estimated_total(void)
+{
+	double total = 0.0;
+	for (size_t i = 0; i < g_entries.num; i++) {
+		struct load_governor_entry *e = g_entries.array[i];
+		if (e->priority != LOAD_PRIORITY_HIDDEN)
+			total += e->base_demand * tiers[e->target_tier].cost;
+	}
+	return total;
+}
+
+/* Shed from the lowest priority class upward until the estimate fits.
+ * Leaves the chosen tier in each entry's target_tier. */
+static void assign_tiers(double capacity)
+{
+	for (size_t i = 0; i < g_entries.num; i++)
+		g_entries.array[i]->target_tier = 0;
+
+	for (int priority = LOAD_PRIORITY_PREVIEW; priority >= LOAD_PRIORITY_PROGRAM; priority--) {
+		int max_tier = priority == LOAD_PRIORITY_PROGRAM ? PROGRAM_MAX_TIER : TIER_COUNT - 1;
+
+		for (int tier = 1; tier <= max_tier; tier++) {
+			if (estimated_total() <= capacity)
+				return;
+
+			for (size_t i = 0; i < g_entries.num; i++) {
+				struct load_governor_entry *e = g_entries.array[i];
+				if ((int)e->priority == priority)
+					e->target_tier = tier;
+			}
+		}
+	}
+}
+
+static void rebalance(void)
+{
+	int cores = get_cpu_count();
+	if (cores < 1) cores = 1;
+	double capacity = cores * GOVERNOR_TARGET_UTILIZATION;
+	double relax_capacity = cores * GOVERNOR_RELAX_UTILIZATION;
+
+	/* Normalize measured load back to unrestricted cost */
+	double measured_total = 0.0;
+	for (size_t i = 0; i < g_entries.num; i++) {
+		struct load_governor_entry *e = g_entries.array[i];
+		double demand = measured_demand(e);
+		e->base_demand = demand / tiers[e->tier].cost;
+		if (e->priority != LOAD_PRIORITY_HIDDEN)
+			measured_total += demand;
+	}
+
+	/* Shed immediately when over capacity */
+	assign_tiers(capacity);
+	for (size_t i = 0; i < g_entries.num; i++)
+		g_entries.array[i]->shed_tier = g_entries.array[i]->target_tier;
+
+	/* Relax one step at a time, and only with headroom to spare */
+	assign_tiers(relax_capacity);
+
+	int shed_count = 0;
+	bool changed = false;
+	for (size_t i = 0; i < g_entries.num; i++) {
+		struct load_governor_entry *e = g_entries.array[i];
+		int new_tier = e->tier;
+
+		if (e->priority == LOAD_PRIORITY_HIDDEN)
+			new_tier = 0;
+		else if (e->shed_tier > e->tier)
+			new_tier = e->shed_tier;
+		else if (e->target_tier < e->tier)
+			new_tier = e->tier - 1;
+
+		if (new_tier != e->tier) {
+			struct decode_policy_budget budget = {
+				.floor_level = tiers[new_tier].floor_level,
+				.frame_decimation = tiers[new_tier].frame_decimation,
+				.scale_divisor = tiers[new_tier].scale_divisor,
+			};
+			decode_policy_set_budget(e->policy, &budget);
+			e->tier = new_tier;
+			changed = true;
+		}
+		if (e->tier > 0)
+			shed_count++;
+	}
+
+	if (changed) {
+		blog(LOG_INFO, "Load %.2f of %d cores (capacity %.2f), %d of %zu sources on reduced budget",
+			measured_total, cores, capacity, shed_count, g_entries.num);
+	}
+}
+
+void load_governor_tick(void)
+{
+	uint64_t now = os_gettime_ns();
+
+	/* Sources tick on the same thread, but don't rely on it */
+	if (pthread_mutex_trylock(&g_governor_mutex) != 0)
+		return;
+
+	if (now - g_last_rebalance >= GOVERNOR_INTERVAL_NS) {
+		g_last_rebalance = now;
+		rebalance();
+	}
+
+	pthread_mutex_unlock(&g_governor_mutex);
+}
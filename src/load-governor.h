@@ -0,0 +1,35 @@
+/*
+ * Machine-wide load governor
+ * Tracks aggregate decode load of all fmgNICE sources against the host's
+ * core count and hands out per-source budgets by priority, so one heavy
+ * source doesn't make every source degrade at once
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "decode-policy.h"
+#include "performance-monitor.h"
+
+/* Source priority - lower value is served first */
+enum load_priority {
+	LOAD_PRIORITY_PROGRAM = 0,  /* Visible on program output */
+	LOAD_PRIORITY_PREVIEW = 1,  /* Only showing in preview/projectors */
+	LOAD_PRIORITY_HIDDEN = 2    /* Not shown, excluded from load accounting */
+};
+
+struct load_governor_entry;
+
+/* Register a decoder's monitor and policy. Returns NULL on failure */
+struct load_governor_entry *load_governor_register(const perf_monitor_t *monitor,
+	struct decode_policy *policy);
+
+/* Unregister before the monitor/policy are freed */
+void load_governor_unregister(struct load_governor_entry *entry);
+
+/* Update an entry's priority (called from the source tick) */
+void load_governor_set_priority(struct load_governor_entry *entry, enum load_priority priority);
+
+/* Rebalance budgets if due. Cheap to call every tick from any source */
+void load_governor_tick(void);
@@ -0,0 +1,308 @@
+/*
+ * Memory-mapped AVIOContext implementation
+ */
+
+#include "mmap-io.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavutil/mem.h>
+#include <libavutil/error.h>
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define blog(level, format, ...) \
+	blog(level, "[Mmap IO] " format, ##__VA_ARGS__)
+
+/* Smaller files gain nothing over the file protocol */
+#define MMAP_IO_MIN_SIZE (4LL * 1024 * 1024)
+/* AVIO buffer for probing and small reads. Reads larger than this (most
+ * video packets) are copied from the mapping straight into the packet */
+#define MMAP_IO_BUFFER_SIZE (64 * 1024)
+/* Range kept prefetched ahead of the read position, refreshed at half */
+#define MMAP_IO_READAHEAD (16LL * 1024 * 1024)
+
+struct mmap_io {
+	const uint8_t *data;
+	int64_t size;
+	int64_t pos;
+	int64_t advised_start;
+	int64_t advised_end;
+	int64_t page_size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
+
+#ifdef _WIN32
+/* PrefetchVirtualMemory is Windows 8+, looked up so older SDK targets link */
+typedef BOOL (WINAPI *prefetch_virtual_memory_t)(HANDLE, ULONG_PTR, PVOID, ULONG);
+
+struct prefetch_range {
+	PVOID address;
+	SIZE_T size;
+};
+
+static prefetch_virtual_memory_t get_prefetch_virtual_memory(void)
+{
+	static prefetch_virtual_memory_t func = NULL;
+	static bool resolved = false;
+
+	if (!resolved) {
+		HMODULE kernel32 = GetModuleHandleW(L"kernel32.dll");
+		if (kernel32)
+			func = (prefetch_virtual_memory_t)GetProcAddress(kernel32, "PrefetchVirtualMemory");
+		resolved = true;
+	}
+	return func;
+}
+#endif
+
+static void advise_range(struct mmap_io *io, int64_t start, int64_t end)
+{
+	start &= ~(io->page_size - 1);
+	if (end > io->size)
+		end = io->size;
+	if (end <= start)
+		return;
+
+#ifdef _WIN32
+	prefetch_virtual_memory_t prefetch = get_prefetch_virtual_memory();
+	if (prefetch) {
+		struct prefetch_range range = {(PVOID)(io->data + start), (SIZE_T)(end - start)};
+		prefetch(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	madvise((void *)(io->data + start), (size_t)(end - start), MADV_WILLNEED);
+#endif
+}
+
+/* Keep the pages ahead of the read position on their way in, so the decode
+ * thread doesn't stall on page faults */
+static inline void advise_ahead(struct mmap_io *io)
+{
+	if (io->pos >= io->advised_start && io->pos + MMAP_IO_READAHEAD / 2 < io->advised_end)
+		return;
+
+	int64_t from = io->pos >= io->advised_start && io->pos < io->advised_end ?
+		io->advised_end : io->pos;
+	io->advised_start = io->pos;
+	io->advised_end = io->pos + MMAP_IO_READAHEAD;
+	advise_range(io, from, io->advised_end);
+}
+
+/* A page that can't be read in (I/O error, file truncated underneath us)
+ * raises EXCEPTION_IN_PAGE_ERROR on Windows, turned into a read error here */
+static inline bool copy_from_mapping(uint8_t *dst, const uint8_t *src, size_t len)
+{
+#ifdef _MSC_VER
+	__try {
+		memcpy(dst, src, len);
+	} __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER :
+	                                                          EXCEPTION_CONTINUE_SEARCH) {
+		return false;
+	}
+#else
+	memcpy(dst, src, len);
+#endif
+	return true;
+}
+
+static int mmap_io_read(void *opaque, uint8_t *buf, int buf_size)
+{
+	struct mmap_io *io = opaque;
+	int64_t left = io->size - io->pos;
+
+	if (left <= 0)
+		return AVERROR_EOF;
+
+	int len = left < buf_size ? (int)left : buf_size;
+	advise_ahead(io);
+	if (!copy_from_mapping(buf, io->data + io->pos, len)) {
+		blog(LOG_WARNING, "Page fault reading at %lld", (long long)io->pos);
+		return AVERROR(EIO);
+	}
+	io->pos += len;
+	return len;
+}
+
+static int64_t mmap_io_seek(void *opaque, int64_t offset, int whence)
+{
+	struct mmap_io *io = opaque;
+	int64_t pos;
+
+	switch (whence & ~AVSEEK_FORCE) {
+	case AVSEEK_SIZE:
+		return io->size;
+	case SEEK_SET:
+		pos = offset;
+		break;
+	case SEEK_CUR:
+		pos = io->pos + offset;
+		break;
+	case SEEK_END:
+		pos = io->size + offset;
+		break;
+	default:
+		return AVERROR(EINVAL);
+	}
+
+	if (pos < 0 || pos > io->size)
+		return AVERROR(EINVAL);
+
+	io->pos = pos;
+	return pos;
+}
+
+static void unmap_file(struct mmap_io *io)
+{
+#ifdef _WIN32
+	if (io->data)
+		UnmapViewOfFile(io->data);
+	if (io->mapping)
+		CloseHandle(io->mapping);
+	if (io->file && io->file != INVALID_HANDLE_VALUE)
+		CloseHandle(io->file);
+#else
+	if (io->data)
+		munmap((void *)io->data, (size_t)io->size);
+#endif
+	bfree(io);
+}
+
+static struct mmap_io *map_file(const char *path)
+{
+	struct mmap_io *io = bzalloc(sizeof(struct mmap_io));
+
+#ifdef _WIN32
+	wchar_t *wpath = NULL;
+	if (os_utf8_to_wcs_ptr(path, 0, &wpath) == 0) {
+		bfree(io);
+		return NULL;
+	}
+
+	/* Network and removable volumes can vanish under the mapping */
+	wchar_t volume[MAX_PATH];
+	if (!GetVolumePathNameW(wpath, volume, MAX_PATH) || GetDriveTypeW(volume) != DRIVE_FIXED) {
+		bfree(wpath);
+		bfree(io);
+		return NULL;
+	}
+
+	io->file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	bfree(wpath);
+	if (io->file == INVALID_HANDLE_VALUE) {
+		bfree(io);
+		return NULL;
+	}
+
+	LARGE_INTEGER size;
+	if (GetFileType(io->file) != FILE_TYPE_DISK || !GetFileSizeEx(io->file, &size) ||
+	    size.QuadPart < MMAP_IO_MIN_SIZE || (uint64_t)size.QuadPart > (uint64_t)SIZE_MAX) {
+		unmap_file(io);
+		return NULL;
+	}
+	io->size = size.QuadPart;
+
+	io->mapping = CreateFileMappingW(io->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (io->mapping)
+		io->data = MapViewOfFile(io->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!io->data) {
+		blog(LOG_DEBUG, "Failed to map %s: %lu", path, GetLastError());
+		unmap_file(io);
+		return NULL;
+	}
+
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	io->page_size = info.dwPageSize;
+#else
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		bfree(io);
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size < MMAP_IO_MIN_SIZE ||
+	    (uint64_t)st.st_size > (uint64_t)SIZE_MAX) {
+		close(fd);
+		bfree(io);
+		return NULL;
+	}
+	io->size = st.st_size;
+
+	/* The mapping keeps its own reference to the file */
+	void *mem = mmap(NULL, (size_t)io->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) {
+		blog(LOG_DEBUG, "Failed to map %s: %d", path, errno);
+		bfree(io);
+		return NULL;
+	}
+	io->data = mem;
+	madvise(mem, (size_t)io->size, MADV_SEQUENTIAL);
+
+	long page_size = sysconf(_SC_PAGESIZE);
+	io->page_size = page_size > 0 ? page_size : 4096;
+#endif
+
+	return io;
+}
+
+AVIOContext *mmap_io_open(const char *path)
+{
+	if (!path || !*path || strstr(path, "://"))
+		return NULL;
+
+	struct mmap_io *io = map_file(path);
+	if (!io)
+		return NULL;
+
+	unsigned char *buffer = av_malloc(MMAP_IO_BUFFER_SIZE);
+	AVIOContext *pb = buffer ? avio_alloc_context(buffer, MMAP_IO_BUFFER_SIZE, 0, io,
+		mmap_io_read, NULL, mmap_io_seek) : NULL;
+	if (!pb) {
+		av_free(buffer);
+		unmap_file(io);
+		return NULL;
+	}
+
+	/* Start the header and first packets loading */
+	advise_ahead(io);
+
+	blog(LOG_INFO, "Mapped %lld MB for reading", (long long)(io->size / (1024 * 1024)));
+	return pb;
+}
+
+void mmap_io_close(AVIOContext **pb)
+{
+	if (!pb || !*pb)
+		return;
+
+	struct mmap_io *io = (*pb)->opaque;
+
+	/* The buffer may have been reallocated by FFmpeg, free the current one */
+	av_freep(&(*pb)->buffer);
+	avio_context_free(pb);
+	if (io)
+		unmap_file(io);
+}
@@ -0,0 +1,28 @@
+/*
+ * Memory-mapped AVIOContext for local media files
+ * The demuxer reads straight out of a read-only mapping of the file, with
+ * sequential/read-ahead hints, instead of going through read() calls on
+ * FFmpeg's file protocol
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libavformat/avio.h>
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Map a local file and wrap it in a seekable AVIOContext. Returns NULL for
+ * URLs, small or non-regular files, or if mapping fails - the caller then
+ * lets FFmpeg open the path itself */
+AVIOContext *mmap_io_open(const char *path);
+
+/* Free the context, its buffer and the mapping. Sets *pb to NULL */
+void mmap_io_close(AVIOContext **pb);
@@ -0,0 +1,343 @@
+/*
+ * Memory-bounded packet queue implementation
+ */
+
+#include "packet-queue.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/threading.h>
+#include <time.h>
+
+/* Spare entries kept for reuse, beyond this they are freed */
+#define PACKET_QUEUE_FREELIST_MAX 256
+
+struct packet_entry {
+	AVPacket *pkt;
+	enum packet_queue_stream stream;
+	int64_t duration_us;
+	uint32_t generation;
+	struct packet_entry *next;
+};
+
+struct packet_queue {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;       /* Packet added, room freed, or aborted */
+	struct packet_entry *head;
+	struct packet_entry *tail;
+	struct packet_entry *free_list;
+	int free_count;
+	bool aborted;
+	uint32_t generation;       /* Oldest generation still accepted */
+
+	struct packet_queue_limits limits[PACKET_QUEUE_STREAMS];
+	int packets[PACKET_QUEUE_STREAMS];
+	int64_t bytes[PACKET_QUEUE_STREAMS];
+	int64_t duration_us[PACKET_QUEUE_STREAMS];
+
+	/* Statistics */
+	int64_t peak_bytes[PACKET_QUEUE_STREAMS];
+	uint64_t full_waits;
+	uint64_t underruns;
+	uint64_t dropped;
+};
+
+/* Generations wrap, compare by distance */
+static inline bool generation_before(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+static inline float limit_fill(int64_t value, int64_t limit)
+{
+	return limit > 0 ? (float)value / (float)limit : 0.0f;
+}
+
+static float stream_fill(const struct packet_queue *q, int s)
+{
+	const struct packet_queue_limits *l = &q->limits[s];
+	float fill = limit_fill(q->bytes[s], l->max_bytes);
+	float dur = limit_fill(q->duration_us[s], l->max_duration_us);
+	float count = limit_fill(q->packets[s], l->max_packets);
+	if (dur > fill)
+		fill = dur;
+	if (count > fill)
+		fill = count;
+	return fill;
+}
+
+static inline bool stream_full(const struct packet_queue *q, int s)
+{
+	return q->packets[s] > 0 && stream_fill(q, s) >= 1.0f;
+}
+
+/* Entry from the freelist, or a new one */
+static struct packet_entry *alloc_entry(struct packet_queue *q)
+{
+	struct packet_entry *e = q->free_list;
+	if (e) {
+		q->free_list = e->next;
+		q->free_count--;
+		return e;
+	}
+
+	e = bzalloc(sizeof(struct packet_entry));
+	e->pkt = av_packet_alloc();
+	if (!e->pkt) {
+		bfree(e);
+		return NULL;
+	}
+	return e;
+}
+
+/* Back to the freelist, the packet must already be blank */
+static void free_entry(struct packet_queue *q, struct packet_entry *e)
+{
+	if (q->free_count >= PACKET_QUEUE_FREELIST_MAX) {
+		av_packet_free(&e->pkt);
+		bfree(e);
+		return;
+	}
+	e->next = q->free_list;
+	q->free_list = e;
+	q->free_count++;
+}
+
+static void account(struct packet_queue *q, const struct packet_entry *e, int sign)
+{
+	q->packets[e->stream] += sign;
+	q->bytes[e->stream] += sign * (int64_t)e->pkt->size;
+	q->duration_us[e->stream] += sign * e->duration_us;
+}
+
+/* Drop queued packets matching the filter. Called with the lock held */
+static void drop_entries(struct packet_queue *q, bool all, uint32_t keep_generation)
+{
+	struct packet_entry **link = &q->head;
+	q->tail = NULL;
+
+	while (*link) {
+		struct packet_entry *e = *link;
+		if (all || e->generation != keep_generation) {
+			*link = e->next;
+			account(q, e, -1);
+			av_packet_unref(e->pkt);
+			free_entry(q, e);
+			q->dropped++;
+		} else {
+			q->tail = e;
+			link = &e->next;
+		}
+	}
+
+	pthread_cond_broadcast(&q->cond);
+}
+
+struct packet_queue *packet_queue_create(const struct packet_queue_limits *video,
+	const struct packet_queue_limits *audio)
+{
+	struct packet_queue *q = bzalloc(sizeof(struct packet_queue));
+
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_cond_init(&q->cond, NULL);
+	if (video)
+		q->limits[PACKET_QUEUE_VIDEO] = *video;
+	if (audio)
+		q->limits[PACKET_QUEUE_AUDIO] = *audio;
+
+	return q;
+}
+
+void packet_queue_destroy(struct packet_queue *q)
+{
+	if (!q)
+		return;
+
+	packet_queue_clear(q);
+
+	while (q->free_list) {
+		struct packet_entry *e = q->free_list;
+		q->free_list = e->next;
+		av_packet_free(&e->pkt);
+		bfree(e);
+	}
+
+	pthread_cond_destroy(&q->cond);
+	pthread_mutex_destroy(&q->lock);
+	bfree(q);
+}
+
+bool packet_queue_put(struct packet_queue *q, AVPacket *pkt, enum packet_queue_stream stream,
+	int64_t duration_us, uint32_t generation)
+{
+	if (!q || !pkt || stream < 0 || stream >= PACKET_QUEUE_STREAMS)
+		return false;
+
+	pthread_mutex_lock(&q->lock);
+
+	if (stream_full(q, stream) && !q->aborted)
+		q->full_waits++;
+	while (stream_full(q, stream) && !q->aborted && !generation_before(generation, q->generation))
+		pthread_cond_wait(&q->cond, &q->lock);
+
+	if (q->aborted) {
+		pthread_mutex_unlock(&q->lock);
+		av_packet_unref(pkt);
+		return false;
+	}
+
+	/* Demuxed before a seek the consumer has already moved past */
+	if (generation_before(generation, q->generation)) {
+		q->dropped++;
+		pthread_mutex_unlock(&q->lock);
+		av_packet_unref(pkt);
+		return true;
+	}
+
+	struct packet_entry *e = alloc_entry(q);
+	if (!e) {
+		pthread_mutex_unlock(&q->lock);
+		av_packet_unref(pkt);
+		return true;
+	}
+
+	av_packet_move_ref(e->pkt, pkt);
+	e->stream = stream;
+	e->duration_us = duration_us > 0 ? duration_us : 0;
+	e->generation = generation;
+	e->next = NULL;
+
+	if (q->tail)
+		q->tail->next = e;
+	else
+		q->head = e;
+	q->tail = e;
+
+	account(q, e, 1);
+	if (q->bytes[stream] > q->peak_bytes[stream])
+		q->peak_bytes[stream] = q->bytes[stream];
+
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+	return true;
+}
+
+int packet_queue_get(struct packet_queue *q, AVPacket *pkt, uint32_t *generation, int timeout_ms)
+{
+	if (!q || !pkt)
+		return -1;
+
+	pthread_mutex_lock(&q->lock);
+
+	if (!q->head && !q->aborted) {
+		q->underruns++;
+
+		if (timeout_ms > 0) {
+			struct timespec ts;
+			timespec_get(&ts, TIME_UTC);
+			ts.tv_sec += timeout_ms / 1000;
+			ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+			if (ts.tv_nsec >= 1000000000L) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000L;
+			}
+
+			while (!q->head && !q->aborted) {
+				if (pthread_cond_timedwait(&q->cond, &q->lock, &ts) != 0)
+					break;
+			}
+		}
+	}
+
+	if (q->aborted) {
+		pthread_mutex_unlock(&q->lock);
+		return -1;
+	}
+
+	struct packet_entry *e = q->head;
+	if (!e) {
+		pthread_mutex_unlock(&q->lock);
+		return 0;
+	}
+
+	q->head = e->next;
+	if (!q->head)
+		q->tail = NULL;
+	account(q, e, -1);
+
+	av_packet_move_ref(pkt, e->pkt);
+	if (generation)
+		*generation = e->generation;
+	free_entry(q, e);
+
+	/* Room for a waiting put */
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+	return 1;
+}
+
+void packet_queue_flush(struct packet_queue *q, uint32_t generation)
+{
+	if (!q)
+		return;
+
+	pthread_mutex_lock(&q->lock);
+	q->generation = generation;
+	drop_entries(q, false, generation);
+	pthread_mutex_unlock(&q->lock);
+}
+
+void packet_queue_clear(struct packet_queue *q)
+{
+	if (!q)
+		return;
+
+	pthread_mutex_lock(&q->lock);
+	drop_entries(q, true, 0);
+	pthread_mutex_unlock(&q->lock);
+}
+
+void packet_queue_abort(struct packet_queue *q)
+{
+	if (!q)
+		return;
+
+	pthread_mutex_lock(&q->lock);
+	q->aborted = true;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+}
+
+void packet_queue_start(struct packet_queue *q)
+{
+	if (!q)
+		return;
+
+	pthread_mutex_lock(&q->lock);
+	q->aborted = false;
+	pthread_mutex_unlock(&q->lock);
+}
+
+void packet_queue_get_stats(struct packet_queue *q, struct packet_queue_stats *stats)
+{
+	if (!q || !stats)
+		return;
+
+	pthread_mutex_lock(&q->lock);
+
+	stats->fill = 0.0f;
+	for (int s = 0; s < PACKET_QUEUE_STREAMS; s++) {
+		stats->packets[s] = q->packets[s];
+		stats->bytes[s] = q->bytes[s];
+		stats->duration_us[s] = q->duration_us[s];
+		stats->peak_bytes[s] = q->peak_bytes[s];
+
+		float fill = stream_fill(q, s);
+		if (fill > stats->fill)
+			stats->fill = fill > 1.0f ? 1.0f : fill;
+	}
+	stats->full_waits = q->full_waits;
+	stats->underruns = q->underruns;
+	stats->dropped = q->dropped;
+
+	pthread_mutex_unlock(&q->lock);
+}
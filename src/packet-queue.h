@@ -0,0 +1,75 @@
+/*
+ * Memory-bounded packet queue between the demuxer and decoder threads
+ * Limits are per stream type and count bytes and duration as well as
+ * packets, so high-bitrate intra-only material (ProRes, DNxHR) can't queue
+ * gigabytes. Packets are moved in and out without copies, and the AVPacket
+ * shells are recycled through a freelist
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libavcodec/avcodec.h>
+
+#ifdef __cplusplus
+}
+#endif
+
+enum packet_queue_stream {
+	PACKET_QUEUE_VIDEO = 0,
+	PACKET_QUEUE_AUDIO = 1,
+	PACKET_QUEUE_STREAMS
+};
+
+/* 0 = no limit. One packet is always accepted, however large */
+struct packet_queue_limits {
+	int64_t max_bytes;
+	int64_t max_duration_us;
+	int max_packets;
+};
+
+struct packet_queue_stats {
+	int packets[PACKET_QUEUE_STREAMS];
+	int64_t bytes[PACKET_QUEUE_STREAMS];
+	int64_t duration_us[PACKET_QUEUE_STREAMS];
+	int64_t peak_bytes[PACKET_QUEUE_STREAMS];
+	float fill;            /* Fraction of the nearest limit in use, 0-1 */
+	uint64_t full_waits;   /* Puts that had to wait for room */
+	uint64_t underruns;    /* Gets that found the queue empty */
+	uint64_t dropped;      /* Packets flushed or put with a stale generation */
+};
+
+struct packet_queue;
+
+struct packet_queue *packet_queue_create(const struct packet_queue_limits *video,
+	const struct packet_queue_limits *audio);
+void packet_queue_destroy(struct packet_queue *q);
+
+/* Move pkt into the queue (pkt is left blank), tagged with the generation it
+ * was demuxed in. Waits while the stream is at its limits. Packets of a
+ * generation older than the last flush are dropped. False if aborted */
+bool packet_queue_put(struct packet_queue *q, AVPacket *pkt, enum packet_queue_stream stream,
+	int64_t duration_us, uint32_t generation);
+
+/* Move the oldest packet into pkt, waiting up to timeout_ms for one.
+ * Returns 1 with a packet, 0 on timeout, -1 if aborted */
+int packet_queue_get(struct packet_queue *q, AVPacket *pkt, uint32_t *generation, int timeout_ms);
+
+/* Drop every packet not of this generation (a seek boundary). Packets of
+ * older generations put later are dropped too */
+void packet_queue_flush(struct packet_queue *q, uint32_t generation);
+
+/* Drop everything, whatever the generation */
+void packet_queue_clear(struct packet_queue *q);
+
+/* Fail all waiting and future puts and gets until packet_queue_start */
+void packet_queue_abort(struct packet_queue *q);
+void packet_queue_start(struct packet_queue *q);
+
+void packet_queue_get_stats(struct packet_queue *q, struct packet_queue_stats *stats);
@@ -0,0 +1,329 @@
+/*
+ * Predictive page-cache warming implementation
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE  /* readahead() */
+#endif
+
+#include "page-warmer.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <libavformat/avformat.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define blog(level, format, ...) \
+	blog(level, "[Page Warmer] " format, ##__VA_ARGS__)
+
+#define WARM_MIN_BYTES (2LL * 1024 * 1024)
+#define WARM_MAX_BYTES (64LL * 1024 * 1024)
+#define WARM_TAIL_BYTES (1024 * 1024)
+/* Older requests are dropped beyond this, the newest are the ones that matter */
+#define WARM_QUEUE_MAX 4
+#define WARM_READ_BLOCK (1024 * 1024)
+
+struct warm_request {
+	char *path;
+	int64_t time_us;       /* AV_NOPTS_VALUE = head of the file */
+	int64_t duration_us;
+	int64_t span_us;
+};
+
+struct page_warmer {
+	pthread_mutex_t lock;          /* Protects the queue */
+	pthread_cond_t cond;
+	DARRAY(struct warm_request) queue;
+	pthread_t thread;
+	bool thread_active;
+	volatile bool stopping;
+
+	/* Header-only demuxer for keyframe index lookups, worker thread only */
+	char *index_path;
+	AVFormatContext *index_ctx;
+	int index_stream;
+
+	/* Statistics */
+	uint64_t requests;
+	uint64_t bytes;
+	uint64_t index_hits;
+};
+
+/* ------------------------------------------------------------------------- */
+/* Page cache population */
+
+#ifdef _WIN32
+/* No advisory call for files on Windows - reading the range through the
+ * cache manager leaves it on the standby list */
+static bool warm_range(struct page_warmer *pw, const char *path, int64_t offset, int64_t length)
+{
+	wchar_t *wpath = NULL;
+	if (os_utf8_to_wcs_ptr(path, 0, &wpath) == 0)
+		return false;
+
+	HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	bfree(wpath);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	uint8_t *block = bmalloc(WARM_READ_BLOCK);
+	int64_t end = offset + length;
+
+	for (int64_t pos = offset; pos < end && !pw->stopping; pos += WARM_READ_BLOCK) {
+		OVERLAPPED ov = {0};
+		ov.Offset = (DWORD)pos;
+		ov.OffsetHigh = (DWORD)(pos >> 32);
+		DWORD size = (DWORD)(end - pos < WARM_READ_BLOCK ? end - pos : WARM_READ_BLOCK);
+		DWORD got = 0;
+		if (!ReadFile(file, block, size, &got, &ov) || got == 0)
+			break;
+	}
+
+	bfree(block);
+	CloseHandle(file);
+	return true;
+}
+#else
+static bool warm_range(struct page_warmer *pw, const char *path, int64_t offset, int64_t length)
+{
+	UNUSED_PARAMETER(pw);
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	bool ok = false;
+#if defined(__linux__)
+	/* Fills the page cache from here; not every filesystem supports it */
+	ok = readahead(fd, (off64_t)offset, (size_t)length) == 0;
+	if (!ok)
+		ok = posix_fadvise(fd, (off_t)offset, (off_t)length, POSIX_FADV_WILLNEED) == 0;
+#elif defined(__APPLE__)
+	struct radvisory ra = {.ra_offset = (off_t)offset, .ra_count = (int)length};
+	ok = fcntl(fd, F_RDADVISE, &ra) != -1;
+#elif defined(POSIX_FADV_WILLNEED)
+	ok = posix_fadvise(fd, (off_t)offset, (off_t)length, POSIX_FADV_WILLNEED) == 0;
+#endif
+
+	close(fd);
+	return ok;
+}
+#endif
+
+static inline int64_t clamp_length(int64_t length)
+{
+	if (length < WARM_MIN_BYTES)
+		return WARM_MIN_BYTES;
+	if (length > WARM_MAX_BYTES)
+		return WARM_MAX_BYTES;
+	return length;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Keyframe index */
+
+static int index_interrupt(void *opaque)
+{
+	struct page_warmer *pw = opaque;
+	return pw->stopping ? 1 : 0;
+}
+
+static void close_index(struct page_warmer *pw)
+{
+	if (pw->index_ctx)
+		avformat_close_input(&pw->index_ctx);
+	bfree(pw->index_path);
+	pw->index_path = NULL;
+}
+
+/* Byte offset of the keyframe at or before time_us, -1 if the file has no
+ * index in its header. Only the header is read, no stream probing */
+static int64_t keyframe_offset(struct page_warmer *pw, const char *path, int64_t time_us)
+{
+	if (!pw->index_path || strcmp(pw->index_path, path) != 0) {
+		close_index(pw);
+		pw->index_path = bstrdup(path);
+
+		pw->index_ctx = avformat_alloc_context();
+		if (!pw->index_ctx)
+			return -1;
+		pw->index_ctx->interrupt_callback.callback = index_interrupt;
+		pw->index_ctx->interrupt_callback.opaque = pw;
+
+		/* Frees the context on failure */
+		if (avformat_open_input(&pw->index_ctx, path, NULL, NULL) < 0)
+			return -1;
+		pw->index_stream = av_find_best_stream(pw->index_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+	}
+
+	if (!pw->index_ctx || pw->index_stream < 0)
+		return -1;
+
+	AVStream *stream = pw->index_ctx->streams[pw->index_stream];
+	int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+	int64_t ts = av_rescale_q(time_us, AV_TIME_BASE_Q, stream->time_base) + start;
+
+	const AVIndexEntry *entry = avformat_index_get_entry_from_timestamp(stream, ts, AVSEEK_FLAG_BACKWARD);
+	return entry ? entry->pos : -1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void process_request(struct page_warmer *pw, const struct warm_request *req)
+{
+	int64_t size = os_get_file_size(req->path);
+	if (size <= 0 || req->duration_us <= 0)
+		return;
+
+	double bytes_per_us = (double)size / (double)req->duration_us;
+	int64_t length = clamp_length((int64_t)(bytes_per_us * (double)req->span_us));
+	int64_t offset = 0;
+
+	if (req->time_us != AV_NOPTS_VALUE) {
+		offset = keyframe_offset(pw, req->path, req->time_us);
+		if (offset >= 0) {
+			pw->index_hits++;
+		} else {
+			/* Estimate, centered so a keyframe a little earlier is covered too */
+			offset = (int64_t)(bytes_per_us * (double)req->time_us) - length / 2;
+		}
+	}
+
+	if (offset < 0)
+		offset = 0;
+	if (offset > size)
+		offset = size;
+	if (offset + length > size)
+		length = size - offset;
+
+	bool ok = length > 0 && warm_range(pw, req->path, offset, length);
+
+	if (req->time_us == AV_NOPTS_VALUE && size > length) {
+		int64_t tail = size - length > WARM_TAIL_BYTES ? WARM_TAIL_BYTES : size - length;
+		if (warm_range(pw, req->path, size - tail, tail))
+			length += tail;
+	}
+
+	if (ok) {
+		pw->bytes += (uint64_t)length;
+		blog(LOG_DEBUG, "Warmed %lld KB of %s at %lld", (long long)(length / 1024),
+			req->path, (long long)offset);
+	}
+}
+
+static void *warmer_thread(void *data)
+{
+	struct page_warmer *pw = data;
+
+	os_set_thread_name("fmgnice-warmer");
+
+	pthread_mutex_lock(&pw->lock);
+	while (!pw->stopping) {
+		if (!pw->queue.num) {
+			pthread_cond_wait(&pw->cond, &pw->lock);
+			continue;
+		}
+
+		struct warm_request req = pw->queue.array[0];
+		da_erase(pw->queue, 0);
+		pthread_mutex_unlock(&pw->lock);
+
+		process_request(pw, &req);
+		bfree(req.path);
+
+		pthread_mutex_lock(&pw->lock);
+	}
+	pthread_mutex_unlock(&pw->lock);
+
+	close_index(pw);
+	return NULL;
+}
+
+struct page_warmer *page_warmer_create(void)
+{
+	struct page_warmer *pw = bzalloc(sizeof(struct page_warmer));
+
+	pthread_mutex_init(&pw->lock, NULL);
+	pthread_cond_init(&pw->cond, NULL);
+	da_init(pw->queue);
+	pw->index_stream = -1;
+
+	return pw;
+}
+
+void page_warmer_destroy(struct page_warmer *pw)
+{
+	if (!pw)
+		return;
+
+	pthread_mutex_lock(&pw->lock);
+	pw->stopping = true;
+	pthread_cond_signal(&pw->cond);
+	pthread_mutex_unlock(&pw->lock);
+
+	if (pw->thread_active)
+		pthread_join(pw->thread, NULL);
+
+	if (pw->requests) {
+		blog(LOG_INFO, "%llu requests, %llu MB warmed, %llu from the keyframe index",
+			(unsigned long long)pw->requests, (unsigned long long)(pw->bytes / (1024 * 1024)),
+			(unsigned long long)pw->index_hits);
+	}
+
+	for (size_t i = 0; i < pw->queue.num; i++)
+		bfree(pw->queue.array[i].path);
+	da_free(pw->queue);
+
+	pthread_cond_destroy(&pw->cond);
+	pthread_mutex_destroy(&pw->lock);
+	bfree(pw);
+}
+
+static void queue_request(struct page_warmer *pw, const char *path, int64_t time_us,
+	int64_t duration_us, int64_t span_us)
+{
+	if (!pw || !path || !*path || duration_us <= 0)
+		return;
+
+	pthread_mutex_lock(&pw->lock);
+
+	if (!pw->stopping) {
+		if (pw->queue.num >= WARM_QUEUE_MAX) {
+			bfree(pw->queue.array[0].path);
+			da_erase(pw->queue, 0);
+		}
+
+		struct warm_request req = {bstrdup(path), time_us, duration_us, span_us};
+		da_push_back(pw->queue, &req);
+		pw->requests++;
+
+		/* Started on first use so sources that never warm don't carry an idle thread */
+		if (!pw->thread_active)
+			pw->thread_active = pthread_create(&pw->thread, NULL, warmer_thread, pw) == 0;
+		pthread_cond_signal(&pw->cond);
+	}
+
+	pthread_mutex_unlock(&pw->lock);
+}
+
+void page_warmer_warm_head(struct page_warmer *pw, const char *path,
+	int64_t duration_us, int64_t span_us)
+{
+	queue_request(pw, path, AV_NOPTS_VALUE, duration_us, span_us);
+}
+
+void page_warmer_warm_at(struct page_warmer *pw, const char *path,
+	int64_t time_us, int64_t duration_us, int64_t span_us)
+{
+	queue_request(pw, path, time_us < 0 ? 0 : time_us, duration_us, span_us);
+}
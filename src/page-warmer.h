@@ -0,0 +1,28 @@
+/*
+ * Predictive page-cache warming
+ * The playlist timeline is deterministic, so the byte ranges playback needs
+ * next are known ahead of time. A background thread pulls them into the OS
+ * page cache before the decoder gets there
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct page_warmer;
+
+struct page_warmer *page_warmer_create(void);
+
+/* Stops the worker, dropping queued requests */
+void page_warmer_destroy(struct page_warmer *pw);
+
+/* Warm the first span_us of a file (sized from its average bitrate) plus its
+ * last megabyte, where MP4 indexes and MKV cues often live */
+void page_warmer_warm_head(struct page_warmer *pw, const char *path,
+	int64_t duration_us, int64_t span_us);
+
+/* Warm span_us of data from the keyframe at or before time_us. Uses the
+ * file's keyframe index when it has one, a bitrate estimate otherwise */
+void page_warmer_warm_at(struct page_warmer *pw, const char *path,
+	int64_t time_us, int64_t duration_us, int64_t span_us);
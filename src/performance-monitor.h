@@ -51,6 +51,12 @@ typedef struct {
 	bool is_memory_bound;
 	bool is_decoder_bound;
 	
+	/* A/V sync (audio sample clock minus master clock) */
+	bool has_av_sync;
+	int64_t av_drift_ns;
+	int64_t max_av_drift_ns;   /* Largest absolute drift since the last report */
+	uint32_t av_resyncs;
+	
 	/* Last log time */
 	uint64_t last_report_time;
 } perf_monitor_t;
@@ -81,6 +87,14 @@ static inline void perf_monitor_frame_start(perf_monitor_t *monitor)
 	monitor->frame_start_time = os_gettime_ns();
 }
 
+/* Exclude time spent blocked (e.g. waiting for a free buffer slot) from
+ * the current frame's convert and total times */
+static inline void perf_monitor_exclude_wait(perf_monitor_t *monitor, uint64_t wait_ns)
+{
+	if (!monitor) return;
+	monitor->frame_start_time += wait_ns;
+}
+
 static inline void perf_monitor_decode_complete(perf_monitor_t *monitor)
 {
 	if (!monitor) return;
@@ -125,6 +139,17 @@ static inline void perf_monitor_frame_complete(perf_monitor_t *monitor)
 	monitor->is_cpu_bound = monitor->avg_render_time > (monitor->frame_duration_ns * 4 / 5);
 }
 
+static inline void perf_monitor_set_av_drift(perf_monitor_t *monitor, int64_t drift_ns, uint32_t resyncs)
+{
+	if (!monitor) return;
+	int64_t abs_drift = drift_ns < 0 ? -drift_ns : drift_ns;
+	monitor->has_av_sync = true;
+	monitor->av_drift_ns = drift_ns;
+	monitor->av_resyncs = resyncs;
+	if (abs_drift > monitor->max_av_drift_ns)
+		monitor->max_av_drift_ns = abs_drift;
+}
+
 static inline void perf_monitor_update_cpu_usage(perf_monitor_t *monitor)
 {
 #ifdef _WIN32
@@ -222,6 +247,14 @@ static inline void perf_monitor_report(perf_monitor_t *monitor, const char *sour
 		monitor->memory_used_mb,
 		monitor->peak_memory_mb);
 	
+	if (monitor->has_av_sync) {
+		blog(LOG_INFO, "[%s Sync] A/V drift: %.2fms (max %.2fms), %u resyncs",
+			source_name,
+			monitor->av_drift_ns / 1000000.0,
+			monitor->max_av_drift_ns / 1000000.0,
+			monitor->av_resyncs);
+	}
+	
 	if (monitor->is_decoder_bound) {
 		blog(LOG_WARNING, "[%s] Performance bottleneck: DECODER BOUND - consider using hardware decoding", source_name);
 	}
@@ -236,4 +269,5 @@ static inline void perf_monitor_report(perf_monitor_t *monitor, const char *sour
 	monitor->frames_processed = 0;
 	monitor->frames_late = 0;
 	monitor->frames_dropped = 0;
+	monitor->max_av_drift_ns = 0;
 }
\ No newline at end of file
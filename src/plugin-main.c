@@ -7,6 +7,7 @@
 #include <util/platform.h>
 #include <util/threading.h>
 #include <util/darray.h>
+#include "stream-cache.h"
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("fmgnice-video", "en-US")
@@ -20,6 +21,7 @@ static DARRAY(void*) g_active_sources = {0};
 void fmgnice_register_source(void *source);
 void fmgnice_unregister_source(void *source);
 void fmgnice_emergency_cleanup(void);
+void fmgnice_close_global_timeline(void);
 
 MODULE_EXPORT const char *obs_module_name(void)
 {
@@ -54,6 +56,8 @@ void obs_module_unload(void)
 	
 	/* Emergency cleanup of any remaining sources */
 	fmgnice_emergency_cleanup();
+	fmgnice_close_global_timeline();
+	stream_cache_clear();
 	
 	blog(LOG_INFO, "[fmgNICE Video] Plugin unloaded");
 }
@@ -0,0 +1,534 @@
+/*
+ * Asynchronous read-ahead AVIOContext implementation
+ * The file is cached in fixed-size chunks. Reads schedule the window ahead of
+ * them, reader threads load queued chunks nearest the read position first,
+ * and the demuxer only waits when it catches up with the readers
+ */
+
+#include "readahead-io.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavutil/mem.h>
+#include <libavutil/error.h>
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+#endif
+
+#define blog(level, format, ...) \
+	blog(level, "[Read-Ahead IO] " format, ##__VA_ARGS__)
+
+#define READAHEAD_CHUNK_SIZE (1024 * 1024)
+#define READAHEAD_MIN_WINDOW (4 * READAHEAD_CHUNK_SIZE)
+/* Parallel requests hide network latency; more mostly adds seeks on disks */
+#define READAHEAD_WORKERS 3
+#define READAHEAD_BUFFER_SIZE (64 * 1024)
+/* Chunks loaded ahead of a hinted seek target */
+#define READAHEAD_HINT_CHUNKS 4
+
+enum chunk_state {
+	CHUNK_EMPTY,
+	CHUNK_QUEUED,
+	CHUNK_LOADING,
+	CHUNK_READY,
+	CHUNK_FAILED,
+};
+
+struct chunk {
+	int64_t index;        /* Chunk number in the file, -1 = unused */
+	enum chunk_state state;
+	int len;              /* Short only for the last chunk */
+	uint64_t last_used;
+	uint8_t *data;
+};
+
+struct readahead_io {
+#ifdef _WIN32
+	HANDLE file;
+#else
+	int fd;
+#endif
+	int64_t size;
+	int64_t pos;
+	int64_t file_chunks;
+	int64_t window_chunks;
+
+	struct chunk *chunks;
+	size_t num_chunks;
+	uint64_t use_counter;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond;    /* Chunks queued or closing */
+	pthread_cond_t ready_cond;   /* A chunk finished loading */
+	pthread_t workers[READAHEAD_WORKERS];
+	int num_workers;
+	bool closing;
+
+	/* Stats for the close log */
+	uint64_t reads;
+	uint64_t stalls;
+};
+
+/* ------------------------------------------------------------------------- */
+/* Positional file reads, safe from several threads at once */
+
+static bool open_file(struct readahead_io *io, const char *path)
+{
+#ifdef _WIN32
+	wchar_t *wpath = NULL;
+	if (os_utf8_to_wcs_ptr(path, 0, &wpath) == 0)
+		return false;
+
+	/* Overlapped, a synchronous handle would serialize the readers' requests */
+	io->file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL);
+	bfree(wpath);
+	if (io->file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(io->file, &size)) {
+		CloseHandle(io->file);
+		io->file = INVALID_HANDLE_VALUE;
+		return false;
+	}
+	io->size = size.QuadPart;
+#else
+	io->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (io->fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(io->fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+		close(io->fd);
+		io->fd = -1;
+		return false;
+	}
+	io->size = st.st_size;
+#endif
+	return true;
+}
+
+static void close_file(struct readahead_io *io)
+{
+#ifdef _WIN32
+	if (io->file != INVALID_HANDLE_VALUE)
+		CloseHandle(io->file);
+#else
+	if (io->fd >= 0)
+		close(io->fd);
+#endif
+}
+
+/* Returns the bytes read (short only at end of file), or -1 */
+static int read_at(struct readahead_io *io, int64_t offset, uint8_t *buf, int size)
+{
+	int total = 0;
+
+#ifdef _WIN32
+	/* Completion event for this read, a chunk read dwarfs creating it */
+	HANDLE event = CreateEventW(NULL, TRUE, FALSE, NULL);
+	if (!event)
+		return -1;
+#endif
+
+	while (total < size) {
+#ifdef _WIN32
+		OVERLAPPED ov = {0};
+		int64_t at = offset + total;
+		ov.Offset = (DWORD)at;
+		ov.OffsetHigh = (DWORD)(at >> 32);
+		ov.hEvent = event;
+		DWORD got = 0;
+		bool ok = ReadFile(io->file, buf + total, (DWORD)(size - total), NULL, &ov) ||
+			GetLastError() == ERROR_IO_PENDING;
+		if (ok)
+			ok = GetOverlappedResult(io->file, &ov, &got, TRUE);
+		if (!ok && GetLastError() != ERROR_HANDLE_EOF) {
+			CloseHandle(event);
+			return -1;
+		}
+#else
+		ssize_t got = pread(io->fd, buf + total, (size_t)(size - total), (off_t)(offset + total));
+		if (got < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+#endif
+		if (got == 0)
+			break;
+		total += (int)got;
+	}
+
+#ifdef _WIN32
+	CloseHandle(event);
+#endif
+	return total;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Chunk cache, all called with the mutex held */
+
+static inline int64_t chunk_distance(struct readahead_io *io, int64_t index)
+{
+	/* Chunks behind the read position count as past the end, wrapping to
+	 * the start of the file like the window does */
+	int64_t cur = io->pos / READAHEAD_CHUNK_SIZE;
+	return index >= cur ? index - cur : index + io->file_chunks - cur;
+}
+
+static struct chunk *find_chunk(struct readahead_io *io, int64_t index)
+{
+	for (size_t i = 0; i < io->num_chunks; i++) {
+		if (io->chunks[i].index == index)
+			return &io->chunks[i];
+	}
+	return NULL;
+}
+
+/* Least recently used slot outside the current window, never one a reader
+ * is filling */
+static struct chunk *evict_chunk(struct readahead_io *io)
+{
+	struct chunk *victim = NULL;
+
+	for (size_t i = 0; i < io->num_chunks; i++) {
+		struct chunk *c = &io->chunks[i];
+		if (c->state == CHUNK_LOADING)
+			continue;
+		if (c->index < 0)
+			return c;
+		if (chunk_distance(io, c->index) < io->window_chunks)
+			continue;
+		if (!victim || c->last_used < victim->last_used)
+			victim = c;
+	}
+
+	return victim;
+}
+
+static void schedule(struct readahead_io *io, int64_t first, int64_t count)
+{
+	bool queued = false;
+
+	for (int64_t i = 0; i < count && i < io->file_chunks; i++) {
+		int64_t index = (first + i) % io->file_chunks;
+		struct chunk *c = find_chunk(io, index);
+
+		if (!c) {
+			c = evict_chunk(io);
+			if (!c)
+				break;
+			c->index = index;
+			c->state = CHUNK_EMPTY;
+		}
+		if (c->state == CHUNK_EMPTY || c->state == CHUNK_FAILED) {
+			c->state = CHUNK_QUEUED;
+			queued = true;
+		}
+		c->last_used = ++io->use_counter;
+	}
+
+	if (queued)
+		pthread_cond_broadcast(&io->work_cond);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void *reader_thread(void *data)
+{
+	struct readahead_io *io = data;
+
+	os_set_thread_name("fmgnice-readahead");
+
+	pthread_mutex_lock(&io->mutex);
+
+	while (!io->closing) {
+		/* Nearest queued chunk first, so the demuxer waits as little as possible */
+		struct chunk *next = NULL;
+		for (size_t i = 0; i < io->num_chunks; i++) {
+			struct chunk *c = &io->chunks[i];
+			if (c->state == CHUNK_QUEUED &&
+			    (!next || chunk_distance(io, c->index) < chunk_distance(io, next->index)))
+				next = c;
+		}
+
+		if (!next) {
+			pthread_cond_wait(&io->work_cond, &io->mutex);
+			continue;
+		}
+
+		next->state = CHUNK_LOADING;
+		int64_t offset = next->index * READAHEAD_CHUNK_SIZE;
+		pthread_mutex_unlock(&io->mutex);
+
+		int len = read_at(io, offset, next->data, READAHEAD_CHUNK_SIZE);
+
+		pthread_mutex_lock(&io->mutex);
+		next->len = len;
+		next->state = len >= 0 ? CHUNK_READY : CHUNK_FAILED;
+		pthread_cond_broadcast(&io->ready_cond);
+	}
+
+	pthread_mutex_unlock(&io->mutex);
+	return NULL;
+}
+
+static int readahead_io_read(void *opaque, uint8_t *buf, int buf_size)
+{
+	struct readahead_io *io = opaque;
+	int ret;
+
+	pthread_mutex_lock(&io->mutex);
+
+	if (io->pos >= io->size) {
+		pthread_mutex_unlock(&io->mutex);
+		return AVERROR_EOF;
+	}
+
+	int64_t index = io->pos / READAHEAD_CHUNK_SIZE;
+	struct chunk *c;
+	bool stalled = false;
+
+	/* Also retries the chunk once if its last load failed */
+	schedule(io, index, io->window_chunks);
+
+	for (;;) {
+		c = find_chunk(io, index);
+		if (!c) {
+			/* Lost to a hint while waiting */
+			schedule(io, index, 1);
+			c = find_chunk(io, index);
+		}
+		if (!c || c->state == CHUNK_READY || c->state == CHUNK_FAILED || io->closing)
+			break;
+		stalled = true;
+		pthread_cond_wait(&io->ready_cond, &io->mutex);
+	}
+
+	io->reads++;
+	if (stalled)
+		io->stalls++;
+
+	if (!c || c->state != CHUNK_READY) {
+		ret = io->closing ? AVERROR_EXIT : AVERROR(EIO);
+	} else {
+		int offset = (int)(io->pos - index * READAHEAD_CHUNK_SIZE);
+		int len = c->len - offset;
+		if (len > buf_size)
+			len = buf_size;
+		if (len <= 0) {
+			ret = AVERROR_EOF;
+		} else {
+			memcpy(buf, c->data + offset, len);
+			io->pos += len;
+			ret = len;
+		}
+	}
+
+	pthread_mutex_unlock(&io->mutex);
+	return ret;
+}
+
+static int64_t readahead_io_seek(void *opaque, int64_t offset, int whence)
+{
+	struct readahead_io *io = opaque;
+	int64_t pos;
+
+	switch (whence & ~AVSEEK_FORCE) {
+	case AVSEEK_SIZE:
+		return io->size;
+	case SEEK_SET:
+		pos = offset;
+		break;
+	case SEEK_CUR:
+		pos = io->pos + offset;
+		break;
+	case SEEK_END:
+		pos = io->size + offset;
+		break;
+	default:
+		return AVERROR(EINVAL);
+	}
+
+	if (pos < 0 || pos > io->size)
+		return AVERROR(EINVAL);
+
+	/* The next read schedules the window from here */
+	pthread_mutex_lock(&io->mutex);
+	io->pos = pos;
+	pthread_mutex_unlock(&io->mutex);
+	return pos;
+}
+
+static void free_io(struct readahead_io *io)
+{
+	pthread_mutex_lock(&io->mutex);
+	io->closing = true;
+	pthread_cond_broadcast(&io->work_cond);
+	pthread_cond_broadcast(&io->ready_cond);
+	pthread_mutex_unlock(&io->mutex);
+
+	for (int i = 0; i < io->num_workers; i++)
+		pthread_join(io->workers[i], NULL);
+
+	for (size_t i = 0; i < io->num_chunks; i++)
+		bfree(io->chunks[i].data);
+	bfree(io->chunks);
+
+	close_file(io);
+	pthread_cond_destroy(&io->ready_cond);
+	pthread_cond_destroy(&io->work_cond);
+	pthread_mutex_destroy(&io->mutex);
+	bfree(io);
+}
+
+AVIOContext *readahead_io_open(const char *path, size_t window_bytes)
+{
+	if (!path || !*path || strstr(path, "://"))
+		return NULL;
+
+	struct readahead_io *io = bzalloc(sizeof(struct readahead_io));
+	pthread_mutex_init(&io->mutex, NULL);
+	pthread_cond_init(&io->work_cond, NULL);
+	pthread_cond_init(&io->ready_cond, NULL);
+#ifdef _WIN32
+	io->file = INVALID_HANDLE_VALUE;
+#else
+	io->fd = -1;
+#endif
+
+	if (!open_file(io, path) || io->size <= 0) {
+		free_io(io);
+		return NULL;
+	}
+
+	if (window_bytes < READAHEAD_MIN_WINDOW)
+		window_bytes = READAHEAD_MIN_WINDOW;
+	io->file_chunks = (io->size + READAHEAD_CHUNK_SIZE - 1) / READAHEAD_CHUNK_SIZE;
+	io->window_chunks = (int64_t)(window_bytes / READAHEAD_CHUNK_SIZE);
+	if (io->window_chunks > io->file_chunks)
+		io->window_chunks = io->file_chunks;
+
+	/* Room for the window, the chunks behind it still being copied out,
+	 * and hinted seek targets */
+	io->num_chunks = (size_t)(io->window_chunks + io->window_chunks / 2 + READAHEAD_HINT_CHUNKS);
+	io->chunks = bzalloc(io->num_chunks * sizeof(struct chunk));
+	for (size_t i = 0; i < io->num_chunks; i++) {
+		io->chunks[i].index = -1;
+		io->chunks[i].data = bmalloc(READAHEAD_CHUNK_SIZE);
+	}
+
+	for (int i = 0; i < READAHEAD_WORKERS; i++) {
+		if (pthread_create(&io->workers[io->num_workers], NULL, reader_thread, io) == 0)
+			io->num_workers++;
+	}
+
+	unsigned char *buffer = io->num_workers ? av_malloc(READAHEAD_BUFFER_SIZE) : NULL;
+	AVIOContext *pb = buffer ? avio_alloc_context(buffer, READAHEAD_BUFFER_SIZE, 0, io,
+		readahead_io_read, NULL, readahead_io_seek) : NULL;
+	if (!pb) {
+		av_free(buffer);
+		free_io(io);
+		return NULL;
+	}
+
+	/* Get the header loading before the demuxer asks for it */
+	pthread_mutex_lock(&io->mutex);
+	schedule(io, 0, io->window_chunks);
+	pthread_mutex_unlock(&io->mutex);
+
+	blog(LOG_INFO, "Reading %lld MB file with a %lld MB window", (long long)(io->size / (1024 * 1024)),
+		(long long)io->window_chunks);
+	return pb;
+}
+
+void readahead_io_hint(AVIOContext *pb, int64_t offset)
+{
+	if (!pb || !pb->opaque)
+		return;
+
+	struct readahead_io *io = pb->opaque;
+	if (offset < 0 || offset >= io->size)
+		return;
+
+	pthread_mutex_lock(&io->mutex);
+	schedule(io, offset / READAHEAD_CHUNK_SIZE, READAHEAD_HINT_CHUNKS);
+	pthread_mutex_unlock(&io->mutex);
+}
+
+void readahead_io_close(AVIOContext **pb)
+{
+	if (!pb || !*pb)
+		return;
+
+	struct readahead_io *io = (*pb)->opaque;
+
+	av_freep(&(*pb)->buffer);
+	avio_context_free(pb);
+
+	if (io) {
+		blog(LOG_INFO, "Closed after %llu reads, %llu waited for the disk",
+			(unsigned long long)io->reads, (unsigned long long)io->stalls);
+		free_io(io);
+	}
+}
+
+bool readahead_io_is_remote(const char *path)
+{
+	if (!path || !*path)
+		return false;
+
+#ifdef _WIN32
+	/* \\?\UNC\server\share or \\server\share */
+	if (strncmp(path, "\\\\?\\", 4) == 0)
+		path += 4;
+	if (_strnicmp(path, "UNC\\", 4) == 0)
+		return true;
+	if ((path[0] == '\\' || path[0] == '/') && (path[1] == '\\' || path[1] == '/'))
+		return true;
+
+	/* Mapped network drive */
+	if (path[0] && path[1] == ':') {
+		char root[4] = {path[0], ':', '\\', 0};
+		return GetDriveTypeA(root) == DRIVE_REMOTE;
+	}
+	return false;
+#elif defined(__linux__)
+	struct statfs st;
+	if (statfs(path, &st) != 0)
+		return false;
+
+	switch ((unsigned long)st.f_type) {
+	case 0x6969UL:      /* NFS */
+	case 0x517BUL:      /* SMB */
+	case 0xFF534D42UL:  /* CIFS */
+	case 0xFE534D42UL:  /* SMB2 */
+	case 0x65735546UL:  /* FUSE (sshfs and friends) */
+		return true;
+	default:
+		return false;
+	}
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,37 @@
+/*
+ * Asynchronous read-ahead AVIOContext
+ * A small pool of reader threads keeps a window of the file loaded ahead of
+ * the demux position, so slow storage (network shares, spinning disks)
+ * doesn't stall av_read_frame on the decoder thread
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libavformat/avio.h>
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Open a local or network-share file with window_bytes kept in flight ahead
+ * of the read position. Near the end of the file the window wraps to the
+ * start, where looping playback seeks next. Returns NULL for URLs or if the
+ * file can't be opened */
+AVIOContext *readahead_io_open(const char *path, size_t window_bytes);
+
+/* Start loading around offset ahead of a seek that is about to happen */
+void readahead_io_hint(AVIOContext *pb, int64_t offset);
+
+/* Stop the readers and free everything. Sets *pb to NULL */
+void readahead_io_close(AVIOContext **pb);
+
+/* True if the path is on a network filesystem */
+bool readahead_io_is_remote(const char *path);
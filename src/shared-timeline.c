@@ -0,0 +1,414 @@
+/*
+ * Cross-process global timeline implementation
+ */
+
+#include "shared-timeline.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Atomic operations for cross-platform compatibility */
+#ifdef _MSC_VER
+typedef volatile LONG seq_t;
+#define seq_load(ptr) ((uint32_t)InterlockedCompareExchange((volatile LONG*)(ptr), 0, 0))
+#define seq_store(ptr, val) InterlockedExchange((volatile LONG*)(ptr), (LONG)(val))
+#define seq_cas(ptr, expected, desired) \
+	(InterlockedCompareExchange((volatile LONG*)(ptr), (LONG)(desired), (LONG)(expected)) == (LONG)(expected))
+#define seq_fence() MemoryBarrier()
+#define seq_pause() YieldProcessor()
+#else
+#include <stdatomic.h>
+typedef _Atomic(uint32_t) seq_t;
+#define seq_load(ptr) atomic_load(ptr)
+#define seq_store(ptr, val) atomic_store(ptr, val)
+static inline bool seq_cas(seq_t *ptr, uint32_t expected, uint32_t desired)
+{
+	return atomic_compare_exchange_strong(ptr, &expected, desired);
+}
+#define seq_fence() atomic_thread_fence(memory_order_seq_cst)
+#if defined(__x86_64__) || defined(__i386__)
+#define seq_pause() __builtin_ia32_pause()
+#else
+#define seq_pause() ((void)0)
+#endif
+#endif
+
+#define blog(level, format, ...) \
+	blog(level, "[Shared Timeline] " format, ##__VA_ARGS__)
+
+#define SHARED_TIMELINE_MAGIC 0x54474D46u  /* "FMGT" */
+#define SHARED_TIMELINE_VERSION 2
+
+/* Reader retries before giving up on a busy segment */
+#define SEQLOCK_READ_RETRIES 1000
+/* Whether the process holding the write lock is still alive is only
+ * checked once it has held it this long */
+#define SEQLOCK_STALE_NS 50000000ULL
+
+/* Layout is shared with other processes - only append, and bump the version */
+struct shared_timeline_segment {
+	seq_t sequence;                  /* Odd while a writer is active */
+	volatile uint32_t magic;         /* 0 in a freshly created segment */
+	volatile uint32_t version;
+	volatile uint32_t paused;
+	volatile uint64_t epoch_ms;
+	volatile uint64_t playlist_hash;
+	volatile uint64_t pause_time_ms;
+	seq_t owner;                     /* Process ID of the writer, 0 when unlocked */
+};
+
+struct shared_timeline {
+	struct shared_timeline_segment *seg;
+	bool shared;
+
+	/* Last consistent read, returned while a writer that died mid-update
+	 * keeps the sequence odd until another one takes the lock over */
+	pthread_mutex_t last_lock;
+	struct shared_timeline_state last;
+	bool have_last;
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+};
+
+static bool map_segment(struct shared_timeline *tl, const char *name)
+{
+	size_t size = sizeof(struct shared_timeline_segment);
+
+#ifdef _WIN32
+	/* Session-local namespace, so instances of one user see each other */
+	char mapping_name[256];
+	snprintf(mapping_name, sizeof(mapping_name), "Local\\%s", name);
+
+	/* New mappings are zero filled */
+	tl->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+		0, (DWORD)size, mapping_name);
+	if (!tl->mapping) {
+		blog(LOG_WARNING, "CreateFileMapping(%s) failed: %lu", mapping_name, GetLastError());
+		return false;
+	}
+
+	tl->seg = MapViewOfFile(tl->mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!tl->seg) {
+		blog(LOG_WARNING, "MapViewOfFile(%s) failed: %lu", mapping_name, GetLastError());
+		CloseHandle(tl->mapping);
+		tl->mapping = NULL;
+		return false;
+	}
+#else
+	char shm_name[256];
+	snprintf(shm_name, sizeof(shm_name), "/%s", name);
+
+	int fd = shm_open(shm_name, O_RDWR | O_CREAT, 0600);
+	if (fd < 0) {
+		blog(LOG_WARNING, "shm_open(%s) failed", shm_name);
+		return false;
+	}
+
+	/* Zero filled when created, a no-op when it already has this size */
+	struct stat st;
+	if (fstat(fd, &st) < 0 || ((size_t)st.st_size < size && ftruncate(fd, (off_t)size) < 0)) {
+		blog(LOG_WARNING, "Failed to size %s", shm_name);
+		close(fd);
+		return false;
+	}
+
+	void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) {
+		blog(LOG_WARNING, "mmap(%s) failed", shm_name);
+		return false;
+	}
+	tl->seg = mem;
+#endif
+
+	return true;
+}
+
+static void unmap_segment(struct shared_timeline *tl)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(tl->seg);
+	CloseHandle(tl->mapping);
+#else
+	/* The segment is left in place for other processes */
+	munmap(tl->seg, sizeof(struct shared_timeline_segment));
+#endif
+}
+
+struct shared_timeline *shared_timeline_open(const char *name)
+{
+	struct shared_timeline *tl = bzalloc(sizeof(struct shared_timeline));
+	pthread_mutex_init(&tl->last_lock, NULL);
+
+	if (!name) {
+		tl->seg = bzalloc(sizeof(struct shared_timeline_segment));
+		return tl;
+	}
+
+	if (!map_segment(tl, name)) {
+		pthread_mutex_destroy(&tl->last_lock);
+		bfree(tl);
+		return NULL;
+	}
+	tl->shared = true;
+
+	uint32_t magic = tl->seg->magic;
+	if (magic != 0 && (magic != SHARED_TIMELINE_MAGIC || tl->seg->version != SHARED_TIMELINE_VERSION)) {
+		blog(LOG_WARNING, "Segment %s has an incompatible layout (version %u)",
+			name, tl->seg->version);
+		unmap_segment(tl);
+		pthread_mutex_destroy(&tl->last_lock);
+		bfree(tl);
+		return NULL;
+	}
+
+	blog(LOG_INFO, "Joined host-wide timeline %s", name);
+	return tl;
+}
+
+void shared_timeline_close(struct shared_timeline *tl)
+{
+	if (!tl)
+		return;
+
+	if (tl->shared)
+		unmap_segment(tl);
+	else
+		bfree(tl->seg);
+	pthread_mutex_destroy(&tl->last_lock);
+	bfree(tl);
+}
+
+bool shared_timeline_is_shared(const struct shared_timeline *tl)
+{
+	return tl && tl->shared;
+}
+
+static uint32_t current_pid(void)
+{
+#ifdef _WIN32
+	return (uint32_t)GetCurrentProcessId();
+#else
+	return (uint32_t)getpid();
+#endif
+}
+
+/* False only when the process is known to be gone. A process we may not
+ * query still exists */
+static bool process_alive(uint32_t pid)
+{
+#ifdef _WIN32
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+	if (!process)
+		return GetLastError() != ERROR_INVALID_PARAMETER;
+	bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+	CloseHandle(process);
+	return alive;
+#else
+	return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+/* Take the write side of the seqlock, returns the (odd) locked sequence.
+ * The lock is owned by process ID, so only one writer can hold it. Writers
+ * in other processes may die mid-update: a lock held past SEQLOCK_STALE_NS
+ * is taken over if its owner no longer exists, never from a live writer
+ * that was merely preempted */
+static uint32_t write_lock(struct shared_timeline_segment *seg)
+{
+	uint32_t self = current_pid();
+	uint32_t held_by = 0;
+	uint64_t held_since = 0;
+
+	for (;;) {
+		uint32_t owner = seq_load(&seg->owner);
+
+		if (owner == 0) {
+			if (seq_cas(&seg->owner, 0, self))
+				break;
+			continue;
+		}
+
+		uint64_t now = os_gettime_ns();
+		if (owner != held_by) {
+			held_by = owner;
+			held_since = now;
+		} else if (now - held_since > SEQLOCK_STALE_NS) {
+			if (!process_alive(owner) && seq_cas(&seg->owner, owner, self)) {
+				blog(LOG_WARNING, "Took over the timeline lock of exited process %u", owner);
+				break;
+			}
+			held_since = now;
+		}
+		os_sleep_ms(0);
+	}
+
+	/* A writer that died mid-update left the sequence odd. It stays odd,
+	 * but readers see it move */
+	uint32_t seq = seq_load(&seg->sequence);
+	uint32_t locked = (seq & 1) ? seq + 2 : seq + 1;
+	seq_store(&seg->sequence, locked);
+	seq_fence();
+	return locked;
+}
+
+static void write_unlock(struct shared_timeline_segment *seg, uint32_t locked_seq)
+{
+	seg->magic = SHARED_TIMELINE_MAGIC;
+	seg->version = SHARED_TIMELINE_VERSION;
+	seq_fence();
+	seq_store(&seg->sequence, locked_seq + 1);
+	seq_store(&seg->owner, 0);
+}
+
+bool shared_timeline_read(struct shared_timeline *tl, struct shared_timeline_state *out)
+{
+	if (!tl || !out)
+		return false;
+
+	struct shared_timeline_segment *seg = tl->seg;
+
+	for (int i = 0; i < SEQLOCK_READ_RETRIES; i++) {
+		if (i)
+			seq_pause();
+
+		uint32_t seq = seq_load(&seg->sequence);
+		if (seq & 1)
+			continue;
+
+		seq_fence();
+		out->epoch_ms = seg->epoch_ms;
+		out->playlist_hash = seg->playlist_hash;
+		out->paused = seg->paused != 0;
+		out->pause_time_ms = seg->pause_time_ms;
+		seq_fence();
+
+		if (seq_load(&seg->sequence) == seq) {
+			out->sequence = seq;
+
+			pthread_mutex_lock(&tl->last_lock);
+			tl->last = *out;
+			tl->have_last = true;
+			pthread_mutex_unlock(&tl->last_lock);
+			return true;
+		}
+	}
+
+	pthread_mutex_lock(&tl->last_lock);
+	bool have_last = tl->have_last;
+	if (have_last)
+		*out = tl->last;
+	pthread_mutex_unlock(&tl->last_lock);
+	return have_last;
+}
+
+uint64_t shared_timeline_join(struct shared_timeline *tl, uint64_t now_ms, uint64_t playlist_hash)
+{
+	if (!tl)
+		return now_ms;
+
+	struct shared_timeline_segment *seg = tl->seg;
+	uint32_t locked = write_lock(seg);
+
+	bool started = seg->epoch_ms == 0;
+	if (started) {
+		seg->epoch_ms = now_ms;
+		seg->playlist_hash = playlist_hash;
+		seg->paused = 0;
+		seg->pause_time_ms = 0;
+	}
+	uint64_t epoch = seg->epoch_ms;
+	uint64_t existing_hash = seg->playlist_hash;
+
+	write_unlock(seg, locked);
+
+	if (started) {
+		blog(LOG_INFO, "Started timeline at %llu ms", (unsigned long long)epoch);
+	} else if (existing_hash != playlist_hash) {
+		blog(LOG_INFO, "Joined timeline at %llu ms started with a different playlist",
+			(unsigned long long)epoch);
+	}
+
+	return epoch;
+}
+
+void shared_timeline_reset(struct shared_timeline *tl)
+{
+	if (!tl)
+		return;
+
+	struct shared_timeline_segment *seg = tl->seg;
+	uint32_t locked = write_lock(seg);
+	seg->epoch_ms = 0;
+	seg->playlist_hash = 0;
+	seg->paused = 0;
+	seg->pause_time_ms = 0;
+	write_unlock(seg, locked);
+}
+
+void shared_timeline_adopt(struct shared_timeline *tl, const struct shared_timeline_state *state)
+{
+	if (!tl || !state)
+		return;
+
+	struct shared_timeline_segment *seg = tl->seg;
+	uint32_t locked = write_lock(seg);
+	seg->epoch_ms = state->epoch_ms;
+	seg->playlist_hash = state->playlist_hash;
+	seg->paused = state->paused ? 1 : 0;
+	seg->pause_time_ms = state->paused ? state->pause_time_ms : 0;
+	write_unlock(seg, locked);
+}
+
+void shared_timeline_set_paused(struct shared_timeline *tl, bool paused, uint64_t now_ms)
+{
+	if (!tl)
+		return;
+
+	struct shared_timeline_segment *seg = tl->seg;
+	uint32_t locked = write_lock(seg);
+
+	if (seg->epoch_ms != 0 && (seg->paused != 0) != paused) {
+		if (paused) {
+			seg->pause_time_ms = now_ms;
+		} else {
+			/* Shift the epoch so the paused frame is where playback resumes */
+			seg->epoch_ms += now_ms - seg->pause_time_ms;
+			seg->pause_time_ms = 0;
+		}
+		seg->paused = paused ? 1 : 0;
+	}
+
+	write_unlock(seg, locked);
+}
+
+uint64_t shared_timeline_hash_playlist(char *const *paths, size_t count)
+{
+	/* FNV-1a, with a separator between paths */
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < count; i++) {
+		for (const unsigned char *p = (const unsigned char *)paths[i]; p && *p; p++) {
+			hash ^= *p;
+			hash *= 1099511628211ULL;
+		}
+		hash ^= 0xff;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
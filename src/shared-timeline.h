@@ -0,0 +1,54 @@
+/*
+ * Cross-process global timeline
+ * A small shared-memory segment holding the playlist epoch, so every OBS
+ * instance on the host shows the same frame. Readers use a seqlock and
+ * never block; writers (join/reset/pause) are rare
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Times are os_gettime_ns() / 1000000, which is host-wide monotonic */
+struct shared_timeline_state {
+	uint64_t epoch_ms;        /* Timeline start, 0 = not started */
+	uint64_t playlist_hash;   /* Playlist of the instance that started it */
+	bool paused;
+	uint64_t pause_time_ms;   /* When paused, valid while paused */
+	uint32_t sequence;        /* Changes on every write */
+};
+
+struct shared_timeline;
+
+/* Open (creating if needed) the named host-wide segment. A NULL name gives
+ * a process-local stand-in with the same behavior, for tests or when
+ * shared memory isn't available. Returns NULL on failure */
+struct shared_timeline *shared_timeline_open(const char *name);
+
+void shared_timeline_close(struct shared_timeline *tl);
+
+/* False for the process-local stand-in */
+bool shared_timeline_is_shared(const struct shared_timeline *tl);
+
+/* Consistent snapshot, safe every tick. While writers keep the segment busy
+ * for the whole retry budget (or one died mid-update) this is the last
+ * snapshot read; false only if there is none yet */
+bool shared_timeline_read(struct shared_timeline *tl, struct shared_timeline_state *out);
+
+/* Epoch to play against. The first caller after a reset starts it at now_ms */
+uint64_t shared_timeline_join(struct shared_timeline *tl, uint64_t now_ms, uint64_t playlist_hash);
+
+/* Clear the epoch so the next join starts a new show */
+void shared_timeline_reset(struct shared_timeline *tl);
+
+/* Replace epoch, hash and pause state (e.g. with a remote host's epoch) */
+void shared_timeline_adopt(struct shared_timeline *tl, const struct shared_timeline_state *state);
+
+/* Pause or resume every joined instance. Resuming moves the epoch forward
+ * by the paused time so playback continues from the paused frame */
+void shared_timeline_set_paused(struct shared_timeline *tl, bool paused, uint64_t now_ms);
+
+/* Stable 64-bit hash of a playlist's paths */
+uint64_t shared_timeline_hash_playlist(char *const *paths, size_t count);
@@ -5,6 +5,7 @@
 
 #include "simd-convert.h"
 #include <obs-module.h>
+#include <string.h>
 
 #define blog(level, format, ...) \
 	blog(level, "[SIMD Convert] " format, ##__VA_ARGS__)
@@ -32,98 +33,359 @@ bool simd_check_avx2(void)
 #endif
 }
 
-/* YUV to RGB conversion coefficients (ITU-R BT.709) */
-/* Y'CbCr to RGB:
- * R = Y' + 1.5748 * (Cr - 128)
- * G = Y' - 0.1873 * (Cb - 128) - 0.4681 * (Cr - 128)
- * B = Y' + 1.8556 * (Cb - 128)
- */
+/* YUV to RGB conversion coefficients (ITU-R BT.601, limited range):
+ * R = 1.164 * (Y - 16) + 1.596 * (Cr - 128)
+ * G = 1.164 * (Y - 16) - 0.391 * (Cb - 128) - 0.813 * (Cr - 128)
+ * B = 1.164 * (Y - 16) + 2.018 * (Cb - 128)
+ * Coefficients are scaled by 4096 and applied with a high-half multiply to
+ * samples scaled by 128, leaving each term with 3 fractional bits. The
+ * scalar tail does the same integer math so every pixel matches */
+#define YUV_Y_COEFF  4768
+#define YUV_RV_COEFF 6537
+#define YUV_GU_COEFF 1606
+#define YUV_GV_COEFF 3330
+#define YUV_BU_COEFF 8266
 
-/* SSE4.2 implementation for YUV420 to BGRA */
-void yuv420_to_bgra_sse42(
+/* High half of (x << 7) * coeff, as _mm_mulhi_epi16 computes it */
+static inline int yuv_term(int x, int coeff)
+{
+	return (x * 128 * coeff) >> 16;
+}
+
+static inline uint8_t clamp_u8(int value)
+{
+	return value < 0 ? 0 : (value > 255 ? 255 : (uint8_t)value);
+}
+
+/* Premultiply by alpha, rounded: c * a / 255 */
+static inline uint8_t premultiply_u8(int c, int a)
+{
+	int t = c * a + 128;
+	return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+/* Scalar pixel for row tails, same math as the vector kernels */
+static inline void yuva_to_bgra_pixel(int y, int u, int v, int a, bool premultiply, uint8_t *bgra)
+{
+	int luma = yuv_term(y - 16, YUV_Y_COEFF) + 4;
+	u -= 128;
+	v -= 128;
+	uint8_t b = clamp_u8((luma + yuv_term(u, YUV_BU_COEFF)) >> 3);
+	uint8_t g = clamp_u8((luma - yuv_term(u, YUV_GU_COEFF) - yuv_term(v, YUV_GV_COEFF)) >> 3);
+	uint8_t r = clamp_u8((luma + yuv_term(v, YUV_RV_COEFF)) >> 3);
+	if (premultiply) {
+		b = premultiply_u8(b, a);
+		g = premultiply_u8(g, a);
+		r = premultiply_u8(r, a);
+	}
+	bgra[0] = b;
+	bgra[1] = g;
+	bgra[2] = r;
+	bgra[3] = (uint8_t)a;
+}
+
+/* 10- and 12-bit samples reduced to 8 bits with rounding */
+static inline int reduce_sample(uint16_t value, int depth)
+{
+	int max = (1 << depth) - 1;
+	int v = ((value > max ? max : value) + (1 << (depth - 9))) >> (depth - 8);
+	return v > 255 ? 255 : v;
+}
+
+static inline __m128i premultiply_sse42(__m128i c, __m128i a)
+{
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(c, a), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static inline __m256i premultiply_avx2(__m256i c, __m256i a)
+{
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(c, a), _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+/* 8 pixels of 16-bit Y, U, V and A (8-bit range) to 32 bytes of BGRA */
+static inline void yuva_to_bgra_8px_sse42(__m128i y, __m128i u, __m128i v, __m128i a,
+	bool premultiply, uint8_t *bgra)
+{
+	y = _mm_slli_epi16(_mm_sub_epi16(y, _mm_set1_epi16(16)), 7);
+	u = _mm_slli_epi16(_mm_sub_epi16(u, _mm_set1_epi16(128)), 7);
+	v = _mm_slli_epi16(_mm_sub_epi16(v, _mm_set1_epi16(128)), 7);
+	__m128i luma = _mm_add_epi16(_mm_mulhi_epi16(y, _mm_set1_epi16(YUV_Y_COEFF)), _mm_set1_epi16(4));
+	
+	__m128i r = _mm_add_epi16(luma, _mm_mulhi_epi16(v, _mm_set1_epi16(YUV_RV_COEFF)));
+	__m128i g = _mm_sub_epi16(_mm_sub_epi16(luma, _mm_mulhi_epi16(u, _mm_set1_epi16(YUV_GU_COEFF))),
+	                          _mm_mulhi_epi16(v, _mm_set1_epi16(YUV_GV_COEFF)));
+	__m128i b = _mm_add_epi16(luma, _mm_mulhi_epi16(u, _mm_set1_epi16(YUV_BU_COEFF)));
+	r = _mm_srai_epi16(r, 3);
+	g = _mm_srai_epi16(g, 3);
+	b = _mm_srai_epi16(b, 3);
+	
+	if (premultiply) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i max = _mm_set1_epi16(255);
+		r = premultiply_sse42(_mm_min_epi16(_mm_max_epi16(r, zero), max), a);
+		g = premultiply_sse42(_mm_min_epi16(_mm_max_epi16(g, zero), max), a);
+		b = premultiply_sse42(_mm_min_epi16(_mm_max_epi16(b, zero), max), a);
+	}
+	
+	/* b0..b7 r0..r7 and g0..g7 a0..a7, interleaved to BGRA */
+	__m128i br = _mm_packus_epi16(b, r);
+	__m128i ga = _mm_packus_epi16(g, a);
+	__m128i bg = _mm_unpacklo_epi8(br, ga);
+	__m128i ra = _mm_unpackhi_epi8(br, ga);
+	_mm_storeu_si128((__m128i*)bgra, _mm_unpacklo_epi16(bg, ra));
+	_mm_storeu_si128((__m128i*)(bgra + 16), _mm_unpackhi_epi16(bg, ra));
+}
+
+/* 16 pixels, as above, lane 0 holding pixels 0-7 and lane 1 pixels 8-15 */
+static inline void yuva_to_bgra_16px_avx2(__m256i y, __m256i u, __m256i v, __m256i a,
+	bool premultiply, uint8_t *bgra)
+{
+	y = _mm256_slli_epi16(_mm256_sub_epi16(y, _mm256_set1_epi16(16)), 7);
+	u = _mm256_slli_epi16(_mm256_sub_epi16(u, _mm256_set1_epi16(128)), 7);
+	v = _mm256_slli_epi16(_mm256_sub_epi16(v, _mm256_set1_epi16(128)), 7);
+	__m256i luma = _mm256_add_epi16(_mm256_mulhi_epi16(y, _mm256_set1_epi16(YUV_Y_COEFF)), _mm256_set1_epi16(4));
+	
+	__m256i r = _mm256_add_epi16(luma, _mm256_mulhi_epi16(v, _mm256_set1_epi16(YUV_RV_COEFF)));
+	__m256i g = _mm256_sub_epi16(_mm256_sub_epi16(luma, _mm256_mulhi_epi16(u, _mm256_set1_epi16(YUV_GU_COEFF))),
+	                             _mm256_mulhi_epi16(v, _mm256_set1_epi16(YUV_GV_COEFF)));
+	__m256i b = _mm256_add_epi16(luma, _mm256_mulhi_epi16(u, _mm256_set1_epi16(YUV_BU_COEFF)));
+	r = _mm256_srai_epi16(r, 3);
+	g = _mm256_srai_epi16(g, 3);
+	b = _mm256_srai_epi16(b, 3);
+	
+	if (premultiply) {
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i max = _mm256_set1_epi16(255);
+		r = premultiply_avx2(_mm256_min_epi16(_mm256_max_epi16(r, zero), max), a);
+		g = premultiply_avx2(_mm256_min_epi16(_mm256_max_epi16(g, zero), max), a);
+		b = premultiply_avx2(_mm256_min_epi16(_mm256_max_epi16(b, zero), max), a);
+	}
+	
+	/* Packs and unpacks stay within lanes, so each lane ends up with its own
+	 * 8 pixels in two halves that are put back in order on store */
+	__m256i br = _mm256_packus_epi16(b, r);
+	__m256i ga = _mm256_packus_epi16(g, a);
+	__m256i bg = _mm256_unpacklo_epi8(br, ga);
+	__m256i ra = _mm256_unpackhi_epi8(br, ga);
+	__m256i lo = _mm256_unpacklo_epi16(bg, ra);
+	__m256i hi = _mm256_unpackhi_epi16(bg, ra);
+	_mm256_storeu_si256((__m256i*)bgra, _mm256_permute2x128_si256(lo, hi, 0x20));
+	_mm256_storeu_si256((__m256i*)(bgra + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+/* 4 chroma samples each used for two pixels */
+static inline __m128i load_chroma8_x2_sse42(const uint8_t *c)
+{
+	int32_t bytes;
+	memcpy(&bytes, c, sizeof(bytes));
+	__m128i x = _mm_cvtepu8_epi16(_mm_cvtsi32_si128(bytes));
+	return _mm_unpacklo_epi16(x, x);
+}
+
+static inline __m256i load_chroma8_x2_avx2(const uint8_t *c)
+{
+	__m128i x = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)c));
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(x, x)),
+	                               _mm_unpackhi_epi16(x, x), 1);
+}
+
+/* High-depth samples to the 8-bit range: clamp, round, shift */
+static inline __m128i reduce_sse42(__m128i x, int depth)
+{
+	x = _mm_min_epu16(x, _mm_set1_epi16((short)((1 << depth) - 1)));
+	x = _mm_add_epi16(x, _mm_set1_epi16((short)(1 << (depth - 9))));
+	return _mm_min_epu16(_mm_srl_epi16(x, _mm_cvtsi32_si128(depth - 8)), _mm_set1_epi16(255));
+}
+
+static inline __m256i reduce_avx2(__m256i x, int depth)
+{
+	x = _mm256_min_epu16(x, _mm256_set1_epi16((short)((1 << depth) - 1)));
+	x = _mm256_add_epi16(x, _mm256_set1_epi16((short)(1 << (depth - 9))));
+	return _mm256_min_epu16(_mm256_srl_epi16(x, _mm_cvtsi32_si128(depth - 8)), _mm256_set1_epi16(255));
+}
+
+static inline __m128i load_chroma16_x2_sse42(const uint16_t *c)
+{
+	__m128i x = _mm_loadl_epi64((const __m128i*)c);
+	return _mm_unpacklo_epi16(x, x);
+}
+
+static inline __m256i load_chroma16_x2_avx2(const uint16_t *c)
+{
+	__m128i x = _mm_loadu_si128((const __m128i*)c);
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(x, x)),
+	                               _mm_unpackhi_epi16(x, x), 1);
+}
+
+/* One row of 8-bit planar YUV to BGRA. With half_chroma, U and V have one
+ * sample per two pixels (4:2:0 and 4:2:2 rows), otherwise one per pixel.
+ * Without an alpha plane the output is opaque */
+static void row8_to_bgra_sse42(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+	const uint8_t *a, uint8_t *bgra, int width, bool half_chroma, bool premultiply)
+{
+	int col = 0;
+	for (; col + 8 <= width; col += 8) {
+		__m128i yv = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(y + col)));
+		__m128i av = a ? _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(a + col))) : _mm_set1_epi16(255);
+		__m128i uv, vv;
+		if (half_chroma) {
+			uv = load_chroma8_x2_sse42(u + col / 2);
+			vv = load_chroma8_x2_sse42(v + col / 2);
+		} else {
+			uv = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(u + col)));
+			vv = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(v + col)));
+		}
+		yuva_to_bgra_8px_sse42(yv, uv, vv, av, premultiply, bgra + col * 4);
+	}
+	for (; col < width; col++) {
+		int c = half_chroma ? col / 2 : col;
+		yuva_to_bgra_pixel(y[col], u[c], v[c], a ? a[col] : 255, premultiply, bgra + col * 4);
+	}
+}
+
+static void row8_to_bgra_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+	const uint8_t *a, uint8_t *bgra, int width, bool half_chroma, bool premultiply)
+{
+	int col = 0;
+	for (; col + 16 <= width; col += 16) {
+		__m256i yv = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + col)));
+		__m256i av = a ? _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + col))) : _mm256_set1_epi16(255);
+		__m256i uv, vv;
+		if (half_chroma) {
+			uv = load_chroma8_x2_avx2(u + col / 2);
+			vv = load_chroma8_x2_avx2(v + col / 2);
+		} else {
+			uv = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(u + col)));
+			vv = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(v + col)));
+		}
+		yuva_to_bgra_16px_avx2(yv, uv, vv, av, premultiply, bgra + col * 4);
+	}
+	/* Chroma offset stays whole: col is a multiple of 16 here */
+	if (col < width) {
+		int c = half_chroma ? col / 2 : col;
+		row8_to_bgra_sse42(y + col, u + c, v + c, a ? a + col : NULL, bgra + col * 4,
+		                   width - col, half_chroma, premultiply);
+	}
+}
+
+/* One row of 10- or 12-bit planar YUV (little-endian, low bits) to BGRA */
+static void row16_to_bgra_sse42(const uint16_t *y, const uint16_t *u, const uint16_t *v,
+	const uint16_t *a, uint8_t *bgra, int width, bool half_chroma, int depth, bool premultiply)
+{
+	int col = 0;
+	for (; col + 8 <= width; col += 8) {
+		__m128i yv = reduce_sse42(_mm_loadu_si128((const __m128i*)(y + col)), depth);
+		__m128i av = a ? reduce_sse42(_mm_loadu_si128((const __m128i*)(a + col)), depth) : _mm_set1_epi16(255);
+		__m128i uv, vv;
+		if (half_chroma) {
+			uv = load_chroma16_x2_sse42(u + col / 2);
+			vv = load_chroma16_x2_sse42(v + col / 2);
+		} else {
+			uv = _mm_loadu_si128((const __m128i*)(u + col));
+			vv = _mm_loadu_si128((const __m128i*)(v + col));
+		}
+		yuva_to_bgra_8px_sse42(yv, reduce_sse42(uv, depth), reduce_sse42(vv, depth), av,
+		                       premultiply, bgra + col * 4);
+	}
+	for (; col < width; col++) {
+		int c = half_chroma ? col / 2 : col;
+		yuva_to_bgra_pixel(reduce_sample(y[col], depth), reduce_sample(u[c], depth),
+			reduce_sample(v[c], depth), a ? reduce_sample(a[col], depth) : 255,
+			premultiply, bgra + col * 4);
+	}
+}
+
+static void row16_to_bgra_avx2(const uint16_t *y, const uint16_t *u, const uint16_t *v,
+	const uint16_t *a, uint8_t *bgra, int width, bool half_chroma, int depth, bool premultiply)
+{
+	int col = 0;
+	for (; col + 16 <= width; col += 16) {
+		__m256i yv = reduce_avx2(_mm256_loadu_si256((const __m256i*)(y + col)), depth);
+		__m256i av = a ? reduce_avx2(_mm256_loadu_si256((const __m256i*)(a + col)), depth) : _mm256_set1_epi16(255);
+		__m256i uv, vv;
+		if (half_chroma) {
+			uv = load_chroma16_x2_avx2(u + col / 2);
+			vv = load_chroma16_x2_avx2(v + col / 2);
+		} else {
+			uv = _mm256_loadu_si256((const __m256i*)(u + col));
+			vv = _mm256_loadu_si256((const __m256i*)(v + col));
+		}
+		yuva_to_bgra_16px_avx2(yv, reduce_avx2(uv, depth), reduce_avx2(vv, depth), av,
+		                       premultiply, bgra + col * 4);
+	}
+	if (col < width) {
+		int c = half_chroma ? col / 2 : col;
+		row16_to_bgra_sse42(y + col, u + c, v + c, a ? a + col : NULL, bgra + col * 4,
+		                    width - col, half_chroma, depth, premultiply);
+	}
+}
+
+/* Plane walkers. chroma_rows_shift is 1 for 4:2:0 (a chroma row per two
+ * luma rows), 0 for 4:2:2 and 4:4:4. a may be NULL. 16-bit strides are in
+ * bytes, as in AVFrame.linesize */
+typedef void (*row8_func)(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+	const uint8_t *a, uint8_t *bgra, int width, bool half_chroma, bool premultiply);
+typedef void (*row16_func)(const uint16_t *y, const uint16_t *u, const uint16_t *v,
+	const uint16_t *a, uint8_t *bgra, int width, bool half_chroma, int depth, bool premultiply);
+
+static void planar8_to_bgra(row8_func row_func,
     const uint8_t* y, int y_stride,
     const uint8_t* u, int u_stride,
     const uint8_t* v, int v_stride,
+    const uint8_t* a, int a_stride,
     uint8_t* bgra, int bgra_stride,
-    int width, int height)
+    int width, int height, bool half_chroma, int chroma_rows_shift, bool premultiply)
 {
-	/* Constants for YUV to RGB conversion */
-	const __m128i y_offset = _mm_set1_epi16(16);
-	const __m128i uv_offset = _mm_set1_epi16(128);
-	const __m128i y_coeff = _mm_set1_epi16(74);  /* 1.164 * 64 */
-	const __m128i rv_coeff = _mm_set1_epi16(102); /* 1.596 * 64 */
-	const __m128i gu_coeff = _mm_set1_epi16(25);  /* 0.391 * 64 */
-	const __m128i gv_coeff = _mm_set1_epi16(52);  /* 0.813 * 64 */
-	const __m128i bu_coeff = _mm_set1_epi16(129); /* 2.018 * 64 */
-	const __m128i alpha = _mm_set1_epi8(255);
-	const __m128i zero = _mm_setzero_si128();
+	for (int row = 0; row < height; row++) {
+		int crow = row >> chroma_rows_shift;
+		row_func(y + (size_t)row * y_stride,
+		         u + (size_t)crow * u_stride,
+		         v + (size_t)crow * v_stride,
+		         a ? a + (size_t)row * a_stride : NULL,
+		         bgra + (size_t)row * bgra_stride, width, half_chroma, premultiply);
+	}
+}
 
-	for (int row = 0; row < height; row += 2) {
-		for (int col = 0; col < width; col += 16) {
-			/* Load Y values (16 pixels from 2 rows) */
-			__m128i y0 = _mm_loadu_si128((__m128i*)(y + col));
-			__m128i y1 = _mm_loadu_si128((__m128i*)(y + y_stride + col));
-			
-			/* Load U and V values (8 values each, shared by 2x2 blocks) */
-			__m128i u_vals = _mm_loadl_epi64((__m128i*)(u + col/2));
-			__m128i v_vals = _mm_loadl_epi64((__m128i*)(v + col/2));
-			
-			/* Expand U and V to 16-bit */
-			u_vals = _mm_cvtepu8_epi16(u_vals);
-			v_vals = _mm_cvtepu8_epi16(v_vals);
-			
-			/* Subtract offsets */
-			u_vals = _mm_sub_epi16(u_vals, uv_offset);
-			v_vals = _mm_sub_epi16(v_vals, uv_offset);
-			
-			/* Calculate color difference values */
-			__m128i rv = _mm_mullo_epi16(v_vals, rv_coeff);
-			__m128i gu = _mm_mullo_epi16(u_vals, gu_coeff);
-			__m128i gv = _mm_mullo_epi16(v_vals, gv_coeff);
-			__m128i bu = _mm_mullo_epi16(u_vals, bu_coeff);
-			
-			/* Process first 8 pixels of row 0 */
-			__m128i y00 = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i*)(y + col)));
-			y00 = _mm_sub_epi16(y00, y_offset);
-			y00 = _mm_mullo_epi16(y00, y_coeff);
-			
-			/* Calculate RGB values */
-			__m128i r0 = _mm_add_epi16(y00, rv);
-			__m128i g0 = _mm_sub_epi16(y00, _mm_add_epi16(gu, gv));
-			__m128i b0 = _mm_add_epi16(y00, bu);
-			
-			/* Shift right by 6 (divide by 64) and saturate to uint8 */
-			r0 = _mm_srai_epi16(r0, 6);
-			g0 = _mm_srai_epi16(g0, 6);
-			b0 = _mm_srai_epi16(b0, 6);
-			
-			/* Pack to 8-bit with saturation */
-			r0 = _mm_packus_epi16(r0, zero);
-			g0 = _mm_packus_epi16(g0, zero);
-			b0 = _mm_packus_epi16(b0, zero);
-			
-			/* Interleave BGRA */
-			__m128i bg0 = _mm_unpacklo_epi8(b0, g0);
-			__m128i ra0 = _mm_unpacklo_epi8(r0, alpha);
-			__m128i bgra0 = _mm_unpacklo_epi16(bg0, ra0);
-			__m128i bgra1 = _mm_unpackhi_epi16(bg0, ra0);
-			
-			/* Store BGRA pixels */
-			_mm_storeu_si128((__m128i*)(bgra + col*4), bgra0);
-			_mm_storeu_si128((__m128i*)(bgra + col*4 + 16), bgra1);
-			
-			/* Process remaining pixels similarly... */
-			/* For brevity, showing simplified version - full implementation would handle all pixels */
-		}
-		
-		y += y_stride * 2;
-		u += u_stride;
-		v += v_stride;
-		bgra += bgra_stride * 2;
+static void planar16_to_bgra(row16_func row_func,
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    const uint16_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool half_chroma, int depth, bool premultiply)
+{
+	const uint8_t *y_row = (const uint8_t*)y;
+	const uint8_t *u_row = (const uint8_t*)u;
+	const uint8_t *v_row = (const uint8_t*)v;
+	const uint8_t *a_row = (const uint8_t*)a;
+	
+	for (int row = 0; row < height; row++) {
+		row_func((const uint16_t*)y_row, (const uint16_t*)u_row, (const uint16_t*)v_row,
+		         (const uint16_t*)a_row, bgra, width, half_chroma, depth, premultiply);
+		y_row += y_stride;
+		u_row += u_stride;
+		v_row += v_stride;
+		if (a_row)
+			a_row += a_stride;
+		bgra += bgra_stride;
 	}
 }
 
-/* AVX2 implementation for YUV420 to BGRA - processes 32 pixels at once */
+/* YUV420 to BGRA - SSE4.2 */
+void yuv420_to_bgra_sse42(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	planar8_to_bgra(row8_to_bgra_sse42, y, y_stride, u, u_stride, v, v_stride, NULL, 0,
+	                bgra, bgra_stride, width, height, true, 1, false);
+}
+
+/* YUV420 to BGRA - AVX2, 16 pixels at once */
 void yuv420_to_bgra_avx2(
     const uint8_t* y, int y_stride,
     const uint8_t* u, int u_stride,
@@ -131,43 +393,295 @@ void yuv420_to_bgra_avx2(
     uint8_t* bgra, int bgra_stride,
     int width, int height)
 {
-	/* Constants for YUV to RGB conversion */
-	const __m256i y_offset = _mm256_set1_epi16(16);
-	const __m256i uv_offset = _mm256_set1_epi16(128);
-	const __m256i y_coeff = _mm256_set1_epi16(74);
-	const __m256i rv_coeff = _mm256_set1_epi16(102);
-	const __m256i gu_coeff = _mm256_set1_epi16(25);
-	const __m256i gv_coeff = _mm256_set1_epi16(52);
-	const __m256i bu_coeff = _mm256_set1_epi16(129);
-	const __m256i alpha = _mm256_set1_epi8(255);
+	planar8_to_bgra(row8_to_bgra_avx2, y, y_stride, u, u_stride, v, v_stride, NULL, 0,
+	                bgra, bgra_stride, width, height, true, 1, false);
+}
+
+/* YUV422 to BGRA - SSE4.2 */
+void yuv422_to_bgra_sse42(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	planar8_to_bgra(row8_to_bgra_sse42, y, y_stride, u, u_stride, v, v_stride, NULL, 0,
+	                bgra, bgra_stride, width, height, true, 0, false);
+}
+
+/* YUV422 to BGRA - AVX2 */
+void yuv422_to_bgra_avx2(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	planar8_to_bgra(row8_to_bgra_avx2, y, y_stride, u, u_stride, v, v_stride, NULL, 0,
+	                bgra, bgra_stride, width, height, true, 0, false);
+}
+
+/* YUV444 to BGRA - SSE4.2 */
+void yuv444_to_bgra_sse42(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	planar8_to_bgra(row8_to_bgra_sse42, y, y_stride, u, u_stride, v, v_stride, NULL, 0,
+	                bgra, bgra_stride, width, height, false, 0, false);
+}
+
+/* YUV444 to BGRA - AVX2 */
+void yuv444_to_bgra_avx2(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	planar8_to_bgra(row8_to_bgra_avx2, y, y_stride, u, u_stride, v, v_stride, NULL, 0,
+	                bgra, bgra_stride, width, height, false, 0, false);
+}
+
+/* YUV422P10 to BGRA - SSE4.2 */
+void yuv422p10_to_bgra_sse42(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	planar16_to_bgra(row16_to_bgra_sse42, y, y_stride, u, u_stride, v, v_stride, NULL, 0,
+	                 bgra, bgra_stride, width, height, true, 10, false);
+}
+
+/* YUV422P10 to BGRA - AVX2 */
+void yuv422p10_to_bgra_avx2(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	planar16_to_bgra(row16_to_bgra_avx2, y, y_stride, u, u_stride, v, v_stride, NULL, 0,
+	                 bgra, bgra_stride, width, height, true, 10, false);
+}
+
+/* YUV444P10 to BGRA - SSE4.2 */
+void yuv444p10_to_bgra_sse42(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	planar16_to_bgra(row16_to_bgra_sse42, y, y_stride, u, u_stride, v, v_stride, NULL, 0,
+	                 bgra, bgra_stride, width, height, false, 10, false);
+}
+
+/* YUV444P10 to BGRA - AVX2 */
+void yuv444p10_to_bgra_avx2(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	planar16_to_bgra(row16_to_bgra_avx2, y, y_stride, u, u_stride, v, v_stride, NULL, 0,
+	                 bgra, bgra_stride, width, height, false, 10, false);
+}
+
+/* YUVA420 to BGRA, straight or premultiplied alpha - SSE4.2 */
+void yuva420_to_bgra_sse42(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    const uint8_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply)
+{
+	planar8_to_bgra(row8_to_bgra_sse42, y, y_stride, u, u_stride, v, v_stride, a, a_stride,
+	                bgra, bgra_stride, width, height, true, 1, premultiply);
+}
+
+/* YUVA420 to BGRA - AVX2 */
+void yuva420_to_bgra_avx2(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    const uint8_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply)
+{
+	planar8_to_bgra(row8_to_bgra_avx2, y, y_stride, u, u_stride, v, v_stride, a, a_stride,
+	                bgra, bgra_stride, width, height, true, 1, premultiply);
+}
+
+/* YUVA444 to BGRA - SSE4.2 */
+void yuva444_to_bgra_sse42(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    const uint8_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply)
+{
+	planar8_to_bgra(row8_to_bgra_sse42, y, y_stride, u, u_stride, v, v_stride, a, a_stride,
+	                bgra, bgra_stride, width, height, false, 0, premultiply);
+}
+
+/* YUVA444 to BGRA - AVX2 */
+void yuva444_to_bgra_avx2(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    const uint8_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply)
+{
+	planar8_to_bgra(row8_to_bgra_avx2, y, y_stride, u, u_stride, v, v_stride, a, a_stride,
+	                bgra, bgra_stride, width, height, false, 0, premultiply);
+}
+
+/* YUVA444P10 to BGRA - SSE4.2 */
+void yuva444p10_to_bgra_sse42(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    const uint16_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply)
+{
+	planar16_to_bgra(row16_to_bgra_sse42, y, y_stride, u, u_stride, v, v_stride, a, a_stride,
+	                 bgra, bgra_stride, width, height, false, 10, premultiply);
+}
+
+/* YUVA444P10 to BGRA - AVX2 */
+void yuva444p10_to_bgra_avx2(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    const uint16_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply)
+{
+	planar16_to_bgra(row16_to_bgra_avx2, y, y_stride, u, u_stride, v, v_stride, a, a_stride,
+	                 bgra, bgra_stride, width, height, false, 10, premultiply);
+}
+
+/* YUVA444P12 to BGRA - SSE4.2 */
+void yuva444p12_to_bgra_sse42(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    const uint16_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply)
+{
+	planar16_to_bgra(row16_to_bgra_sse42, y, y_stride, u, u_stride, v, v_stride, a, a_stride,
+	                 bgra, bgra_stride, width, height, false, 12, premultiply);
+}
+
+/* YUVA444P12 to BGRA - AVX2 */
+void yuva444p12_to_bgra_avx2(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    const uint16_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply)
+{
+	planar16_to_bgra(row16_to_bgra_avx2, y, y_stride, u, u_stride, v, v_stride, a, a_stride,
+	                 bgra, bgra_stride, width, height, false, 12, premultiply);
+}
+
+/* ARGB to BGRA, a byte swap per pixel - SSE4.2 */
+void argb_to_bgra_sse42(
+    const uint8_t* argb, int argb_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	const __m128i swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
 	
-	for (int row = 0; row < height; row += 2) {
-		for (int col = 0; col < width; col += 32) {
-			/* Load 32 Y values from 2 rows */
-			__m256i y0 = _mm256_loadu_si256((__m256i*)(y + col));
-			__m256i y1 = _mm256_loadu_si256((__m256i*)(y + y_stride + col));
-			
-			/* Load 16 U and V values (for 32 pixels in 2x2 blocks) */
-			__m128i u_vals_128 = _mm_loadu_si128((__m128i*)(u + col/2));
-			__m128i v_vals_128 = _mm_loadu_si128((__m128i*)(v + col/2));
-			
-			/* Expand to 256-bit */
-			__m256i u_vals = _mm256_cvtepu8_epi16(u_vals_128);
-			__m256i v_vals = _mm256_cvtepu8_epi16(v_vals_128);
-			
-			/* Process color conversion with AVX2 for much better throughput */
-			/* ... Full implementation would be here ... */
-			
-			/* For now, fallback to SSE version for simplicity */
-			yuv420_to_bgra_sse42(y, y_stride, u, u_stride, v, v_stride,
-			                      bgra, bgra_stride, width, height);
-			return;
+	for (int row = 0; row < height; row++) {
+		const uint8_t *s = argb + (size_t)row * argb_stride;
+		uint8_t *d = bgra + (size_t)row * bgra_stride;
+		int col = 0;
+		for (; col + 4 <= width; col += 4) {
+			__m128i px = _mm_loadu_si128((const __m128i*)(s + col * 4));
+			_mm_storeu_si128((__m128i*)(d + col * 4), _mm_shuffle_epi8(px, swap));
 		}
-		
-		y += y_stride * 2;
-		u += u_stride;
-		v += v_stride;
-		bgra += bgra_stride * 2;
+		for (; col < width; col++) {
+			d[col * 4 + 0] = s[col * 4 + 3];
+			d[col * 4 + 1] = s[col * 4 + 2];
+			d[col * 4 + 2] = s[col * 4 + 1];
+			d[col * 4 + 3] = s[col * 4 + 0];
+		}
+	}
+}
+
+/* ARGB to BGRA - AVX2 */
+void argb_to_bgra_avx2(
+    const uint8_t* argb, int argb_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height)
+{
+	const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+	                                      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	
+	for (int row = 0; row < height; row++) {
+		const uint8_t *s = argb + (size_t)row * argb_stride;
+		uint8_t *d = bgra + (size_t)row * bgra_stride;
+		int col = 0;
+		for (; col + 8 <= width; col += 8) {
+			__m256i px = _mm256_loadu_si256((const __m256i*)(s + col * 4));
+			_mm256_storeu_si256((__m256i*)(d + col * 4), _mm256_shuffle_epi8(px, swap));
+		}
+		if (col < width)
+			argb_to_bgra_sse42(s + col * 4, argb_stride, d + col * 4, bgra_stride, width - col, 1);
+	}
+}
+
+/* 10-bit plane to 12-bit (I412 and other 12-bit OBS formats): x << 2 */
+void plane10_to_12_sse42(
+    const uint16_t* src, int src_stride,
+    uint16_t* dst, int dst_stride,
+    int width, int height)
+{
+	const __m128i max10 = _mm_set1_epi16(1023);
+	
+	for (int row = 0; row < height; row++) {
+		const uint16_t *s = (const uint16_t*)((const uint8_t*)src + (size_t)row * src_stride);
+		uint16_t *d = (uint16_t*)((uint8_t*)dst + (size_t)row * dst_stride);
+		int col = 0;
+		for (; col + 8 <= width; col += 8) {
+			__m128i x = _mm_min_epu16(_mm_loadu_si128((const __m128i*)(s + col)), max10);
+			_mm_storeu_si128((__m128i*)(d + col), _mm_slli_epi16(x, 2));
+		}
+		for (; col < width; col++)
+			d[col] = (uint16_t)((s[col] > 1023 ? 1023 : s[col]) << 2);
+	}
+}
+
+void plane10_to_12_avx2(
+    const uint16_t* src, int src_stride,
+    uint16_t* dst, int dst_stride,
+    int width, int height)
+{
+	const __m256i max10 = _mm256_set1_epi16(1023);
+	
+	for (int row = 0; row < height; row++) {
+		const uint16_t *s = (const uint16_t*)((const uint8_t*)src + (size_t)row * src_stride);
+		uint16_t *d = (uint16_t*)((uint8_t*)dst + (size_t)row * dst_stride);
+		int col = 0;
+		for (; col + 16 <= width; col += 16) {
+			__m256i x = _mm256_min_epu16(_mm256_loadu_si256((const __m256i*)(s + col)), max10);
+			_mm256_storeu_si256((__m256i*)(d + col), _mm256_slli_epi16(x, 2));
+		}
+		for (; col < width; col++)
+			d[col] = (uint16_t)((s[col] > 1023 ? 1023 : s[col]) << 2);
 	}
 }
 
@@ -254,4 +768,174 @@ nv12_convert_func simd_get_best_nv12_converter(void)
 	}
 	
 	return best_converter;
-}
\ No newline at end of file
+}
+
+yuv_convert_func simd_get_best_yuv422_converter(void)
+{
+	static yuv_convert_func best_converter = NULL;
+	
+	if (!best_converter) {
+		if (simd_check_avx2()) {
+			blog(LOG_INFO, "Using AVX2 optimized YUV422 converter");
+			best_converter = yuv422_to_bgra_avx2;
+		} else if (simd_check_sse42()) {
+			blog(LOG_INFO, "Using SSE4.2 optimized YUV422 converter");
+			best_converter = yuv422_to_bgra_sse42;
+		}
+	}
+	
+	return best_converter;
+}
+
+yuv_convert_func simd_get_best_yuv444_converter(void)
+{
+	static yuv_convert_func best_converter = NULL;
+	
+	if (!best_converter) {
+		if (simd_check_avx2()) {
+			blog(LOG_INFO, "Using AVX2 optimized YUV444 converter");
+			best_converter = yuv444_to_bgra_avx2;
+		} else if (simd_check_sse42()) {
+			blog(LOG_INFO, "Using SSE4.2 optimized YUV444 converter");
+			best_converter = yuv444_to_bgra_sse42;
+		}
+	}
+	
+	return best_converter;
+}
+
+yuv10_convert_func simd_get_best_yuv422p10_converter(void)
+{
+	static yuv10_convert_func best_converter = NULL;
+	
+	if (!best_converter) {
+		if (simd_check_avx2()) {
+			blog(LOG_INFO, "Using AVX2 optimized YUV422P10 converter");
+			best_converter = yuv422p10_to_bgra_avx2;
+		} else if (simd_check_sse42()) {
+			blog(LOG_INFO, "Using SSE4.2 optimized YUV422P10 converter");
+			best_converter = yuv422p10_to_bgra_sse42;
+		}
+	}
+	
+	return best_converter;
+}
+
+yuv10_convert_func simd_get_best_yuv444p10_converter(void)
+{
+	static yuv10_convert_func best_converter = NULL;
+	
+	if (!best_converter) {
+		if (simd_check_avx2()) {
+			blog(LOG_INFO, "Using AVX2 optimized YUV444P10 converter");
+			best_converter = yuv444p10_to_bgra_avx2;
+		} else if (simd_check_sse42()) {
+			blog(LOG_INFO, "Using SSE4.2 optimized YUV444P10 converter");
+			best_converter = yuv444p10_to_bgra_sse42;
+		}
+	}
+	
+	return best_converter;
+}
+
+plane_repack_func simd_get_best_10_to_12_repack(void)
+{
+	static plane_repack_func best_repack = NULL;
+	
+	if (!best_repack) {
+		if (simd_check_avx2()) {
+			blog(LOG_INFO, "Using AVX2 optimized 10-bit to 12-bit repack");
+			best_repack = plane10_to_12_avx2;
+		} else if (simd_check_sse42()) {
+			blog(LOG_INFO, "Using SSE4.2 optimized 10-bit to 12-bit repack");
+			best_repack = plane10_to_12_sse42;
+		}
+	}
+	
+	return best_repack;
+}
+
+yuva_convert_func simd_get_best_yuva420_converter(void)
+{
+	static yuva_convert_func best_converter = NULL;
+	
+	if (!best_converter) {
+		if (simd_check_avx2()) {
+			blog(LOG_INFO, "Using AVX2 optimized YUVA420 converter");
+			best_converter = yuva420_to_bgra_avx2;
+		} else if (simd_check_sse42()) {
+			blog(LOG_INFO, "Using SSE4.2 optimized YUVA420 converter");
+			best_converter = yuva420_to_bgra_sse42;
+		}
+	}
+	
+	return best_converter;
+}
+
+yuva_convert_func simd_get_best_yuva444_converter(void)
+{
+	static yuva_convert_func best_converter = NULL;
+	
+	if (!best_converter) {
+		if (simd_check_avx2()) {
+			blog(LOG_INFO, "Using AVX2 optimized YUVA444 converter");
+			best_converter = yuva444_to_bgra_avx2;
+		} else if (simd_check_sse42()) {
+			blog(LOG_INFO, "Using SSE4.2 optimized YUVA444 converter");
+			best_converter = yuva444_to_bgra_sse42;
+		}
+	}
+	
+	return best_converter;
+}
+
+yuva16_convert_func simd_get_best_yuva444p10_converter(void)
+{
+	static yuva16_convert_func best_converter = NULL;
+	
+	if (!best_converter) {
+		if (simd_check_avx2()) {
+			blog(LOG_INFO, "Using AVX2 optimized YUVA444P10 converter");
+			best_converter = yuva444p10_to_bgra_avx2;
+		} else if (simd_check_sse42()) {
+			blog(LOG_INFO, "Using SSE4.2 optimized YUVA444P10 converter");
+			best_converter = yuva444p10_to_bgra_sse42;
+		}
+	}
+	
+	return best_converter;
+}
+
+yuva16_convert_func simd_get_best_yuva444p12_converter(void)
+{
+	static yuva16_convert_func best_converter = NULL;
+	
+	if (!best_converter) {
+		if (simd_check_avx2()) {
+			blog(LOG_INFO, "Using AVX2 optimized YUVA444P12 converter");
+			best_converter = yuva444p12_to_bgra_avx2;
+		} else if (simd_check_sse42()) {
+			blog(LOG_INFO, "Using SSE4.2 optimized YUVA444P12 converter");
+			best_converter = yuva444p12_to_bgra_sse42;
+		}
+	}
+	
+	return best_converter;
+}
+
+packed_convert_func simd_get_best_argb_converter(void)
+{
+	static packed_convert_func best_converter = NULL;
+	
+	if (!best_converter) {
+		if (simd_check_avx2()) {
+			blog(LOG_INFO, "Using AVX2 optimized ARGB converter");
+			best_converter = argb_to_bgra_avx2;
+		} else if (simd_check_sse42()) {
+			blog(LOG_INFO, "Using SSE4.2 optimized ARGB converter");
+			best_converter = argb_to_bgra_sse42;
+		}
+	}
+	
+	return best_converter;
+}
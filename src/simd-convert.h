@@ -34,6 +34,153 @@ void yuv420_to_bgra_avx2(
     uint8_t* bgra, int bgra_stride,
     int width, int height);
 
+/* YUV422 and YUV444 to BGRA conversion functions */
+void yuv422_to_bgra_sse42(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+void yuv422_to_bgra_avx2(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+void yuv444_to_bgra_sse42(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+void yuv444_to_bgra_avx2(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+/* 10-bit YUV422 and YUV444 to BGRA conversion functions
+ * Samples are little-endian in the low 10 bits, strides in bytes */
+void yuv422p10_to_bgra_sse42(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+void yuv422p10_to_bgra_avx2(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+void yuv444p10_to_bgra_sse42(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+void yuv444p10_to_bgra_avx2(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+/* YUVA to BGRA conversion functions, alpha taken from the A plane and
+ * written straight or with the color premultiplied by it */
+void yuva420_to_bgra_sse42(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    const uint8_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply);
+
+void yuva420_to_bgra_avx2(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    const uint8_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply);
+
+void yuva444_to_bgra_sse42(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    const uint8_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply);
+
+void yuva444_to_bgra_avx2(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    const uint8_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply);
+
+void yuva444p10_to_bgra_sse42(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    const uint16_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply);
+
+void yuva444p10_to_bgra_avx2(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    const uint16_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply);
+
+void yuva444p12_to_bgra_sse42(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    const uint16_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply);
+
+void yuva444p12_to_bgra_avx2(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    const uint16_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply);
+
+/* ARGB (QuickTime RLE, Animation) to BGRA */
+void argb_to_bgra_sse42(
+    const uint8_t* argb, int argb_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+void argb_to_bgra_avx2(
+    const uint8_t* argb, int argb_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+/* 10-bit plane repacked as 12-bit for OBS (I412), strides in bytes */
+void plane10_to_12_sse42(
+    const uint16_t* src, int src_stride,
+    uint16_t* dst, int dst_stride,
+    int width, int height);
+
+void plane10_to_12_avx2(
+    const uint16_t* src, int src_stride,
+    uint16_t* dst, int dst_stride,
+    int width, int height);
+
 /* NV12 to BGRA conversion functions */
 void nv12_to_bgra_sse42(
     const uint8_t* y, int y_stride,
@@ -63,4 +210,53 @@ typedef void (*nv12_convert_func)(
     uint8_t* bgra, int bgra_stride,
     int width, int height);
 
-nv12_convert_func simd_get_best_nv12_converter(void);
\ No newline at end of file
+nv12_convert_func simd_get_best_nv12_converter(void);
+
+yuv_convert_func simd_get_best_yuv422_converter(void);
+yuv_convert_func simd_get_best_yuv444_converter(void);
+
+typedef void (*yuv10_convert_func)(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+yuv10_convert_func simd_get_best_yuv422p10_converter(void);
+yuv10_convert_func simd_get_best_yuv444p10_converter(void);
+
+typedef void (*plane_repack_func)(
+    const uint16_t* src, int src_stride,
+    uint16_t* dst, int dst_stride,
+    int width, int height);
+
+plane_repack_func simd_get_best_10_to_12_repack(void);
+
+typedef void (*yuva_convert_func)(
+    const uint8_t* y, int y_stride,
+    const uint8_t* u, int u_stride,
+    const uint8_t* v, int v_stride,
+    const uint8_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply);
+
+yuva_convert_func simd_get_best_yuva420_converter(void);
+yuva_convert_func simd_get_best_yuva444_converter(void);
+
+typedef void (*yuva16_convert_func)(
+    const uint16_t* y, int y_stride,
+    const uint16_t* u, int u_stride,
+    const uint16_t* v, int v_stride,
+    const uint16_t* a, int a_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height, bool premultiply);
+
+yuva16_convert_func simd_get_best_yuva444p10_converter(void);
+yuva16_convert_func simd_get_best_yuva444p12_converter(void);
+
+typedef void (*packed_convert_func)(
+    const uint8_t* src, int src_stride,
+    uint8_t* bgra, int bgra_stride,
+    int width, int height);
+
+packed_convert_func simd_get_best_argb_converter(void);
\ No newline at end of file
@@ -0,0 +1,241 @@
+/*
+ * Stream parameter cache implementation
+ */
+
+#include "stream-cache.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <sys/stat.h>
+#include <string.h>
+
+#define blog(level, format, ...) \
+	blog(level, "[Stream Cache] " format, ##__VA_ARGS__)
+
+/* Files remembered, least recently used entries are replaced */
+#define STREAM_CACHE_SIZE 128
+
+struct cached_stream {
+	AVCodecParameters *par;
+	AVRational time_base;
+	AVRational avg_frame_rate;
+	AVRational r_frame_rate;
+	AVRational sample_aspect_ratio;
+	int64_t start_time;
+	int64_t duration;
+};
+
+struct stream_cache_entry {
+	char *path;                    /* NULL = empty slot */
+	int64_t file_size;
+	int64_t mtime;
+	const AVInputFormat *iformat;  /* Static data in libavformat */
+	int64_t start_time;
+	int64_t duration;
+	int64_t bit_rate;
+	unsigned int nb_streams;
+	struct cached_stream *streams;
+	uint64_t last_used;
+};
+
+static pthread_mutex_t g_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct stream_cache_entry g_entries[STREAM_CACHE_SIZE];
+static uint64_t g_use_counter = 0;
+
+static bool get_file_identity(const char *path, int64_t *size, int64_t *mtime)
+{
+	struct stat st;
+	if (os_stat(path, &st) != 0)
+		return false;
+
+	/* st_size is 32-bit on Windows */
+	*size = os_get_file_size(path);
+	*mtime = (int64_t)st.st_mtime;
+	return *size >= 0;
+}
+
+static void free_entry(struct stream_cache_entry *e)
+{
+	for (unsigned int i = 0; e->streams && i < e->nb_streams; i++)
+		avcodec_parameters_free(&e->streams[i].par);
+	bfree(e->streams);
+	bfree(e->path);
+	memset(e, 0, sizeof(*e));
+}
+
+/* Entry for the file as it is on disk now. Stale entries are dropped */
+static struct stream_cache_entry *find_entry(const char *path)
+{
+	for (int i = 0; i < STREAM_CACHE_SIZE; i++) {
+		struct stream_cache_entry *e = &g_entries[i];
+		if (!e->path || strcmp(e->path, path) != 0)
+			continue;
+
+		int64_t size, mtime;
+		if (!get_file_identity(path, &size, &mtime) || size != e->file_size || mtime != e->mtime) {
+			blog(LOG_DEBUG, "%s changed on disk, probing again", path);
+			free_entry(e);
+			return NULL;
+		}
+
+		e->last_used = ++g_use_counter;
+		return e;
+	}
+	return NULL;
+}
+
+const AVInputFormat *stream_cache_get_input_format(const char *path)
+{
+	if (!path)
+		return NULL;
+
+	pthread_mutex_lock(&g_cache_mutex);
+	struct stream_cache_entry *e = find_entry(path);
+	const AVInputFormat *iformat = e ? e->iformat : NULL;
+	pthread_mutex_unlock(&g_cache_mutex);
+	return iformat;
+}
+
+/* Whatever the header already says has to agree with the probed values */
+static bool stream_matches(const AVStream *st, const struct cached_stream *cs)
+{
+	const AVCodecParameters *a = st->codecpar;
+	const AVCodecParameters *b = cs->par;
+
+	if (a->codec_type != b->codec_type || a->codec_id != b->codec_id)
+		return false;
+	if (av_cmp_q(st->time_base, cs->time_base) != 0)
+		return false;
+	if (a->extradata_size && a->extradata_size != b->extradata_size)
+		return false;
+
+	if (a->codec_type == AVMEDIA_TYPE_VIDEO)
+		return (!a->width || a->width == b->width) && (!a->height || a->height == b->height);
+	if (a->codec_type == AVMEDIA_TYPE_AUDIO)
+		return !a->sample_rate || a->sample_rate == b->sample_rate;
+	return true;
+}
+
+bool stream_cache_apply(const char *path, AVFormatContext *ctx)
+{
+	if (!path || !ctx)
+		return false;
+
+	pthread_mutex_lock(&g_cache_mutex);
+
+	struct stream_cache_entry *e = find_entry(path);
+	bool valid = e && ctx->nb_streams == e->nb_streams && ctx->iformat == e->iformat;
+
+	for (unsigned int i = 0; valid && i < ctx->nb_streams; i++)
+		valid = stream_matches(ctx->streams[i], &e->streams[i]);
+
+	if (!valid) {
+		if (e) {
+			/* Replaced by the full probe that follows */
+			blog(LOG_INFO, "Cached parameters for %s don't match its header, probing", path);
+			free_entry(e);
+		}
+		pthread_mutex_unlock(&g_cache_mutex);
+		return false;
+	}
+
+	for (unsigned int i = 0; i < ctx->nb_streams; i++) {
+		AVStream *st = ctx->streams[i];
+		const struct cached_stream *cs = &e->streams[i];
+
+		avcodec_parameters_copy(st->codecpar, cs->par);
+		st->avg_frame_rate = cs->avg_frame_rate;
+		st->r_frame_rate = cs->r_frame_rate;
+		if (!st->sample_aspect_ratio.num)
+			st->sample_aspect_ratio = cs->sample_aspect_ratio;
+		if (st->start_time == AV_NOPTS_VALUE)
+			st->start_time = cs->start_time;
+		if (st->duration == AV_NOPTS_VALUE || st->duration <= 0)
+			st->duration = cs->duration;
+	}
+
+	ctx->start_time = e->start_time;
+	ctx->duration = e->duration;
+	ctx->bit_rate = e->bit_rate;
+
+	pthread_mutex_unlock(&g_cache_mutex);
+	return true;
+}
+
+void stream_cache_store(const char *path, const AVFormatContext *ctx)
+{
+	if (!path || !ctx || !ctx->iformat || !ctx->nb_streams)
+		return;
+
+	int64_t size, mtime;
+	if (!get_file_identity(path, &size, &mtime))
+		return;
+
+	pthread_mutex_lock(&g_cache_mutex);
+
+	/* Reuse the file's slot, else an empty or the least recently used one */
+	struct stream_cache_entry *e = NULL;
+	for (int i = 0; i < STREAM_CACHE_SIZE; i++) {
+		struct stream_cache_entry *c = &g_entries[i];
+		if (c->path && strcmp(c->path, path) == 0) {
+			e = c;
+			break;
+		}
+		if (!e || (e->path && (!c->path || c->last_used < e->last_used)))
+			e = c;
+	}
+	free_entry(e);
+
+	e->path = bstrdup(path);
+	e->file_size = size;
+	e->mtime = mtime;
+	e->iformat = ctx->iformat;
+	e->start_time = ctx->start_time;
+	e->duration = ctx->duration;
+	e->bit_rate = ctx->bit_rate;
+	e->nb_streams = ctx->nb_streams;
+	e->streams = bzalloc(sizeof(struct cached_stream) * ctx->nb_streams);
+	e->last_used = ++g_use_counter;
+
+	for (unsigned int i = 0; i < ctx->nb_streams; i++) {
+		const AVStream *st = ctx->streams[i];
+		struct cached_stream *cs = &e->streams[i];
+
+		cs->par = avcodec_parameters_alloc();
+		if (!cs->par || avcodec_parameters_copy(cs->par, st->codecpar) < 0) {
+			free_entry(e);
+			break;
+		}
+		cs->time_base = st->time_base;
+		cs->avg_frame_rate = st->avg_frame_rate;
+		cs->r_frame_rate = st->r_frame_rate;
+		cs->sample_aspect_ratio = st->sample_aspect_ratio;
+		cs->start_time = st->start_time;
+		cs->duration = st->duration;
+	}
+
+	pthread_mutex_unlock(&g_cache_mutex);
+}
+
+bool stream_cache_get_duration(const char *path, int64_t *duration)
+{
+	if (!path || !duration)
+		return false;
+
+	pthread_mutex_lock(&g_cache_mutex);
+	struct stream_cache_entry *e = find_entry(path);
+	bool found = e && e->duration != AV_NOPTS_VALUE && e->duration > 0;
+	if (found)
+		*duration = e->duration;
+	pthread_mutex_unlock(&g_cache_mutex);
+	return found;
+}
+
+void stream_cache_clear(void)
+{
+	pthread_mutex_lock(&g_cache_mutex);
+	for (int i = 0; i < STREAM_CACHE_SIZE; i++)
+		free_entry(&g_entries[i]);
+	pthread_mutex_unlock(&g_cache_mutex);
+}
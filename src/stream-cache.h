@@ -0,0 +1,42 @@
+/*
+ * Stream parameter cache for fast file opens
+ * avformat_find_stream_info decodes the start of every stream, which costs
+ * hundreds of milliseconds on 4K HEVC. Its results are kept per file
+ * (keyed by path, size and modification time), so later opens of the same
+ * file only read the container header and fill in the rest from here
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libavformat/avformat.h>
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Demuxer that handled the file last time, skipping format probing.
+ * NULL when the file isn't cached */
+const AVInputFormat *stream_cache_get_input_format(const char *path);
+
+/* Use instead of avformat_find_stream_info on a freshly opened context.
+ * Validates the header's streams against the cached ones and fills in the
+ * probed parameters (extradata, dimensions, pixel format, frame rates,
+ * timings). Returns false, leaving ctx untouched, on a miss or mismatch -
+ * probe normally then */
+bool stream_cache_apply(const char *path, AVFormatContext *ctx);
+
+/* Save the results of a full avformat_find_stream_info */
+void stream_cache_store(const char *path, const AVFormatContext *ctx);
+
+/* Container duration in microseconds from the cache, false if not cached */
+bool stream_cache_get_duration(const char *path, int64_t *duration);
+
+/* Free every entry (module unload) */
+void stream_cache_clear(void);
@@ -0,0 +1,578 @@
+/*
+ * Keyframe thumbnail cache implementation
+ */
+
+#include "thumbnail-cache.h"
+#include "stream-cache.h"
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <string.h>
+
+#define blog(level, format, ...) \
+	blog(level, "[Thumbnail Cache] " format, ##__VA_ARGS__)
+
+/* Give up if no keyframe shows up within this many video packets */
+#define MAX_PACKETS_TO_KEYFRAME 1000
+
+/* Posters are taken this far into the file, skipping black lead-ins */
+#define POSTER_POSITION_DIVISOR 10
+
+/* Blocking reads of a request give up after this long (stalled network paths) */
+#define REQUEST_TIMEOUT_NS (10ULL * 1000000000ULL)
+
+struct thumbnail_entry {
+	char *path;                /* NULL = empty slot */
+	int64_t pts;               /* Keyframe PTS (us) */
+	int64_t span_end;          /* Latest request time known to resolve to this keyframe */
+	bool poster;
+	uint8_t *data;
+	uint32_t linesize;
+	int width;
+	int height;
+	uint64_t last_access_time;
+};
+
+/* Demuxer + keyframe-only decoder for one file */
+struct keyframe_decoder {
+	char *path;
+	AVFormatContext *format_ctx;
+	AVCodecContext *codec_ctx;
+	int stream_idx;
+	struct SwsContext *sws_ctx;
+	AVFrame *frame;
+	AVPacket *packet;
+	int thumb_width;
+	int thumb_height;
+	const bool *stopping;      /* The owning cache's stopping flag */
+	uint64_t deadline_ns;      /* Reads of the current request are interrupted after this */
+};
+
+struct thumbnail_cache {
+	struct thumbnail_entry entries[THUMBNAIL_CACHE_SIZE];
+	pthread_mutex_t lock;          /* Protects entries and the poster queue */
+	int max_width;
+	int max_height;
+
+	/* Scrub decoder, kept open across requests for the same file */
+	struct keyframe_decoder scrub;
+	pthread_mutex_t scrub_lock;
+
+	/* Background poster generation */
+	DARRAY(char*) poster_queue;
+	pthread_t poster_thread;
+	pthread_cond_t poster_cond;
+	bool poster_thread_active;
+	bool stopping;
+
+	/* Statistics */
+	uint64_t hits;
+	uint64_t misses;
+};
+
+static void keyframe_decoder_close(struct keyframe_decoder *kd)
+{
+	if (kd->sws_ctx)
+		sws_freeContext(kd->sws_ctx);
+	if (kd->codec_ctx)
+		avcodec_free_context(&kd->codec_ctx);
+	if (kd->format_ctx)
+		avformat_close_input(&kd->format_ctx);
+	if (kd->frame)
+		av_frame_free(&kd->frame);
+	if (kd->packet)
+		av_packet_free(&kd->packet);
+	bfree(kd->path);
+	memset(kd, 0, sizeof(*kd));
+}
+
+/* Thumbnail size: display aspect ratio fitted into the cache's box */
+static void fit_thumbnail_size(const AVCodecParameters *par, AVRational sar,
+	int max_width, int max_height, int *width, int *height)
+{
+	double w = par->width;
+	double h = par->height;
+	if (sar.num > 0 && sar.den > 0)
+		w = w * sar.num / sar.den;
+
+	double scale_w = max_width / w;
+	double scale_h = max_height / h;
+	double scale = scale_w < scale_h ? scale_w : scale_h;
+	if (scale > 1.0)
+		scale = 1.0;
+
+	*width = ((int)(w * scale + 0.5)) & ~1;
+	*height = ((int)(h * scale + 0.5)) & ~1;
+	if (*width < 2) *width = 2;
+	if (*height < 2) *height = 2;
+}
+
+/* FFmpeg interrupt callback, like the decoder's: blocking operations stop
+ * when the cache shuts down or the request runs out of time */
+static int keyframe_decoder_interrupt(void *opaque)
+{
+	struct keyframe_decoder *kd = opaque;
+	if (kd->stopping && *(const volatile bool*)kd->stopping)
+		return 1;
+	return os_gettime_ns() > kd->deadline_ns ? 1 : 0;
+}
+
+/* Open path, or keep the already open file. Starts a new request's timeout */
+static bool keyframe_decoder_open(struct thumbnail_cache *cache, struct keyframe_decoder *kd,
+	const char *path)
+{
+	if (kd->path && strcmp(kd->path, path) == 0) {
+		kd->deadline_ns = os_gettime_ns() + REQUEST_TIMEOUT_NS;
+		return true;
+	}
+
+	keyframe_decoder_close(kd);
+	kd->stopping = &cache->stopping;
+	kd->deadline_ns = os_gettime_ns() + REQUEST_TIMEOUT_NS;
+
+	/* Allocated here so the interrupt callback covers the open itself */
+	kd->format_ctx = avformat_alloc_context();
+	if (!kd->format_ctx)
+		return false;
+	kd->format_ctx->interrupt_callback.callback = keyframe_decoder_interrupt;
+	kd->format_ctx->interrupt_callback.opaque = kd;
+
+	if (avformat_open_input(&kd->format_ctx, path, stream_cache_get_input_format(path), NULL) < 0) {
+		blog(LOG_WARNING, "Failed to open %s", path);
+		return false;
+	}
+	if (!stream_cache_apply(path, kd->format_ctx)) {
+		if (avformat_find_stream_info(kd->format_ctx, NULL) < 0)
+			goto fail;
+		stream_cache_store(path, kd->format_ctx);
+	}
+
+	kd->stream_idx = av_find_best_stream(kd->format_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+	if (kd->stream_idx < 0)
+		goto fail;
+
+	AVStream *stream = kd->format_ctx->streams[kd->stream_idx];
+	const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+	if (!codec)
+		goto fail;
+
+	kd->codec_ctx = avcodec_alloc_context3(codec);
+	if (!kd->codec_ctx)
+		goto fail;
+	avcodec_parameters_to_context(kd->codec_ctx, stream->codecpar);
+
+	fit_thumbnail_size(stream->codecpar, stream->sample_aspect_ratio,
+		cache->max_width, cache->max_height, &kd->thumb_width, &kd->thumb_height);
+
+	/* Only keyframes, at the largest lowres factor (smallest decoded size)
+	 * that still covers the thumbnail */
+	int lowres = 0;
+	while (lowres < codec->max_lowres &&
+	       (stream->codecpar->width >> (lowres + 1)) >= kd->thumb_width &&
+	       (stream->codecpar->height >> (lowres + 1)) >= kd->thumb_height) {
+		lowres++;
+	}
+	kd->codec_ctx->lowres = lowres;
+	kd->codec_ctx->skip_frame = AVDISCARD_NONKEY;
+	kd->codec_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+	/* Frame threading would hold frames back; keyframes only need slices */
+	kd->codec_ctx->thread_type = FF_THREAD_SLICE;
+	kd->codec_ctx->thread_count = 0;
+
+	if (avcodec_open2(kd->codec_ctx, codec, NULL) < 0)
+		goto fail;
+
+	kd->frame = av_frame_alloc();
+	kd->packet = av_packet_alloc();
+	if (!kd->frame || !kd->packet)
+		goto fail;
+
+	kd->path = bstrdup(path);
+	blog(LOG_DEBUG, "Opened %s for keyframe decode (%s, lowres %d, %dx%d thumbnails)",
+		path, codec->name, lowres, kd->thumb_width, kd->thumb_height);
+	return true;
+
+fail:
+	blog(LOG_WARNING, "No decodable video stream in %s", path);
+	keyframe_decoder_close(kd);
+	return false;
+}
+
+/* Seek to the keyframe at or before time_us and leave its packet in
+ * kd->packet. Returns the keyframe PTS in microseconds, relative to the
+ * stream's start time like time_us (MPEG-TS streams start far from 0) */
+static bool keyframe_decoder_seek(struct keyframe_decoder *kd, int64_t time_us, int64_t *kf_pts)
+{
+	AVStream *stream = kd->format_ctx->streams[kd->stream_idx];
+	int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+	int64_t target = av_rescale_q(time_us, AV_TIME_BASE_Q, stream->time_base) + start;
+
+	if (av_seek_frame(kd->format_ctx, kd->stream_idx, target, AVSEEK_FLAG_BACKWARD) < 0 &&
+	    av_seek_frame(kd->format_ctx, kd->stream_idx, start, AVSEEK_FLAG_BACKWARD) < 0)
+		return false;
+	avcodec_flush_buffers(kd->codec_ctx);
+
+	/* Skip non-key packets at the demuxer so they are never sent to the codec */
+	for (int scanned = 0; scanned < MAX_PACKETS_TO_KEYFRAME;) {
+		if (av_read_frame(kd->format_ctx, kd->packet) < 0)
+			return false;
+
+		if (kd->packet->stream_index == kd->stream_idx) {
+			if (kd->packet->flags & AV_PKT_FLAG_KEY) {
+				int64_t pts = kd->packet->pts != AV_NOPTS_VALUE ? kd->packet->pts : kd->packet->dts;
+				*kf_pts = pts != AV_NOPTS_VALUE && pts > start ?
+					av_rescale_q(pts - start, stream->time_base, AV_TIME_BASE_Q) : 0;
+				return true;
+			}
+			scanned++;
+		}
+		av_packet_unref(kd->packet);
+	}
+
+	return false;
+}
+
+/* Decode the keyframe in kd->packet into a newly allocated BGRA buffer */
+static uint8_t *keyframe_decoder_decode(struct keyframe_decoder *kd, uint32_t *linesize)
+{
+	int ret = avcodec_send_packet(kd->codec_ctx, kd->packet);
+	av_packet_unref(kd->packet);
+	if (ret < 0)
+		return NULL;
+
+	/* Drain so codecs with reorder delay return the keyframe right away */
+	avcodec_send_packet(kd->codec_ctx, NULL);
+	ret = avcodec_receive_frame(kd->codec_ctx, kd->frame);
+	avcodec_flush_buffers(kd->codec_ctx);
+	if (ret < 0)
+		return NULL;
+
+	kd->sws_ctx = sws_getCachedContext(kd->sws_ctx,
+		kd->frame->width, kd->frame->height, kd->frame->format,
+		kd->thumb_width, kd->thumb_height, AV_PIX_FMT_BGRA,
+		SWS_BILINEAR, NULL, NULL, NULL);
+	if (!kd->sws_ctx) {
+		av_frame_unref(kd->frame);
+		return NULL;
+	}
+
+	*linesize = (uint32_t)kd->thumb_width * 4;
+	uint8_t *data = bmalloc((size_t)*linesize * kd->thumb_height);
+	uint8_t *dst[4] = { data, NULL, NULL, NULL };
+	int dst_linesize[4] = { (int)*linesize, 0, 0, 0 };
+
+	sws_scale(kd->sws_ctx, (const uint8_t * const *)kd->frame->data, kd->frame->linesize,
+		0, kd->frame->height, dst, dst_linesize);
+	av_frame_unref(kd->frame);
+
+	return data;
+}
+
+/* Must be called with lock held */
+static void copy_entry(struct thumbnail_entry *e, struct thumbnail *out)
+{
+	e->last_access_time = os_gettime_ns();
+
+	out->data = bmemdup(e->data, (size_t)e->linesize * e->height);
+	out->linesize = e->linesize;
+	out->width = e->width;
+	out->height = e->height;
+	out->pts = e->pts;
+}
+
+/* Must be called with lock held */
+static struct thumbnail_entry *find_entry(struct thumbnail_cache *cache, const char *path,
+	int64_t kf_pts, int64_t time_us, bool poster)
+{
+	for (int i = 0; i < THUMBNAIL_CACHE_SIZE; i++) {
+		struct thumbnail_entry *e = &cache->entries[i];
+		if (!e->path || e->poster != poster || strcmp(e->path, path) != 0)
+			continue;
+
+		if (poster)
+			return e;
+		if (kf_pts != AV_NOPTS_VALUE ? e->pts == kf_pts :
+		    (time_us >= e->pts && time_us <= e->span_end))
+			return e;
+	}
+	return NULL;
+}
+
+/* Must be called with lock held. Evicts scrub thumbnails before posters */
+static struct thumbnail_entry *alloc_entry(struct thumbnail_cache *cache)
+{
+	struct thumbnail_entry *lru = NULL;
+
+	for (int i = 0; i < THUMBNAIL_CACHE_SIZE; i++) {
+		struct thumbnail_entry *e = &cache->entries[i];
+		if (!e->path)
+			return e;
+
+		if (!lru || (lru->poster && !e->poster) ||
+		    (lru->poster == e->poster && e->last_access_time < lru->last_access_time))
+			lru = e;
+	}
+
+	bfree(lru->path);
+	bfree(lru->data);
+	memset(lru, 0, sizeof(*lru));
+	return lru;
+}
+
+/* Must be called with lock held. Takes ownership of data */
+static struct thumbnail_entry *insert_entry(struct thumbnail_cache *cache,
+	struct keyframe_decoder *kd, int64_t kf_pts, int64_t time_us, bool poster,
+	uint8_t *data, uint32_t linesize)
+{
+	struct thumbnail_entry *e = alloc_entry(cache);
+	e->path = bstrdup(kd->path);
+	e->pts = kf_pts;
+	e->span_end = time_us > kf_pts ? time_us : kf_pts;
+	e->poster = poster;
+	e->data = data;
+	e->linesize = linesize;
+	e->width = kd->thumb_width;
+	e->height = kd->thumb_height;
+	e->last_access_time = os_gettime_ns();
+	return e;
+}
+
+bool thumbnail_cache_get(struct thumbnail_cache *cache, const char *path,
+	int64_t time_us, struct thumbnail *out)
+{
+	if (!cache || !path || !*path || !out)
+		return false;
+
+	memset(out, 0, sizeof(*out));
+	if (time_us < 0)
+		time_us = 0;
+
+	pthread_mutex_lock(&cache->lock);
+	struct thumbnail_entry *e = find_entry(cache, path, AV_NOPTS_VALUE, time_us, false);
+	if (e) {
+		copy_entry(e, out);
+		cache->hits++;
+		pthread_mutex_unlock(&cache->lock);
+		return true;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	pthread_mutex_lock(&cache->scrub_lock);
+
+	struct keyframe_decoder *kd = &cache->scrub;
+	int64_t kf_pts = 0;
+	if (!keyframe_decoder_open(cache, kd, path) ||
+	    !keyframe_decoder_seek(kd, time_us, &kf_pts)) {
+		pthread_mutex_unlock(&cache->scrub_lock);
+		return false;
+	}
+
+	/* The keyframe may already be cached from a nearby request - only the
+	 * demuxer seek was paid for this one */
+	pthread_mutex_lock(&cache->lock);
+	e = find_entry(cache, path, kf_pts, time_us, false);
+	if (e) {
+		if (time_us > e->span_end)
+			e->span_end = time_us;
+		copy_entry(e, out);
+		cache->hits++;
+		pthread_mutex_unlock(&cache->lock);
+		av_packet_unref(kd->packet);
+		pthread_mutex_unlock(&cache->scrub_lock);
+		return true;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	uint32_t linesize = 0;
+	uint8_t *data = keyframe_decoder_decode(kd, &linesize);
+	if (!data) {
+		pthread_mutex_unlock(&cache->scrub_lock);
+		return false;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	e = insert_entry(cache, kd, kf_pts, time_us, false, data, linesize);
+	copy_entry(e, out);
+	cache->misses++;
+	pthread_mutex_unlock(&cache->lock);
+
+	pthread_mutex_unlock(&cache->scrub_lock);
+	return true;
+}
+
+static void generate_poster(struct thumbnail_cache *cache, const char *path)
+{
+	struct keyframe_decoder kd = {0};
+
+	if (!keyframe_decoder_open(cache, &kd, path))
+		return;
+
+	int64_t duration = kd.format_ctx->duration;
+	int64_t time_us = duration > 0 ? duration / POSTER_POSITION_DIVISOR : 0;
+	int64_t kf_pts = 0;
+	uint32_t linesize = 0;
+	uint8_t *data = NULL;
+
+	if (keyframe_decoder_seek(&kd, time_us, &kf_pts))
+		data = keyframe_decoder_decode(&kd, &linesize);
+
+	if (data) {
+		pthread_mutex_lock(&cache->lock);
+		if (!find_entry(cache, path, AV_NOPTS_VALUE, 0, true))
+			insert_entry(cache, &kd, kf_pts, kf_pts, true, data, linesize);
+		else
+			bfree(data);
+		pthread_mutex_unlock(&cache->lock);
+
+		blog(LOG_DEBUG, "Poster for %s at %lld ms", path, (long long)(kf_pts / 1000));
+	}
+
+	keyframe_decoder_close(&kd);
+}
+
+static void *poster_thread(void *data)
+{
+	struct thumbnail_cache *cache = data;
+
+	os_set_thread_name("fmgnice-poster");
+
+	pthread_mutex_lock(&cache->lock);
+	while (!cache->stopping) {
+		if (!cache->poster_queue.num) {
+			pthread_cond_wait(&cache->poster_cond, &cache->lock);
+			continue;
+		}
+
+		char *path = cache->poster_queue.array[0];
+		da_erase(cache->poster_queue, 0);
+		pthread_mutex_unlock(&cache->lock);
+
+		generate_poster(cache, path);
+		bfree(path);
+
+		pthread_mutex_lock(&cache->lock);
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return NULL;
+}
+
+struct thumbnail_cache *thumbnail_cache_create(int max_width, int max_height)
+{
+	struct thumbnail_cache *cache = bzalloc(sizeof(struct thumbnail_cache));
+
+	cache->max_width = max_width > 0 ? max_width : THUMBNAIL_MAX_WIDTH;
+	cache->max_height = max_height > 0 ? max_height : THUMBNAIL_MAX_HEIGHT;
+
+	pthread_mutex_init(&cache->lock, NULL);
+	pthread_mutex_init(&cache->scrub_lock, NULL);
+	pthread_cond_init(&cache->poster_cond, NULL);
+	da_init(cache->poster_queue);
+
+	return cache;
+}
+
+void thumbnail_cache_destroy(struct thumbnail_cache *cache)
+{
+	if (!cache)
+		return;
+
+	pthread_mutex_lock(&cache->lock);
+	cache->stopping = true;
+	pthread_cond_signal(&cache->poster_cond);
+	pthread_mutex_unlock(&cache->lock);
+
+	if (cache->poster_thread_active)
+		pthread_join(cache->poster_thread, NULL);
+
+	if (cache->hits || cache->misses) {
+		blog(LOG_INFO, "Scrub stats: %llu hits, %llu decodes",
+			(unsigned long long)cache->hits, (unsigned long long)cache->misses);
+	}
+
+	for (size_t i = 0; i < cache->poster_queue.num; i++)
+		bfree(cache->poster_queue.array[i]);
+	da_free(cache->poster_queue);
+
+	for (int i = 0; i < THUMBNAIL_CACHE_SIZE; i++) {
+		bfree(cache->entries[i].path);
+		bfree(cache->entries[i].data);
+	}
+
+	keyframe_decoder_close(&cache->scrub);
+
+	pthread_cond_destroy(&cache->poster_cond);
+	pthread_mutex_destroy(&cache->scrub_lock);
+	pthread_mutex_destroy(&cache->lock);
+	bfree(cache);
+}
+
+void thumbnail_cache_request_poster(struct thumbnail_cache *cache, const char *path)
+{
+	if (!cache || !path || !*path)
+		return;
+
+	pthread_mutex_lock(&cache->lock);
+
+	bool queued = find_entry(cache, path, AV_NOPTS_VALUE, 0, true) != NULL;
+	for (size_t i = 0; !queued && i < cache->poster_queue.num; i++)
+		queued = strcmp(cache->poster_queue.array[i], path) == 0;
+
+	if (!queued && !cache->stopping) {
+		char *copy = bstrdup(path);
+		da_push_back(cache->poster_queue, &copy);
+
+		/* Worker is started on first use so sources that never ask for
+		 * posters don't carry an idle thread */
+		if (!cache->poster_thread_active) {
+			cache->poster_thread_active =
+				pthread_create(&cache->poster_thread, NULL, poster_thread, cache) == 0;
+		}
+		pthread_cond_signal(&cache->poster_cond);
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+}
+
+bool thumbnail_cache_get_poster(struct thumbnail_cache *cache, const char *path,
+	struct thumbnail *out)
+{
+	if (!cache || !path || !out)
+		return false;
+
+	memset(out, 0, sizeof(*out));
+
+	pthread_mutex_lock(&cache->lock);
+	struct thumbnail_entry *e = find_entry(cache, path, AV_NOPTS_VALUE, 0, true);
+	if (e)
+		copy_entry(e, out);
+	pthread_mutex_unlock(&cache->lock);
+
+	return e != NULL;
+}
+
+void thumbnail_cache_cancel_posters(struct thumbnail_cache *cache)
+{
+	if (!cache)
+		return;
+
+	pthread_mutex_lock(&cache->lock);
+	for (size_t i = 0; i < cache->poster_queue.num; i++)
+		bfree(cache->poster_queue.array[i]);
+	da_resize(cache->poster_queue, 0);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void thumbnail_free(struct thumbnail *thumb)
+{
+	if (!thumb)
+		return;
+
+	bfree(thumb->data);
+	memset(thumb, 0, sizeof(*thumb));
+}
@@ -0,0 +1,51 @@
+/*
+ * Keyframe thumbnail cache for scrub previews and poster frames
+ * Decodes only keyframes at reduced resolution on a separate demuxer, so
+ * previews never disturb (or pay the cost of) the playback decoder
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Thumbnails are fitted into this box, keeping aspect ratio */
+#define THUMBNAIL_MAX_WIDTH 320
+#define THUMBNAIL_MAX_HEIGHT 180
+
+/* Cached thumbnails, posters included */
+#define THUMBNAIL_CACHE_SIZE 64
+
+/* BGRA thumbnail owned by the caller, release with thumbnail_free() */
+struct thumbnail {
+	uint8_t *data;
+	uint32_t linesize;
+	int width;
+	int height;
+	int64_t pts;       /* Keyframe PTS in microseconds */
+};
+
+struct thumbnail_cache;
+
+/* Create a cache, max_width/max_height of 0 use the defaults */
+struct thumbnail_cache *thumbnail_cache_create(int max_width, int max_height);
+
+/* Stops the poster worker and frees all thumbnails */
+void thumbnail_cache_destroy(struct thumbnail_cache *cache);
+
+/* Keyframe at or before time_us. Served from the cache when possible,
+ * otherwise only that keyframe is decoded. Safe from any thread */
+bool thumbnail_cache_get(struct thumbnail_cache *cache, const char *path,
+	int64_t time_us, struct thumbnail *out);
+
+/* Queue background poster generation for a file (no-op if cached/queued) */
+void thumbnail_cache_request_poster(struct thumbnail_cache *cache, const char *path);
+
+/* Poster frame for a file if the worker has produced one */
+bool thumbnail_cache_get_poster(struct thumbnail_cache *cache, const char *path,
+	struct thumbnail *out);
+
+/* Drop queued poster requests (e.g. playlist replaced) */
+void thumbnail_cache_cancel_posters(struct thumbnail_cache *cache);
+
+void thumbnail_free(struct thumbnail *thumb);